@@ -0,0 +1,105 @@
+/*
+ * wish_alloc_count.c — Contador de asignaciones para LD_PRELOAD
+ *
+ * Se compila como biblioteca compartida y lo carga wish_soak en modo -a.
+ * Intercepta malloc/calloc/realloc/free del proceso wish (no de los hijos:
+ * LD_PRELOAD se retira del entorno al cargar) y escribe una línea
+ *
+ *   allocs=<n> frees=<n> live=<n> bytes=<n>
+ *
+ * en el archivo indicado por WISH_ALLOC_REPORT cada vez que recibe SIGUSR1
+ * y al terminar el proceso.
+ */
+
+#define _GNU_SOURCE
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+extern void *__libc_malloc(size_t);
+extern void *__libc_calloc(size_t, size_t);
+extern void *__libc_realloc(void *, size_t);
+extern void  __libc_free(void *);
+
+static volatile unsigned long n_allocs, n_frees, n_bytes;
+static pid_t owner;
+static int report_fd = -1;
+
+void *malloc(size_t n) {
+    __atomic_add_fetch(&n_allocs, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&n_bytes, n, __ATOMIC_RELAXED);
+    return __libc_malloc(n);
+}
+
+void *calloc(size_t n, size_t sz) {
+    __atomic_add_fetch(&n_allocs, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&n_bytes, n * sz, __ATOMIC_RELAXED);
+    return __libc_calloc(n, sz);
+}
+
+void *realloc(void *p, size_t n) {
+    if (p == NULL) {
+        __atomic_add_fetch(&n_allocs, 1, __ATOMIC_RELAXED);
+    } else if (n == 0) {
+        __atomic_add_fetch(&n_frees, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_add_fetch(&n_bytes, n, __ATOMIC_RELAXED);
+    return __libc_realloc(p, n);
+}
+
+void free(void *p) {
+    if (p) __atomic_add_fetch(&n_frees, 1, __ATOMIC_RELAXED);
+    __libc_free(p);
+}
+
+/* Formatea sin stdio: se usa desde un manejador de señal */
+static char *put_ulong(char *dst, const char *label, unsigned long v) {
+    char tmp[24];
+    int n = 0;
+    while (*label) *dst++ = *label++;
+    do { tmp[n++] = (char)('0' + v % 10); v /= 10; } while (v);
+    while (n) *dst++ = tmp[--n];
+    return dst;
+}
+
+static void write_report(void) {
+    if (report_fd < 0 || getpid() != owner) return;
+    char line[160];
+    unsigned long a = n_allocs, f = n_frees;
+    char *p = line;
+    p = put_ulong(p, "allocs=", a);
+    p = put_ulong(p, " frees=", f);
+    p = put_ulong(p, " live=", a >= f ? a - f : 0);
+    p = put_ulong(p, " bytes=", n_bytes);
+    *p++ = '\n';
+    ssize_t r = write(report_fd, line, (size_t)(p - line));
+    (void)r;
+}
+
+static void on_usr1(int sig) {
+    (void)sig;
+    write_report();
+}
+
+__attribute__((constructor))
+static void count_init(void) {
+    owner = getpid();
+    const char *path = getenv("WISH_ALLOC_REPORT");
+    if (path) report_fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    /* Los comandos que lance wish no deben heredar el contador */
+    unsetenv("LD_PRELOAD");
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_usr1;
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &sa, NULL);
+}
+
+__attribute__((destructor))
+static void count_fini(void) {
+    write_report();
+}
@@ -0,0 +1,424 @@
+/*
+ * wish_bytecode.c – Compilación de scripts a .wbc y ejecución vía mmap
+ */
+
+#define _GNU_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "wish_bytecode.h"
+
+/* --------------------- Compilación --------------------- */
+
+typedef struct {
+    uint32_t *lines;   uint32_t nlines, cap_lines;
+    uint32_t *srclines; uint32_t cap_srclines;  /* nlines elementos */
+    WbcNode  *nodes;   uint32_t nnodes, cap_nodes;
+    WbcKid   *kids;    uint32_t nkids, cap_kids;
+    uint32_t *words;   uint32_t nwords, cap_words;
+    uint32_t *str_off; uint32_t nstrings, cap_strings;
+    char     *blob;    uint32_t blob_len, cap_blob;
+    uint32_t *hash;    uint32_t hash_size;      /* id + 1 (0 = libre) */
+} Builder;
+
+/* Asegura hueco para un elemento más en un vector de tamaño elem */
+static int grow(void **v, uint32_t *cap, uint32_t need, size_t elem) {
+    if (need <= *cap) return 0;
+    uint32_t ncap = *cap ? *cap : 64;
+    while (ncap < need) ncap *= 2;
+    void *nv = realloc(*v, (size_t)ncap * elem);
+    if (!nv) return -1;
+    *v = nv;
+    *cap = ncap;
+    return 0;
+}
+
+/* FNV-1a de 32 bits */
+static uint32_t hash_str(const char *s) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)s; *p; p++) {
+        h = (h ^ *p) * 16777619u;
+    }
+    return h;
+}
+
+static int rehash(Builder *b, uint32_t size) {
+    uint32_t *nh = calloc(size, sizeof(uint32_t));
+    if (!nh) return -1;
+    for (uint32_t id = 0; id < b->nstrings; id++) {
+        uint32_t i = hash_str(b->blob + b->str_off[id]) & (size - 1);
+        while (nh[i]) i = (i + 1) & (size - 1);
+        nh[i] = id + 1;
+    }
+    free(b->hash);
+    b->hash = nh;
+    b->hash_size = size;
+    return 0;
+}
+
+/* Id de la cadena s; las repetidas ("ls", "/tmp"...) se guardan una vez */
+static int intern(Builder *b, const char *s, uint32_t *id) {
+    if ((b->nstrings + 1) * 2 > b->hash_size &&
+        rehash(b, b->hash_size ? b->hash_size * 2 : 256) < 0) return -1;
+
+    uint32_t mask = b->hash_size - 1;
+    uint32_t i = hash_str(s) & mask;
+    for (; b->hash[i]; i = (i + 1) & mask) {
+        uint32_t cand = b->hash[i] - 1;
+        if (strcmp(b->blob + b->str_off[cand], s) == 0) {
+            *id = cand;
+            return 0;
+        }
+    }
+
+    size_t len = strlen(s) + 1;
+    if (len > UINT32_MAX - b->blob_len) return -1;
+    if (grow((void **)&b->blob, &b->cap_blob, b->blob_len + (uint32_t)len, 1) < 0 ||
+        grow((void **)&b->str_off, &b->cap_strings, b->nstrings + 1, sizeof(uint32_t)) < 0) {
+        return -1;
+    }
+    memcpy(b->blob + b->blob_len, s, len);
+    b->str_off[b->nstrings] = b->blob_len;
+    b->blob_len += (uint32_t)len;
+    b->hash[i] = b->nstrings + 1;
+    *id = b->nstrings++;
+    return 0;
+}
+
+/* Guarda n en preorden; los índices (no punteros) sobreviven a los realloc */
+static int emit_node(Builder *b, const Node *n, uint32_t *out) {
+    if (grow((void **)&b->nodes, &b->cap_nodes, b->nnodes + 1, sizeof(WbcNode)) < 0) return -1;
+    uint32_t idx = b->nnodes++;
+    WbcNode wn = { (uint32_t)n->type, (uint32_t)n->group, 0, 0, WBC_NONE, WBC_NONE, 0, 0 };
+
+    if (n->type == NODE_CMD) {
+        wn.first = b->nwords;
+        wn.count = (uint32_t)n->sc.nwords;
+        wn.ntee = (uint32_t)n->sc.ntee;
+        if (grow((void **)&b->words, &b->cap_words, b->nwords + wn.count + wn.ntee,
+                 sizeof(uint32_t)) < 0) {
+            return -1;
+        }
+        for (int i = 0; i < n->sc.nwords; i++) {
+            if (intern(b, n->sc.words[i], &b->words[b->nwords++]) < 0) return -1;
+        }
+        for (int i = 0; i < n->sc.ntee; i++) {
+            if (intern(b, n->sc.tee[i], &b->words[b->nwords++]) < 0) return -1;
+        }
+        if (n->sc.redir && intern(b, n->sc.redir, &wn.redir) < 0) return -1;
+        if (n->sc.in && intern(b, n->sc.in, &wn.in) < 0) return -1;
+        wn.here = (uint32_t)n->sc.here;
+    } else if (n->type == NODE_ANDOR || n->type == NODE_LIST) {
+        wn.first = b->nkids;
+        wn.count = (uint32_t)n->nkids;
+        if (grow((void **)&b->kids, &b->cap_kids, b->nkids + wn.count, sizeof(WbcKid)) < 0) {
+            return -1;
+        }
+        b->nkids += wn.count;
+        for (int i = 0; i < n->nkids; i++) {
+            uint32_t k;
+            if (emit_node(b, n->kids[i], &k) < 0) return -1;
+            b->kids[wn.first + (uint32_t)i] = (WbcKid){ k, (uint32_t)n->ops[i], n->dep[i] };
+        }
+    }
+    b->nodes[idx] = wn;
+    *out = idx;
+    return 0;
+}
+
+static void builder_free(Builder *b) {
+    free(b->lines);
+    free(b->srclines);
+    free(b->nodes);
+    free(b->kids);
+    free(b->words);
+    free(b->str_off);
+    free(b->blob);
+    free(b->hash);
+}
+
+static int write_all(int fd, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static uint32_t align4(uint32_t v) {
+    return (v + 3u) & ~3u;
+}
+
+static int builder_write(const Builder *b, const char *out) {
+    WbcHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, WBC_MAGIC, sizeof(WBC_MAGIC));
+    h.version  = WBC_VERSION;
+    h.nlines   = b->nlines;
+    h.nnodes   = b->nnodes;
+    h.nkids    = b->nkids;
+    h.nwords   = b->nwords;
+    h.nstrings = b->nstrings;
+
+    uint64_t off = sizeof(h);
+    h.lines_off   = (uint32_t)off; off += (uint64_t)b->nlines * sizeof(uint32_t);
+    h.srclines_off = (uint32_t)off; off += (uint64_t)b->nlines * sizeof(uint32_t);
+    h.nodes_off   = (uint32_t)off; off += (uint64_t)b->nnodes * sizeof(WbcNode);
+    h.kids_off    = (uint32_t)off; off += (uint64_t)b->nkids * sizeof(WbcKid);
+    h.words_off   = (uint32_t)off; off += (uint64_t)b->nwords * sizeof(uint32_t);
+    h.str_off     = (uint32_t)off; off += (uint64_t)b->nstrings * sizeof(uint32_t);
+    h.strblob_off = (uint32_t)off; off += b->blob_len;
+    h.strblob_len = b->blob_len;
+    if (off > UINT32_MAX - 4) return -1;
+    h.total_size  = align4((uint32_t)off);
+
+    /* Escritura en un temporal + rename para no dejar un .wbc a medias */
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", out);
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return -1;
+
+    static const char zeros[4];
+    int rc = 0;
+    rc |= write_all(fd, &h, sizeof(h));
+    rc |= write_all(fd, b->lines, (size_t)b->nlines * sizeof(uint32_t));
+    rc |= write_all(fd, b->srclines, (size_t)b->nlines * sizeof(uint32_t));
+    rc |= write_all(fd, b->nodes, (size_t)b->nnodes * sizeof(WbcNode));
+    rc |= write_all(fd, b->kids, (size_t)b->nkids * sizeof(WbcKid));
+    rc |= write_all(fd, b->words, (size_t)b->nwords * sizeof(uint32_t));
+    rc |= write_all(fd, b->str_off, (size_t)b->nstrings * sizeof(uint32_t));
+    rc |= write_all(fd, b->blob, b->blob_len);
+    rc |= write_all(fd, zeros, h.total_size - (uint32_t)off);
+    if (close(fd) != 0) rc = -1;
+    if (rc == 0 && rename(tmp, out) == 0) return 0;
+    unlink(tmp);
+    return -1;
+}
+
+int wbc_compile(const char *src, const char *out) {
+    FILE *in = fopen(src, "r");
+    if (!in) return -1;
+
+    Builder b;
+    memset(&b, 0, sizeof(b));
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t n;
+    int rc = 0;
+    uint32_t lineno = 0;
+    while (rc == 0 && (n = getline(&line, &cap, in)) != -1) {
+        lineno++;
+        if (line_is_blank(line, (size_t)n)) continue;
+        uint32_t root = WBC_NONE;
+        Node *tree = parse_line(line);
+        if (tree) rc = emit_node(&b, tree, &root);
+        node_free(tree);
+        if (rc == 0 &&
+            (grow((void **)&b.lines, &b.cap_lines, b.nlines + 1, sizeof(uint32_t)) < 0 ||
+             grow((void **)&b.srclines, &b.cap_srclines, b.nlines + 1, sizeof(uint32_t)) < 0)) rc = -1;
+        if (rc == 0) {
+            b.srclines[b.nlines] = lineno;
+            b.lines[b.nlines++] = root;
+        }
+    }
+    free(line);
+    fclose(in);
+
+    if (rc == 0) rc = builder_write(&b, out);
+    builder_free(&b);
+    return rc;
+}
+
+/* --------------------- Carga --------------------- */
+
+int wbc_is_bytecode(const char *path) {
+    char magic[8];
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+    ssize_t n = read(fd, magic, sizeof(magic));
+    close(fd);
+    return n == (ssize_t)sizeof(magic) && memcmp(magic, WBC_MAGIC, sizeof(WBC_MAGIC)) == 0;
+}
+
+static int in_bounds(const Wbc *w, uint64_t off, uint64_t len) {
+    return off <= w->size && len <= w->size - off && off % 4 == 0;
+}
+
+/* Validación única al abrir: después wbc_line no necesita chequeos */
+static int wbc_validate(const Wbc *w) {
+    const WbcHeader *h = w->hdr;
+    const char *blob = (const char *)w->base + h->strblob_off;
+
+    for (uint32_t i = 0; i < h->nstrings; i++) {
+        if (w->str_off[i] >= h->strblob_len) return -1;
+    }
+    if (h->strblob_len && blob[h->strblob_len - 1] != '\0') return -1;
+    for (uint32_t i = 0; i < h->nwords; i++) {
+        if (w->words[i] >= h->nstrings) return -1;
+    }
+    for (uint32_t i = 0; i < h->nlines; i++) {
+        if (w->lines[i] != WBC_NONE && w->lines[i] >= h->nnodes) return -1;
+        /* Creciente: --resume salta por número de línea */
+        if (w->srclines[i] <= (i ? w->srclines[i - 1] : 0)) return -1;
+    }
+    for (uint32_t i = 0; i < h->nnodes; i++) {
+        const WbcNode *n = &w->nodes[i];
+        switch (n->type) {
+        case NODE_CMD:
+            if (n->count == 0 || n->first > h->nwords || n->count > h->nwords - n->first ||
+                n->ntee > h->nwords - n->first - n->count) return -1;
+            if (n->redir != WBC_NONE && n->redir >= h->nstrings) return -1;
+            if (n->in != WBC_NONE && n->in >= h->nstrings) return -1;
+            break;
+        case NODE_ERROR:
+            break;
+        case NODE_ANDOR:
+        case NODE_LIST:
+            if (n->first > h->nkids || n->count > h->nkids - n->first) return -1;
+            for (uint32_t k = 0; k < n->count; k++) {
+                const WbcKid *kid = &w->kids[n->first + k];
+                /* Preorden: descartar ciclos exigiendo hijos posteriores */
+                if (kid->node <= i || kid->node >= h->nnodes || kid->op > OP_OR ||
+                    kid->dep < -1 || kid->dep >= (int32_t)k) return -1;
+            }
+            break;
+        default:
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int wbc_open(Wbc *w, const char *path) {
+    memset(w, 0, sizeof(*w));
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(WbcHeader)) {
+        close(fd);
+        return -1;
+    }
+    void *m = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) return -1;
+
+    w->base = m;
+    w->size = (size_t)st.st_size;
+    w->hdr = m;
+
+    const WbcHeader *h = w->hdr;
+    if (memcmp(h->magic, WBC_MAGIC, sizeof(WBC_MAGIC)) != 0 ||
+        h->version != WBC_VERSION || h->total_size != w->size ||
+        !in_bounds(w, h->lines_off, (uint64_t)h->nlines * sizeof(uint32_t)) ||
+        !in_bounds(w, h->srclines_off, (uint64_t)h->nlines * sizeof(uint32_t)) ||
+        !in_bounds(w, h->nodes_off, (uint64_t)h->nnodes * sizeof(WbcNode)) ||
+        !in_bounds(w, h->kids_off, (uint64_t)h->nkids * sizeof(WbcKid)) ||
+        !in_bounds(w, h->words_off, (uint64_t)h->nwords * sizeof(uint32_t)) ||
+        !in_bounds(w, h->str_off, (uint64_t)h->nstrings * sizeof(uint32_t)) ||
+        h->strblob_off > w->size || h->strblob_len > w->size - h->strblob_off) {
+        wbc_close(w);
+        return -1;
+    }
+
+    w->lines   = (const uint32_t *)(w->base + h->lines_off);
+    w->srclines = (const uint32_t *)(w->base + h->srclines_off);
+    w->nodes   = (const WbcNode *)(w->base + h->nodes_off);
+    w->kids    = (const WbcKid *)(w->base + h->kids_off);
+    w->words   = (const uint32_t *)(w->base + h->words_off);
+    w->str_off = (const uint32_t *)(w->base + h->str_off);
+
+    if (wbc_validate(w) != 0) {
+        wbc_close(w);
+        return -1;
+    }
+    return 0;
+}
+
+void wbc_close(Wbc *w) {
+    if (w->base) munmap((void *)w->base, w->size);
+    memset(w, 0, sizeof(*w));
+}
+
+/* --------------------- Reconstrucción del árbol --------------------- */
+
+static char *wbc_str(const Wbc *w, uint32_t id) {
+    /* El mapeo es de solo lectura; execv y glob_expand no escriben en argv */
+    return (char *)w->base + w->hdr->strblob_off + w->str_off[id];
+}
+
+static Node *build_node(const Wbc *w, uint32_t idx) {
+    const WbcNode *wn = &w->nodes[idx];
+    Node *n = calloc(1, sizeof(*n));
+    if (!n) return NULL;
+    n->type = (NodeType)wn->type;
+    n->group = (int)wn->group;
+
+    if (wn->type == NODE_CMD) {
+        n->sc.words = malloc(((size_t)wn->count + 1) * sizeof(char *));
+        if (!n->sc.words) { free(n); return NULL; }
+        for (uint32_t i = 0; i < wn->count; i++) {
+            n->sc.words[i] = wbc_str(w, w->words[wn->first + i]);
+        }
+        n->sc.words[wn->count] = NULL;
+        n->sc.nwords = (int)wn->count;
+        if (wn->ntee) {
+            n->sc.tee = malloc(wn->ntee * sizeof(char *));
+            if (!n->sc.tee) { wbc_node_free(n); return NULL; }
+            for (uint32_t i = 0; i < wn->ntee; i++) {
+                n->sc.tee[i] = wbc_str(w, w->words[wn->first + wn->count + i]);
+            }
+            n->sc.ntee = (int)wn->ntee;
+        }
+        n->sc.redir = wn->redir == WBC_NONE ? NULL : wbc_str(w, wn->redir);
+        n->sc.in = wn->in == WBC_NONE ? NULL : wbc_str(w, wn->in);
+        n->sc.here = (int)wn->here;
+        return n;
+    }
+    if (wn->count == 0) return n;
+
+    n->kids = calloc(wn->count, sizeof(Node *));
+    n->ops = malloc(wn->count * sizeof(int));
+    n->dep = malloc(wn->count * sizeof(int));
+    if (!n->kids || !n->ops || !n->dep) { wbc_node_free(n); return NULL; }
+    for (uint32_t i = 0; i < wn->count; i++) {
+        const WbcKid *k = &w->kids[wn->first + i];
+        Node *kid = build_node(w, k->node);
+        if (!kid) { wbc_node_free(n); return NULL; }
+        kid->parent = n;
+        kid->index = (int)i;
+        n->kids[i] = kid;
+        n->ops[i] = (int)k->op;
+        n->dep[i] = k->dep;
+        n->nkids++;
+    }
+    return n;
+}
+
+Node *wbc_line(const Wbc *w, uint32_t i) {
+    uint32_t root = w->lines[i];
+    return root == WBC_NONE ? NULL : build_node(w, root);
+}
+
+void wbc_node_free(Node *n) {
+    if (!n) return;
+    for (int i = 0; i < n->nkids; i++) wbc_node_free(n->kids[i]);
+    free(n->sc.words);        /* las cadenas son del mapeo */
+    free(n->sc.tee);
+    free(n->kids);
+    free(n->ops);
+    free(n->dep);
+    free(n);
+}
@@ -0,0 +1,102 @@
+/*
+ * wish_bytecode.h – Scripts precompilados (.wbc) para el modo batch
+ *
+ * "wish --compile script -o script.wbc" analiza cada línea una sola vez y
+ * guarda el árbol resultante; "wish script.wbc" mapea el archivo y ejecuta
+ * sin volver a tokenizar. Distribución (todo en uint32_t, alineado a 4):
+ *
+ *   WbcHeader
+ *   uint32_t  lines[nlines]       nodo raíz de cada línea no vacía
+ *                                 (WBC_NONE = error de estructura)
+ *   uint32_t  srclines[nlines]    su número de línea en el script (desde 1,
+ *                                 creciente)
+ *   WbcNode   nodes[nnodes]       en preorden: un hijo siempre va después
+ *                                 de su padre
+ *   WbcKid    kids[nkids]         hijos de ANDOR/LIST con su operador y
+ *                                 dependencia (los límites de los grupos '&')
+ *   uint32_t  words[nwords]       argv ya separado, como ids de cadena
+ *   uint32_t  str_off[nstrings]   tabla de cadenas internadas
+ *   char      strblob[]           cadenas terminadas en '\0'
+ *
+ * Las líneas en blanco no se guardan, igual que el lector de texto las salta,
+ * pero srclines conserva la numeración del fuente: wishtop y --journal ven
+ * los mismos números con el script compilado que con el de texto.
+ * Los comodines se siguen expandiendo al ejecutar (dependen del cwd).
+ */
+
+#ifndef WISH_BYTECODE_H
+#define WISH_BYTECODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "wish_parse.h"
+
+#define WBC_MAGIC    "WISHWBC"
+#define WBC_VERSION  4
+#define WBC_NONE     UINT32_MAX
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t nlines;
+    uint32_t nnodes;
+    uint32_t nkids;
+    uint32_t nwords;
+    uint32_t nstrings;
+    uint32_t lines_off;
+    uint32_t srclines_off;
+    uint32_t nodes_off;
+    uint32_t kids_off;
+    uint32_t words_off;
+    uint32_t str_off;
+    uint32_t strblob_off;
+    uint32_t strblob_len;
+    uint32_t total_size;
+} WbcHeader;
+
+typedef struct {
+    uint32_t type;          /* NodeType */
+    uint32_t group;         /* LIST entre paréntesis */
+    uint32_t count;         /* CMD: palabras; ANDOR/LIST: hijos */
+    uint32_t first;         /* índice en words[] o en kids[] */
+    uint32_t redir;         /* id de cadena del destino de '>' o WBC_NONE */
+    uint32_t in;            /* id de cadena de '<' / '<<<' o WBC_NONE */
+    uint32_t here;          /* in es el texto de un '<<<' */
+    uint32_t ntee;          /* destinos de '>+': en words[] tras las palabras */
+} WbcNode;
+
+typedef struct {
+    uint32_t node;
+    uint32_t op;            /* OP_* */
+    int32_t  dep;
+} WbcKid;
+
+typedef struct {
+    const unsigned char *base;
+    size_t               size;
+    const WbcHeader     *hdr;
+    const uint32_t      *lines;
+    const uint32_t      *srclines;
+    const WbcNode       *nodes;
+    const WbcKid        *kids;
+    const uint32_t      *words;
+    const uint32_t      *str_off;
+} Wbc;
+
+/* Compila el script src en out (escritura atómica). Retorna 0 o -1. */
+int  wbc_compile(const char *src, const char *out);
+
+/* 1 si path empieza con la firma de un .wbc */
+int  wbc_is_bytecode(const char *path);
+
+/* Mapea y valida out. Retorna 0 si OK, -1 si error. */
+int  wbc_open(Wbc *w, const char *path);
+void wbc_close(Wbc *w);
+
+/* Árbol de la línea i listo para el planificador, o NULL si la línea tenía
+   un error de estructura. Las cadenas apuntan al mapeo: liberar con
+   wbc_node_free, no con node_free. */
+Node *wbc_line(const Wbc *w, uint32_t i);
+void  wbc_node_free(Node *n);
+
+#endif
@@ -0,0 +1,491 @@
+/*
+ * wish_cache.c – Caché de resultados para comandos deterministas ("cached")
+ *
+ * Cada entrada es un directorio <raíz>/<clave>/ con:
+ *   out  salida estándar (o salida combinada si había '>')
+ *   err  salida de error (vacío en modo combinado)
+ *   rc   estado de wait() en texto; su mtime marca el último uso (LRU)
+ * La publicación es atómica: se captura en <raíz>/tmp.<pid>.<n>/ y se
+ * hace rename() al nombre definitivo.
+ */
+
+#define _GNU_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "wish_cache.h"
+#include "wish_dir.h"
+
+#define CACHE_DEFAULT_MAX_MB 256
+#define CACHE_ROOT_MAX       2048   /* deja holgura para <raíz>/<clave>/<blob> */
+
+static struct {
+    unsigned long hits, misses, stores, evictions;
+    unsigned long long bytes_restored;
+} stats;
+
+static unsigned tmp_seq;
+
+/* --------------------- Hash (SHA-256) --------------------- */
+
+/* Una colisión reproduciría la salida de otro comando sin avisar: la clave
+   es un resumen criptográfico completo, no un hash rápido */
+
+typedef struct {
+    uint32_t st[8];
+    uint64_t total;
+    unsigned char blk[64];
+    size_t used;
+} Hash;
+
+static const uint32_t sha_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha_block(Hash *h, const unsigned char *p) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 |
+               (uint32_t)p[4 * i + 2] << 8 | (uint32_t)p[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROR(w[i - 15], 7) ^ ROR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROR(w[i - 2], 17) ^ ROR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = h->st[0], b = h->st[1], c = h->st[2], d = h->st[3];
+    uint32_t e = h->st[4], f = h->st[5], g = h->st[6], k = h->st[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = k + (ROR(e, 6) ^ ROR(e, 11) ^ ROR(e, 25)) + ((e & f) ^ (~e & g)) + sha_k[i] + w[i];
+        uint32_t t2 = (ROR(a, 2) ^ ROR(a, 13) ^ ROR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        k = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    h->st[0] += a; h->st[1] += b; h->st[2] += c; h->st[3] += d;
+    h->st[4] += e; h->st[5] += f; h->st[6] += g; h->st[7] += k;
+}
+
+static void hash_init(Hash *h) {
+    static const uint32_t iv[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    memcpy(h->st, iv, sizeof(iv));
+    h->total = 0;
+    h->used = 0;
+}
+
+static void hash_bytes(Hash *h, const void *data, size_t n) {
+    const unsigned char *p = data;
+    h->total += n;
+    while (n > 0) {
+        size_t k = 64 - h->used < n ? 64 - h->used : n;
+        memcpy(h->blk + h->used, p, k);
+        h->used += k;
+        p += k;
+        n -= k;
+        if (h->used == 64) {
+            sha_block(h, h->blk);
+            h->used = 0;
+        }
+    }
+}
+
+/* Relleno final; deja la clave en hexadecimal */
+static void hash_final(Hash *h, char key[CACHE_KEY_LEN]) {
+    uint64_t bits = h->total * 8;
+    unsigned char pad[72] = { 0x80 };
+    size_t npad = (h->used < 56 ? 56 : 120) - h->used;
+    for (int i = 0; i < 8; i++) pad[npad + (size_t)i] = (unsigned char)(bits >> (56 - 8 * i));
+    hash_bytes(h, pad, npad + 8);
+    for (int i = 0; i < 8; i++) snprintf(key + 8 * i, 9, "%08x", h->st[i]);
+}
+
+/* Campo con longitud delante: evita que "ab","c" colisione con "a","bc" */
+static void hash_field(Hash *h, const void *data, size_t n) {
+    uint64_t len = n;
+    hash_bytes(h, &len, sizeof(len));
+    hash_bytes(h, data, n);
+}
+
+static void hash_str(Hash *h, const char *s) {
+    hash_field(h, s, strlen(s));
+}
+
+static void hash_stat(Hash *h, const struct stat *st) {
+    int64_t v[4] = { (int64_t)st->st_ino, (int64_t)st->st_size,
+                     (int64_t)st->st_mtim.tv_sec, (int64_t)st->st_mtim.tv_nsec };
+    hash_field(h, v, sizeof(v));
+}
+
+static int hash_file_content(Hash *h, const char *path) {
+    int fd = openat(wish_dirfd, path, O_RDONLY);
+    if (fd < 0) return -1;
+    char buf[65536];
+    ssize_t n;
+    uint64_t total = 0;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        hash_bytes(h, buf, (size_t)n);
+        total += (uint64_t)n;
+    }
+    close(fd);
+    if (n < 0) return -1;
+    hash_bytes(h, &total, sizeof(total));
+    return 0;
+}
+
+/* --------------------- Directorio raíz --------------------- */
+
+static const char *cache_root(void) {
+    static char root[CACHE_ROOT_MAX];
+    if (root[0]) return root;
+
+    const char *env = getenv("WISH_CACHE_DIR");
+    const char *home = getenv("HOME");
+    if (env && *env) snprintf(root, sizeof(root), "%s", env);
+    else if (home && *home) snprintf(root, sizeof(root), "%s/.cache/wish", home);
+    else snprintf(root, sizeof(root), "/tmp/wish-cache-%ld", (long)getuid());
+    return root;
+}
+
+static unsigned long long cache_max_bytes(void) {
+    const char *env = getenv("WISH_CACHE_MAX_MB");
+    unsigned long long mb = CACHE_DEFAULT_MAX_MB;
+    if (env && *env) mb = strtoull(env, NULL, 10);
+    return mb * 1024ULL * 1024ULL;
+}
+
+/* mkdir -p */
+static int mkdir_p(const char *dir) {
+    char tmp[PATH_MAX];
+    snprintf(tmp, sizeof(tmp), "%s", dir);
+    for (char *p = tmp + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(tmp, 0755) != 0 && errno != EEXIST) return -1;
+        *p = '/';
+    }
+    if (mkdir(tmp, 0755) != 0 && errno != EEXIST) return -1;
+    return 0;
+}
+
+static void remove_entry(const char *dir) {
+    static const char *names[] = { "out", "err", "rc" };
+    char p[PATH_MAX + 16];
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        snprintf(p, sizeof(p), "%s/%s", dir, names[i]);
+        unlink(p);
+    }
+    rmdir(dir);
+}
+
+/* --------------------- Clave --------------------- */
+
+int cache_compute_key(const char *bin, char *const argv[], int combined,
+                      const CacheInputs *in, char key[CACHE_KEY_LEN]) {
+    Hash h;
+    hash_init(&h);
+
+    struct stat st;
+    if (fstatat(wish_dirfd, bin, &st, 0) != 0) return -1;
+    hash_str(&h, bin);
+    hash_stat(&h, &st);
+
+    for (int i = 0; argv[i] != NULL; i++) hash_str(&h, argv[i]);
+    hash_field(&h, "", 0);   /* separador fin de argv */
+
+    char cwd[PATH_MAX];
+    if (!wish_getcwd(cwd, sizeof(cwd))) return -1;
+    hash_str(&h, cwd);
+    hash_field(&h, &combined, sizeof(combined));
+
+    for (int i = 0; in && i < in->count; i++) {
+        hash_str(&h, in->paths[i]);
+        if (in->by_mtime[i]) {
+            if (fstatat(wish_dirfd, in->paths[i], &st, 0) != 0) return -1;
+            hash_stat(&h, &st);
+        } else if (hash_file_content(&h, in->paths[i]) != 0) {
+            return -1;
+        }
+    }
+    if (in && in->stdin_file) {
+        hash_str(&h, "<");
+        if (hash_file_content(&h, in->stdin_file) != 0) return -1;
+    }
+    if (in && in->stdin_text) {
+        hash_str(&h, "<<<");
+        hash_str(&h, in->stdin_text);
+    }
+    for (int i = 0; in && i < in->nassign; i++) hash_str(&h, in->assign[i]);
+
+    hash_final(&h, key);
+    return 0;
+}
+
+/* --------------------- Restauración --------------------- */
+
+static long long copy_to_fd(int fd, int dst) {
+    char buf[65536];
+    ssize_t n;
+    long long total = 0;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        for (ssize_t off = 0; off < n; ) {
+            ssize_t w = write(dst, buf + off, (size_t)(n - off));
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                return -1;
+            }
+            off += w;
+        }
+        total += n;
+    }
+    return n < 0 ? -1 : total;
+}
+
+/* Copia abierta de los blobs de una entrada, antes de escribir nada */
+typedef struct {
+    int out, err;
+} Blobs;
+
+static int blobs_open(const char *dir, int with_err, Blobs *b) {
+    char p[PATH_MAX + 16];
+    snprintf(p, sizeof(p), "%s/out", dir);
+    b->out = open(p, O_RDONLY | O_CLOEXEC);
+    b->err = -1;
+    if (with_err) {
+        snprintf(p, sizeof(p), "%s/err", dir);
+        b->err = open(p, O_RDONLY | O_CLOEXEC);
+    }
+    if (b->out >= 0 && (!with_err || b->err >= 0)) return 0;
+    if (b->out >= 0) close(b->out);
+    if (b->err >= 0) close(b->err);
+    return -1;
+}
+
+/* Vuelca los blobs a su destino y los cierra; retorna los bytes copiados
+   o -1 (lo ya escrito no se puede deshacer) */
+static long long blobs_replay(Blobs *b, const char *redir_file) {
+    long long a, e = 0;
+    if (redir_file) {
+        int fd = openat(wish_dirfd, redir_file, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        a = fd >= 0 ? copy_to_fd(b->out, fd) : -1;
+        if (fd >= 0) close(fd);
+    } else {
+        a = copy_to_fd(b->out, STDOUT_FILENO);
+        if (a >= 0) e = copy_to_fd(b->err, STDERR_FILENO);
+    }
+    close(b->out);
+    if (b->err >= 0) close(b->err);
+    return (a < 0 || e < 0) ? -1 : a + e;
+}
+
+/* Vuelca la salida guardada en dir; retorna los bytes copiados o -1 */
+static long long replay_output(const char *dir, const char *redir_file) {
+    Blobs b;
+    if (blobs_open(dir, !redir_file, &b) != 0) return -1;
+    return blobs_replay(&b, redir_file);
+}
+
+/* Estado guardado en <dir>/rc, o -1 si no hay uno válido */
+static int read_rc(const char *dir, int *st) {
+    char p[PATH_MAX + 16], buf[32];
+    snprintf(p, sizeof(p), "%s/rc", dir);
+    int fd = open(p, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) return -1;
+    buf[n] = '\0';
+    char *end;
+    long v = strtol(buf, &end, 10);
+    if (end == buf || (*end && *end != '\n')) return -1;
+    *st = (int)v;
+    return 0;
+}
+
+/* 1: acierto, 0: no hay entrada completa, -1: falló a mitad del volcado */
+static int replay_dir(const char *dir, const char *redir_file, int *status) {
+    int st = 0;
+    Blobs b;
+    if (read_rc(dir, &st) != 0 || blobs_open(dir, !redir_file, &b) != 0) return 0;
+
+    long long n = blobs_replay(&b, redir_file);
+    if (n < 0) return -1;
+    stats.bytes_restored += (unsigned long long)n;
+    if (status) *status = st;
+    return 1;
+}
+
+int cache_replay(const char *key, const char *redir_file, int *status) {
+    char dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s/%s", cache_root(), key);
+
+    int r = replay_dir(dir, redir_file, status);
+    if (r == 1) {
+        /* Marca de uso para el LRU */
+        char p[PATH_MAX + 16];
+        snprintf(p, sizeof(p), "%s/rc", dir);
+        utimensat(AT_FDCWD, p, NULL, 0);
+        stats.hits++;
+        return 1;
+    }
+    if (r < 0) return -1;
+    stats.misses++;
+    return 0;
+}
+
+/* --------------------- Captura y publicación --------------------- */
+
+int cache_begin(CacheJob *job, const char *key, int combined) {
+    const char *root = cache_root();
+    if (mkdir_p(root) != 0) return -1;
+
+    memcpy(job->key, key, CACHE_KEY_LEN);
+    job->combined = combined;
+    snprintf(job->tmpdir, sizeof(job->tmpdir), "%s/tmp.%ld.%u",
+             root, (long)getpid(), tmp_seq++);
+    if (mkdir(job->tmpdir, 0755) != 0) return -1;
+    return 0;
+}
+
+int cache_child_redirect(const CacheJob *job) {
+    char p[PATH_MAX + 16];
+    snprintf(p, sizeof(p), "%s/out", job->tmpdir);
+    int fo = open(p, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    snprintf(p, sizeof(p), "%s/err", job->tmpdir);
+    int fe = open(p, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fo < 0 || fe < 0) return -1;
+
+    if (dup2(fo, STDOUT_FILENO) < 0) return -1;
+    if (dup2(job->combined ? fo : fe, STDERR_FILENO) < 0) return -1;
+    close(fo);
+    close(fe);
+    return 0;
+}
+
+void cache_abort(CacheJob *job) {
+    if (job->tmpdir[0]) remove_entry(job->tmpdir);
+    job->tmpdir[0] = '\0';
+}
+
+typedef struct {
+    char name[CACHE_KEY_LEN];
+    time_t used;
+    unsigned long long size;
+} EntryInfo;
+
+static int cmp_used(const void *x, const void *y) {
+    const EntryInfo *a = x, *b = y;
+    return (a->used > b->used) - (a->used < b->used);
+}
+
+/* Desaloja las entradas menos usadas hasta quedar bajo el tope */
+static void cache_enforce_limit(void) {
+    const char *root = cache_root();
+    DIR *d = opendir(root);
+    if (!d) return;
+
+    EntryInfo *v = NULL;
+    size_t n = 0, cap = 0;
+    unsigned long long total = 0;
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        /* tmp.*, ., ..; las claves de 32 caracteres son de la versión
+           anterior (FNV): ya no se consultan, pero se desalojan */
+        size_t len = strlen(de->d_name);
+        if (len != CACHE_KEY_LEN - 1 && len != 32) continue;
+        if (n == cap) {
+            cap = cap ? cap * 2 : 64;
+            EntryInfo *nv = realloc(v, cap * sizeof(*v));
+            if (!nv) break;
+            v = nv;
+        }
+        EntryInfo *e = &v[n];
+        memcpy(e->name, de->d_name, len + 1);
+        e->size = 0;
+        e->used = 0;
+
+        static const char *names[] = { "out", "err", "rc" };
+        struct stat st;
+        char p[PATH_MAX + 16];
+        for (size_t i = 0; i < 3; i++) {
+            snprintf(p, sizeof(p), "%s/%s/%s", root, de->d_name, names[i]);
+            if (stat(p, &st) != 0) continue;
+            e->size += (unsigned long long)st.st_size;
+            if (i == 2) e->used = st.st_mtime;
+        }
+        total += e->size;
+        n++;
+    }
+    closedir(d);
+
+    unsigned long long max = cache_max_bytes();
+    if (total > max && n > 0) {
+        qsort(v, n, sizeof(*v), cmp_used);
+        char dir[PATH_MAX];
+        for (size_t i = 0; i < n && total > max; i++) {
+            snprintf(dir, sizeof(dir), "%s/%s", root, v[i].name);
+            remove_entry(dir);
+            total -= v[i].size;
+            stats.evictions++;
+        }
+    }
+    free(v);
+}
+
+int cache_commit(CacheJob *job, int status, const char *redir_file) {
+    if (!job->tmpdir[0]) return -1;
+
+    /* La salida capturada llega a su destino real aunque no se guarde */
+    int r = replay_output(job->tmpdir, redir_file) < 0 ? -1 : 0;
+
+    /* Un hijo terminado por señal no produce un resultado reutilizable */
+    if (!WIFEXITED(status)) {
+        cache_abort(job);
+        return r;
+    }
+
+    char p[PATH_MAX + 16];
+    snprintf(p, sizeof(p), "%s/rc", job->tmpdir);
+    int fd = open(p, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) { cache_abort(job); return r; }
+    int ok = dprintf(fd, "%d\n", status) > 0;
+    if (close(fd) != 0 || !ok) { cache_abort(job); return r; }
+
+    char dst[PATH_MAX];
+    snprintf(dst, sizeof(dst), "%s/%s", cache_root(), job->key);
+    if (rename(job->tmpdir, dst) != 0) {
+        /* Otra instancia publicó la misma clave primero: nos quedamos con la suya */
+        cache_abort(job);
+    } else {
+        job->tmpdir[0] = '\0';
+        stats.stores++;
+        cache_enforce_limit();
+    }
+    return r;
+}
+
+void cache_print_stats(int fd) {
+    unsigned long total = stats.hits + stats.misses;
+    dprintf(fd, "cache: %s\n", cache_root());
+    dprintf(fd, "hits: %lu  misses: %lu  hit-rate: %.1f%%\n",
+            stats.hits, stats.misses,
+            total ? 100.0 * (double)stats.hits / (double)total : 0.0);
+    dprintf(fd, "stores: %lu  evictions: %lu  bytes restored: %llu\n",
+            stats.stores, stats.evictions, stats.bytes_restored);
+}
@@ -0,0 +1,72 @@
+/*
+ * wish_cache.h – Caché de resultados direccionada por contenido (modo "cached")
+ *
+ * Sintaxis en el shell:
+ *   cached [-i archivo]... [-m archivo]... cmd args [> salida]
+ *   cached --stats
+ *
+ * La clave es el SHA-256 de: ruta resuelta del binario + mtime/tamaño/inode,
+ * argv, cwd, modo de salida y las entradas declaradas (-i: contenido,
+ * -m: tamaño + mtime). En un acierto se restauran stdout/stderr/estado
+ * de salida desde el directorio de caché sin hacer fork.
+ *
+ * Variables de entorno:
+ *   WISH_CACHE_DIR     directorio de la caché (por defecto ~/.cache/wish)
+ *   WISH_CACHE_MAX_MB  tope de tamaño con desalojo LRU (por defecto 256)
+ */
+
+#ifndef WISH_CACHE_H
+#define WISH_CACHE_H
+
+#include <limits.h>
+
+#define CACHE_KEY_LEN     65   /* 64 hex + '\0' */
+#define CACHE_MAX_INPUTS  32
+
+/* Entradas declaradas por el usuario con -i / -m, más el stdin redirigido
+   del comando ('<' por contenido, '<<<' por texto) y sus asignaciones
+   NOMBRE=valor */
+typedef struct {
+    const char *paths[CACHE_MAX_INPUTS];
+    int by_mtime[CACHE_MAX_INPUTS];   /* 1: solo tamaño+mtime, 0: contenido */
+    int count;
+    const char *stdin_file;
+    const char *stdin_text;
+    char *const *assign;
+    int nassign;
+} CacheInputs;
+
+/* Ejecución en curso (fallo de caché) cuyo resultado se guardará al terminar */
+typedef struct {
+    char key[CACHE_KEY_LEN];
+    char tmpdir[PATH_MAX];
+    int  combined;        /* 1: stdout y stderr van al mismo blob ('>') */
+} CacheJob;
+
+/* Calcula la clave. Retorna 0 si OK, -1 si no se pudo leer alguna entrada. */
+int  cache_compute_key(const char *bin, char *const argv[], int combined,
+                       const CacheInputs *in, char key[CACHE_KEY_LEN]);
+
+/* Si existe la entrada, restaura su salida (al archivo redir_file si no es
+   NULL, o a stdout/stderr) y deja el estado en *status. Retorna 1 si hubo
+   acierto, 0 si no, y -1 si el volcado falló a medias: parte de la salida
+   ya se escribió y ejecutar el comando la duplicaría. */
+int  cache_replay(const char *key, const char *redir_file, int *status);
+
+/* Prepara un directorio temporal para capturar la salida del hijo. */
+int  cache_begin(CacheJob *job, const char *key, int combined);
+
+/* En el hijo: redirige stdout/stderr hacia el directorio temporal. */
+int  cache_child_redirect(const CacheJob *job);
+
+/* En el padre, tras waitpid: entrega la salida capturada a su destino,
+   publica la entrada y aplica el tope LRU. */
+int  cache_commit(CacheJob *job, int status, const char *redir_file);
+
+/* Descarta la captura (por ejemplo si el fork falló). */
+void cache_abort(CacheJob *job);
+
+/* Escribe en fd aciertos/fallos/desalojos de la sesión (sin stdio) */
+void cache_print_stats(int fd);
+
+#endif
@@ -0,0 +1,144 @@
+/*
+ * wish_corpus.c – Lectura de corpus de tests empaquetados (.wpk) vía mmap
+ */
+
+#define _GNU_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "wish_corpus.h"
+
+const char *const corpus_part_ext[CORPUS_NPARTS] = {
+    "desc", "in", "out", "err", "rc", "run", "pre", "post", "other"
+};
+
+/* FNV-1a de 32 bits */
+uint32_t corpus_hash_name(const char *name) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        h = (h ^ *p) * 16777619u;
+    }
+    return h;
+}
+
+/* Comprueba que [off, off+len) cae dentro del archivo */
+static int in_bounds(const Corpus *c, uint64_t off, uint64_t len) {
+    return off <= c->size && len <= c->size - off;
+}
+
+static int blob_ok(const Corpus *c, const CorpusBlob *b) {
+    return in_bounds(c, b->off, b->len);
+}
+
+static int str_ok(const Corpus *c, uint32_t off) {
+    return off < c->size && memchr(c->base + off, '\0', c->size - off) != NULL;
+}
+
+/* Nombre de test: se usa como "<dir>/<nombre>.<ext>", así que no puede
+   llevar '/' ni ser "." o ".." */
+static int name_safe(const char *s) {
+    return *s && !strchr(s, '/') && strcmp(s, ".") != 0 && strcmp(s, "..") != 0;
+}
+
+/* Ruta de un auxiliar: relativa y sin componentes "..", para que al
+   desempaquetar no se salga del directorio destino */
+static int path_safe(const char *s) {
+    if (!*s || *s == '/') return 0;
+    for (const char *p = s; *p; ) {
+        size_t n = strcspn(p, "/");
+        if (n == 2 && p[0] == '.' && p[1] == '.') return 0;
+        p += n;
+        while (*p == '/') p++;
+    }
+    return 1;
+}
+
+int corpus_open(Corpus *c, const char *path) {
+    memset(c, 0, sizeof(*c));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CorpusHeader)) {
+        close(fd);
+        return -1;
+    }
+    void *m = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) return -1;
+
+    c->base = m;
+    c->size = (size_t)st.st_size;
+    c->hdr = m;
+
+    const CorpusHeader *h = c->hdr;
+    if (memcmp(h->magic, CORPUS_MAGIC, sizeof(CORPUS_MAGIC)) != 0 ||
+        h->version != CORPUS_VERSION || h->total_size != c->size ||
+        (h->hash_size & (h->hash_size - 1)) != 0 ||
+        !in_bounds(c, h->num_index_off, ((uint64_t)h->max_num + 1) * sizeof(uint32_t)) ||
+        !in_bounds(c, h->name_hash_off, (uint64_t)h->hash_size * sizeof(uint32_t)) ||
+        !in_bounds(c, h->tests_off, (uint64_t)h->ntests * sizeof(CorpusTest)) ||
+        !in_bounds(c, h->files_off, (uint64_t)h->nfiles * sizeof(CorpusFile))) {
+        corpus_close(c);
+        return -1;
+    }
+
+    c->num_index = (const uint32_t *)(c->base + h->num_index_off);
+    c->name_hash = (const uint32_t *)(c->base + h->name_hash_off);
+    c->tests     = (const CorpusTest *)(c->base + h->tests_off);
+    c->files     = (const CorpusFile *)(c->base + h->files_off);
+
+    /* Validación única al abrir: después los accesos no necesitan chequeos */
+    for (uint32_t i = 0; i < h->ntests; i++) {
+        if (!str_ok(c, c->tests[i].name_off) ||
+            !name_safe(corpus_str(c, c->tests[i].name_off))) goto bad;
+        for (int p = 0; p < CORPUS_NPARTS; p++) {
+            if (!blob_ok(c, &c->tests[i].part[p])) goto bad;
+        }
+    }
+    for (uint32_t i = 0; i < h->nfiles; i++) {
+        if (!str_ok(c, c->files[i].path_off) || !blob_ok(c, &c->files[i].data) ||
+            !path_safe(corpus_str(c, c->files[i].path_off))) goto bad;
+    }
+    for (uint32_t i = 0; i <= h->max_num; i++) {
+        if (c->num_index[i] > h->ntests) goto bad;
+    }
+    for (uint32_t i = 0; i < h->hash_size; i++) {
+        if (c->name_hash[i] > h->ntests) goto bad;
+    }
+    return 0;
+
+bad:
+    corpus_close(c);
+    return -1;
+}
+
+void corpus_close(Corpus *c) {
+    if (c->base) munmap((void *)c->base, c->size);
+    memset(c, 0, sizeof(*c));
+}
+
+const CorpusTest *corpus_find_num(const Corpus *c, uint32_t num) {
+    if (num > c->hdr->max_num) return NULL;
+    uint32_t idx = c->num_index[num];
+    return idx ? &c->tests[idx - 1] : NULL;
+}
+
+const CorpusTest *corpus_find_name(const Corpus *c, const char *name) {
+    uint32_t size = c->hdr->hash_size;
+    if (size == 0) return NULL;
+    uint32_t mask = size - 1;
+    for (uint32_t i = corpus_hash_name(name) & mask, probes = 0;
+         probes < size; i = (i + 1) & mask, probes++) {
+        uint32_t idx = c->name_hash[i];
+        if (idx == 0) return NULL;
+        const CorpusTest *t = &c->tests[idx - 1];
+        if (strcmp(corpus_str(c, t->name_off), name) == 0) return t;
+    }
+    return NULL;
+}
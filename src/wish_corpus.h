@@ -0,0 +1,102 @@
+/*
+ * wish_corpus.h – Formato empaquetado de tests (.wpk) y lector con mmap
+ *
+ * Un corpus reúne en un solo archivo todos los tests de un directorio
+ * (N.desc, N.in, N.out, N.err, N.rc, N.run, N.pre, N.post, N.other) y los
+ * archivos auxiliares (p1.sh, p2a-test/...). Distribución:
+ *
+ *   CorpusHeader
+ *   uint32_t  num_index[max_num + 1]   número de test -> índice + 1 (0 = no existe)
+ *   uint32_t  name_hash[hash_size]     tabla hash abierta por nombre -> índice + 1
+ *   CorpusTest tests[ntests]
+ *   CorpusFile files[nfiles]
+ *   strtab + blobs (alineados a 8 bytes)
+ *
+ * La búsqueda por número o por nombre es O(1) y no copia datos: los blobs
+ * se leen directamente del mapeo.
+ */
+
+#ifndef WISH_CORPUS_H
+#define WISH_CORPUS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CORPUS_MAGIC    "WISHPAK"
+#define CORPUS_VERSION  1
+
+/* Partes de un test, en el orden en que se guardan */
+enum {
+    PART_DESC, PART_IN, PART_OUT, PART_ERR, PART_RC, PART_RUN,
+    PART_PRE, PART_POST, PART_OTHER, CORPUS_NPARTS
+};
+
+extern const char *const corpus_part_ext[CORPUS_NPARTS];
+
+typedef struct {
+    uint64_t off;           /* desde el inicio del archivo */
+    uint64_t len;
+    uint32_t present;       /* 1 si el archivo existía (aunque esté vacío) */
+    uint32_t pad;
+} CorpusBlob;
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t ntests;
+    uint32_t nfiles;
+    uint32_t max_num;
+    uint32_t hash_size;     /* potencia de 2 */
+    uint32_t pad;
+    uint64_t num_index_off;
+    uint64_t name_hash_off;
+    uint64_t tests_off;
+    uint64_t files_off;
+    uint64_t total_size;
+} CorpusHeader;
+
+typedef struct {
+    uint32_t   num;         /* 0 si el nombre no es numérico */
+    uint32_t   name_off;    /* cadena terminada en '\0' */
+    CorpusBlob part[CORPUS_NPARTS];
+} CorpusTest;
+
+typedef struct {
+    uint32_t   path_off;    /* ruta relativa al directorio de tests */
+    uint32_t   mode;        /* permisos (p. ej. 0755 para los .sh); al
+                               escribirlos solo cuentan los de CORPUS_MODE_MASK */
+    CorpusBlob data;
+} CorpusFile;
+
+typedef struct {
+    const unsigned char *base;
+    size_t               size;
+    const CorpusHeader  *hdr;
+    const uint32_t      *num_index;
+    const uint32_t      *name_hash;
+    const CorpusTest    *tests;
+    const CorpusFile    *files;
+} Corpus;
+
+uint32_t corpus_hash_name(const char *name);
+
+#define CORPUS_MODE_MASK 0777    /* sin setuid/setgid/sticky */
+
+/* Mapea y valida el corpus: además de los límites, rechaza nombres de test
+   con '/' y rutas de auxiliares absolutas o con "..". Retorna 0 si OK, -1
+   si error. */
+int  corpus_open(Corpus *c, const char *path);
+void corpus_close(Corpus *c);
+
+const CorpusTest *corpus_find_num(const Corpus *c, uint32_t num);
+const CorpusTest *corpus_find_name(const Corpus *c, const char *name);
+
+static inline const char *corpus_str(const Corpus *c, uint32_t off) {
+    return (const char *)c->base + off;
+}
+
+static inline const void *corpus_blob(const Corpus *c, const CorpusBlob *b) {
+    return c->base + b->off;
+}
+
+#endif
@@ -0,0 +1,23 @@
+/*
+ * wish_dir.c – Directorio de trabajo del script en curso
+ */
+
+#define _GNU_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "wish_dir.h"
+
+int wish_dirfd = AT_FDCWD;
+
+char *wish_getcwd(char *buf, size_t size) {
+    if (wish_dirfd == AT_FDCWD) return getcwd(buf, size);
+
+    char link[64];
+    snprintf(link, sizeof(link), "/proc/self/fd/%d", wish_dirfd);
+    ssize_t n = readlink(link, buf, size - 1);
+    if (n < 0 || (size_t)n >= size - 1) return NULL;
+    buf[n] = '\0';
+    return buf;
+}
@@ -0,0 +1,20 @@
+/*
+ * wish_dir.h – Directorio de trabajo del script en curso
+ *
+ * Normalmente es AT_FDCWD y todo funciona como siempre. Con --multi cada
+ * script tiene su propio dirfd: "cd" solo cambia el del script, el padre
+ * resuelve las rutas relativas con las llamadas *at() y cada hijo hace
+ * fchdir(wish_dirfd) antes de execv. Nunca se cambia el cwd del proceso.
+ */
+
+#ifndef WISH_DIR_H
+#define WISH_DIR_H
+
+#include <stddef.h>
+
+extern int wish_dirfd;
+
+/* Equivalente a getcwd() para wish_dirfd. Retorna buf o NULL. */
+char *wish_getcwd(char *buf, size_t size);
+
+#endif
@@ -0,0 +1,360 @@
+/*
+ * wish_edit.c – Editor de línea en modo raw con autocompletado
+ */
+
+#define _GNU_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <termios.h>
+#include <sys/stat.h>
+#include "wish_edit.h"
+#include "wish_trie.h"
+#include "wish_io.h"
+
+static const char *const builtins[] = { "cd", "exit", "export", "map", "path", "set", "stats", "unset", "xbatch" };
+
+static int active;
+
+typedef struct {
+    char  *b;
+    size_t len, cap, pos;
+} Buf;
+
+/* Candidatos de un Tab; los directorios llevan '/' al final */
+typedef struct {
+    char **v;
+    int    n, cap;
+} Cands;
+
+/* --------------------- Terminal --------------------- */
+
+static void out(const char *s, size_t n) {
+    while (n > 0) {
+        ssize_t w = write(STDOUT_FILENO, s, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        s += w;
+        n -= (size_t)w;
+    }
+}
+
+static void outs(const char *s) {
+    out(s, strlen(s));
+}
+
+static int raw_on(struct termios *saved) {
+    if (tcgetattr(STDIN_FILENO, saved) != 0) return -1;
+    struct termios t = *saved;
+    /* Sin ISIG: ^C descarta la línea en lugar de matar el shell en raw */
+    t.c_lflag &= (tcflag_t)~(ICANON | ECHO | IEXTEN | ISIG);
+    t.c_iflag &= (tcflag_t)~(IXON | ICRNL | INLCR);
+    t.c_cc[VMIN] = 1;
+    t.c_cc[VTIME] = 0;
+    return tcsetattr(STDIN_FILENO, TCSADRAIN, &t);
+}
+
+static void refresh(const char *prompt, const Buf *b) {
+    outs("\r");
+    outs(prompt);
+    out(b->b, b->len);
+    outs("\x1b[K");
+    if (b->pos < b->len) {
+        char mv[32];
+        snprintf(mv, sizeof(mv), "\x1b[%zuD", b->len - b->pos);
+        outs(mv);
+    }
+}
+
+static int read_key(unsigned char *c) {
+    for (;;) {
+        ssize_t n = read(STDIN_FILENO, c, 1);
+        if (n == 1) return 0;
+        if (n < 0 && errno == EINTR) continue;
+        return -1;
+    }
+}
+
+/* --------------------- Búfer --------------------- */
+
+static int buf_insert(Buf *b, const char *s, size_t n) {
+    if (b->len + n + 2 > b->cap) {
+        size_t ncap = b->cap ? b->cap : 128;
+        while (b->len + n + 2 > ncap) ncap *= 2;
+        char *nb = realloc(b->b, ncap);
+        if (!nb) return -1;
+        b->b = nb;
+        b->cap = ncap;
+    }
+    memmove(b->b + b->pos + n, b->b + b->pos, b->len - b->pos);
+    memcpy(b->b + b->pos, s, n);
+    b->len += n;
+    b->pos += n;
+    return 0;
+}
+
+static void buf_delete(Buf *b, size_t from, size_t to) {
+    memmove(b->b + from, b->b + to, b->len - to);
+    b->len -= to - from;
+    if (b->pos > to) b->pos -= to - from;
+    else if (b->pos > from) b->pos = from;
+}
+
+/* --------------------- Autocompletado --------------------- */
+
+static int is_sep(char c) {
+    return c == ' ' || c == '\t' || c == ';' || c == '&' || c == '|' ||
+           c == '(' || c == ')' || c == '>';
+}
+
+static int cands_add(Cands *c, const char *s, size_t n) {
+    if (c->n == c->cap) {
+        int ncap = c->cap ? c->cap * 2 : 16;
+        char **nv = realloc(c->v, (size_t)ncap * sizeof(char *));
+        if (!nv) return -1;
+        c->v = nv;
+        c->cap = ncap;
+    }
+    if (!(c->v[c->n] = strndup(s, n))) return -1;
+    c->n++;
+    return 0;
+}
+
+static void cands_free(Cands *c) {
+    for (int i = 0; i < c->n; i++) free(c->v[i]);
+    free(c->v);
+}
+
+static int cmp_str(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/* Ejecutables del trie más built-ins, sin repetidos */
+static void complete_command(const char *word, Cands *c) {
+    trie_refresh();
+    char **v;
+    int n = trie_complete(word, &v);
+    for (int i = 0; i < n; i++) {
+        cands_add(c, v[i], strlen(v[i]));
+        free(v[i]);
+    }
+    free(v);
+    size_t wl = strlen(word);
+    for (size_t i = 0; i < sizeof(builtins) / sizeof(builtins[0]); i++) {
+        if (strncmp(builtins[i], word, wl) != 0) continue;
+        int dup = 0;
+        for (int k = 0; k < c->n && !dup; k++) dup = !strcmp(c->v[k], builtins[i]);
+        if (!dup) cands_add(c, builtins[i], strlen(builtins[i]));
+    }
+    qsort(c->v, (size_t)c->n, sizeof(char *), cmp_str);
+}
+
+/* Entradas de dir que empiezan por base; retorna la longitud de base */
+static size_t complete_path(const char *word, Cands *c) {
+    const char *slash = strrchr(word, '/');
+    const char *base = slash ? slash + 1 : word;
+    char dir[4096];
+    if (!slash) snprintf(dir, sizeof(dir), ".");
+    else if (slash == word) snprintf(dir, sizeof(dir), "/");
+    else snprintf(dir, sizeof(dir), "%.*s", (int)(slash - word), word);
+
+    size_t bl = strlen(base);
+    DIR *d = opendir(dir);
+    if (!d) return bl;
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        if (strncmp(de->d_name, base, bl) != 0) continue;
+        if (de->d_name[0] == '.' && base[0] != '.') continue;
+        if (!strcmp(de->d_name, ".") || !strcmp(de->d_name, "..")) continue;
+
+        int isdir = de->d_type == DT_DIR;
+        if (de->d_type == DT_UNKNOWN || de->d_type == DT_LNK) {
+            struct stat st;
+            char full[8192];
+            snprintf(full, sizeof(full), "%s/%s", dir, de->d_name);
+            isdir = stat(full, &st) == 0 && S_ISDIR(st.st_mode);
+        }
+        char name[512];
+        int l = snprintf(name, sizeof(name), "%s%s", de->d_name, isdir ? "/" : "");
+        if (l > 0 && (size_t)l < sizeof(name)) cands_add(c, name, (size_t)l);
+    }
+    closedir(d);
+    qsort(c->v, (size_t)c->n, sizeof(char *), cmp_str);
+    return bl;
+}
+
+static void complete(Buf *b, const char *prompt) {
+    size_t start = b->pos;
+    while (start > 0 && !is_sep(b->b[start - 1])) start--;
+
+    /* Posición de comando: primera palabra o tras un operador */
+    size_t k = start;
+    while (k > 0 && (b->b[k - 1] == ' ' || b->b[k - 1] == '\t')) k--;
+    int cmd_pos = k == 0 || strchr(";&|(", b->b[k - 1]) != NULL;
+
+    char *word = strndup(b->b + start, b->pos - start);
+    if (!word) return;
+    Cands c = { NULL, 0, 0 };
+    size_t have;
+    if (cmd_pos && !strchr(word, '/')) {
+        complete_command(word, &c);
+        have = strlen(word);
+    } else {
+        have = complete_path(word, &c);
+    }
+    free(word);
+
+    if (c.n == 0) {
+        outs("\a");
+    } else if (c.n == 1) {
+        const char *s = c.v[0];
+        size_t l = strlen(s);
+        buf_insert(b, s + have, l - have);
+        if (l == 0 || s[l - 1] != '/') buf_insert(b, " ", 1);
+    } else {
+        /* Prefijo común de todas las opciones */
+        size_t lcp = strlen(c.v[0]);
+        for (int i = 1; i < c.n; i++) {
+            size_t j = 0;
+            while (j < lcp && c.v[i][j] == c.v[0][j]) j++;
+            lcp = j;
+        }
+        if (lcp > have) {
+            buf_insert(b, c.v[0] + have, lcp - have);
+        } else {
+            outs("\r\n");
+            for (int i = 0; i < c.n; i++) {
+                outs(c.v[i]);
+                outs(i + 1 < c.n ? "  " : "\r\n");
+            }
+        }
+    }
+    cands_free(&c);
+    refresh(prompt, b);
+}
+
+/* --------------------- Lectura de una línea --------------------- */
+
+/* Secuencias ESC [ x / ESC [ n ~ de flechas, Inicio, Fin y Supr */
+static void escape(Buf *b) {
+    unsigned char s0, s1, s2;
+    if (read_key(&s0) < 0 || (s0 != '[' && s0 != 'O') || read_key(&s1) < 0) return;
+    if (s1 >= '0' && s1 <= '9') {
+        if (read_key(&s2) < 0 || s2 != '~') return;
+        if (s1 == '3' && b->pos < b->len) buf_delete(b, b->pos, b->pos + 1);
+        else if (s1 == '1' || s1 == '7') b->pos = 0;
+        else if (s1 == '4' || s1 == '8') b->pos = b->len;
+        return;
+    }
+    if (s1 == 'C' && b->pos < b->len) b->pos++;
+    else if (s1 == 'D' && b->pos > 0) b->pos--;
+    else if (s1 == 'H') b->pos = 0;
+    else if (s1 == 'F') b->pos = b->len;
+}
+
+static ssize_t edit_raw(char **line, size_t *cap, const char *prompt) {
+    Buf b = { NULL, 0, 0, 0 };
+    if (buf_insert(&b, "", 0) < 0) return -1;
+    outs(prompt);
+
+    for (;;) {
+        unsigned char c;
+        if (read_key(&c) < 0) {
+            free(b.b);
+            return -1;
+        }
+        if (c == '\r' || c == '\n') break;
+        switch (c) {
+        case 4:                         /* ^D */
+            if (b.len == 0) {
+                outs("\r\n");
+                free(b.b);
+                return -1;
+            }
+            if (b.pos < b.len) buf_delete(&b, b.pos, b.pos + 1);
+            break;
+        case 3:                         /* ^C */
+            outs("^C\r\n");
+            b.len = b.pos = 0;
+            break;
+        case '\t':
+            complete(&b, prompt);
+            continue;
+        case 127:
+        case 8:
+            if (b.pos > 0) buf_delete(&b, b.pos - 1, b.pos);
+            break;
+        case 1:  b.pos = 0; break;      /* ^A */
+        case 5:  b.pos = b.len; break;  /* ^E */
+        case 2:  if (b.pos > 0) b.pos--; break;
+        case 6:  if (b.pos < b.len) b.pos++; break;
+        case 11: b.len = b.pos; break;  /* ^K */
+        case 21: buf_delete(&b, 0, b.pos); break;
+        case 23: {                      /* ^W */
+            size_t k = b.pos;
+            while (k > 0 && b.b[k - 1] == ' ') k--;
+            while (k > 0 && b.b[k - 1] != ' ') k--;
+            buf_delete(&b, k, b.pos);
+            break;
+        }
+        case 27:
+            escape(&b);
+            break;
+        default:
+            if (c >= 32) buf_insert(&b, (const char *)&c, 1);
+            break;
+        }
+        refresh(prompt, &b);
+    }
+    outs("\r\n");
+
+    /* Mismo contrato que getline: '\n' final y terminador */
+    if (*cap < b.len + 2) {
+        char *nl = realloc(*line, b.len + 2);
+        if (!nl) {
+            free(b.b);
+            return -1;
+        }
+        *line = nl;
+        *cap = b.len + 2;
+    }
+    memcpy(*line, b.b, b.len);
+    (*line)[b.len] = '\n';
+    (*line)[b.len + 1] = '\0';
+    free(b.b);
+    return (ssize_t)b.len + 1;
+}
+
+/* --------------------- Interfaz --------------------- */
+
+void edit_init(int interactive) {
+    const char *term = getenv("TERM");
+    active = interactive && isatty(STDIN_FILENO) && isatty(STDOUT_FILENO) &&
+             !(term && !strcmp(term, "dumb"));
+}
+
+ssize_t edit_getline(char **line, size_t *cap, const char *prompt) {
+    struct termios saved;
+    if (!active || raw_on(&saved) != 0) {
+        io_puts(STDOUT_FILENO, prompt);
+        return lr_getline(&io_stdin, line, cap);
+    }
+    ssize_t n = edit_raw(line, cap, prompt);
+    /* Los hijos deben heredar la terminal en modo normal */
+    tcsetattr(STDIN_FILENO, TCSADRAIN, &saved);
+    return n;
+}
+
+void edit_path_changed(char *const *dirs, int n) {
+    if (active) trie_set_path(dirs, n);
+}
+
+void edit_cleanup(void) {
+    if (active) trie_clear();
+}
@@ -0,0 +1,33 @@
+/*
+ * wish_edit.h – Editor de línea del modo interactivo con autocompletado
+ *
+ * Solo se activa si el modo es interactivo y stdin es una terminal; en otro
+ * caso edit_getline escribe el prompt y lee la línea con io_stdin
+ * (wish_io.h).
+ *
+ * Teclas: flechas izquierda/derecha, Inicio/Fin (también ^A/^E), Retroceso,
+ * Supr, ^U/^K (borrar hasta el inicio/fin), ^W (palabra anterior), ^C
+ * (descartar la línea), ^D en línea vacía (fin) y Tab. Tab completa nombres
+ * de comando desde el trie de ejecutables (wish_trie.h) más los built-ins,
+ * y rutas con una lectura del directorio. Con varias opciones extiende el
+ * prefijo común y, si no hay nada que extender, las lista.
+ */
+
+#ifndef WISH_EDIT_H
+#define WISH_EDIT_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/* Decide si el editor se usa (interactive y stdin es una terminal) */
+void    edit_init(int interactive);
+
+/* Lee una línea (incluido el '\n' final, como getline). -1 en EOF. */
+ssize_t edit_getline(char **line, size_t *cap, const char *prompt);
+
+/* Avisa de que el PathList cambió; sin editor activo no hace nada */
+void    edit_path_changed(char *const *dirs, int n);
+
+void    edit_cleanup(void);
+
+#endif
@@ -0,0 +1,115 @@
+/*
+ * wish_env.c – Vector de entorno mantenido de forma incremental
+ */
+
+#define _GNU_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <string.h>
+#include "wish_env.h"
+
+/* Longitud del nombre en "NOMBRE=valor" (o de la cadena si no hay '=') */
+static size_t name_len(const char *s) {
+    return strcspn(s, "=");
+}
+
+/* Índice de la variable cuyo nombre son los len primeros bytes de name */
+static int find(const Env *e, const char *name, size_t len) {
+    for (int i = 0; i < e->count; i++) {
+        if (!strncmp(e->vec[i], name, len) && e->vec[i][len] == '=') return i;
+    }
+    return -1;
+}
+
+static int reserve(Env *e, int n) {
+    if (n + 1 <= e->cap) return 0;
+    int ncap = e->cap ? e->cap : 32;
+    while (ncap < n + 1) ncap *= 2;
+    char **nv = realloc(e->vec, (size_t)ncap * sizeof(char *));
+    if (!nv) return -1;
+    e->vec = nv;
+    e->cap = ncap;
+    return 0;
+}
+
+int env_init(Env *e, char *const *from) {
+    memset(e, 0, sizeof(*e));
+    if (reserve(e, 0) < 0) return -1;
+    e->vec[0] = NULL;
+    for (int i = 0; from && from[i]; i++) {
+        if (!strchr(from[i], '=')) continue;
+        if (env_set(e, from[i]) < 0) return -1;
+    }
+    return 0;
+}
+
+void env_free(Env *e) {
+    for (int i = 0; i < e->count; i++) free(e->vec[i]);
+    free(e->vec);
+    memset(e, 0, sizeof(*e));
+}
+
+int env_valid_name(const char *name) {
+    size_t len = name_len(name);
+    if (len == 0 || (name[0] >= '0' && name[0] <= '9')) return 0;
+    for (size_t i = 0; i < len; i++) {
+        char c = name[i];
+        if (!(c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+              (c >= '0' && c <= '9'))) return 0;
+    }
+    return 1;
+}
+
+int env_is_assignment(const char *w) {
+    return strchr(w, '=') != NULL && env_valid_name(w);
+}
+
+int env_set(Env *e, const char *assign) {
+    char *s = strdup(assign);
+    if (!s) return -1;
+    int i = find(e, assign, name_len(assign));
+    if (i >= 0) {
+        free(e->vec[i]);
+        e->vec[i] = s;
+        return 0;
+    }
+    if (reserve(e, e->count + 1) < 0) {
+        free(s);
+        return -1;
+    }
+    e->vec[e->count++] = s;
+    e->vec[e->count] = NULL;
+    return 0;
+}
+
+void env_unset(Env *e, const char *name) {
+    int i = find(e, name, strlen(name));
+    if (i < 0) return;
+    /* El orden del entorno no importa: el último ocupa el hueco */
+    free(e->vec[i]);
+    e->vec[i] = e->vec[--e->count];
+    e->vec[e->count] = NULL;
+}
+
+const char *env_get(const Env *e, const char *name) {
+    size_t len = strlen(name);
+    int i = find(e, name, len);
+    return i >= 0 ? e->vec[i] + len + 1 : NULL;
+}
+
+char **env_overlay(const Env *e, char *const *assign, int n) {
+    if (n == 0) return e->vec;
+    char **v = malloc((size_t)(e->count + n + 1) * sizeof(char *));
+    if (!v) return NULL;
+    memcpy(v, e->vec, (size_t)e->count * sizeof(char *));
+    int count = e->count;
+    for (int k = 0; k < n; k++) {
+        size_t len = name_len(assign[k]);
+        int i = 0;
+        while (i < count && !(strncmp(v[i], assign[k], len) == 0 && v[i][len] == '=')) i++;
+        v[i] = assign[k];
+        if (i == count) count++;
+    }
+    v[count] = NULL;
+    return v;
+}
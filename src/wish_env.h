@@ -0,0 +1,45 @@
+/*
+ * wish_env.h – Entorno de los comandos externos
+ *
+ * El shell guarda el entorno como el vector "NOMBRE=valor" terminado en
+ * NULL que recibe execve, y lo mantiene al día en cada export/unset: al
+ * lanzar un comando el hijo usa ese mismo vector, sin copiarlo. Solo un
+ * comando con asignaciones propias ("A=1 B=2 cmd") necesita uno distinto,
+ * y se arma en el padre copiando punteros, no cadenas.
+ *
+ * Con --multi cada script tiene su Env, igual que su PathList.
+ */
+
+#ifndef WISH_ENV_H
+#define WISH_ENV_H
+
+typedef struct {
+    char **vec;         /* cadenas propias; vec[count] == NULL */
+    int    count, cap;
+} Env;
+
+/* Copia el entorno from (normalmente environ). Retorna 0 o -1. */
+int    env_init(Env *e, char *const *from);
+void   env_free(Env *e);
+
+/* 1 si name es un nombre válido ([A-Za-z_][A-Za-z0-9_]*) hasta '=' o '\0' */
+int    env_valid_name(const char *name);
+
+/* 1 si w tiene la forma NOMBRE=valor */
+int    env_is_assignment(const char *w);
+
+/* Define o reemplaza con "NOMBRE=valor". Retorna 0 o -1. */
+int    env_set(Env *e, const char *assign);
+
+/* Quita NOMBRE (no es error si no existe) */
+void   env_unset(Env *e, const char *name);
+
+/* Valor de NOMBRE o NULL */
+const char *env_get(const Env *e, const char *name);
+
+/* envp de un comando con n asignaciones propias: si n == 0 es e->vec; si
+   no, un vector nuevo de punteros (a e->vec y a assign) que el llamador
+   libera con free() cuando ya hizo fork. NULL si no hay memoria. */
+char **env_overlay(const Env *e, char *const *assign, int n);
+
+#endif
@@ -0,0 +1,202 @@
+/*
+ * wish_fanout.c – Reparto de una tubería a varios archivos con tee/splice
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include "wish_fanout.h"
+#include "wish_dir.h"
+
+#define FAN_CHUNK (1 << 20)     /* tope por vuelta; lo limita la tubería */
+
+struct Fanout {
+    pthread_t thread;
+    int       src;              /* lectura de la tubería del hijo */
+    int       n;
+    int      *out;              /* destinos */
+    int      *mid;              /* mid[2*i], mid[2*i+1]: tubería del destino i */
+    char     *dead;             /* destino que ya falló: no recibe más */
+    int       failed;
+};
+
+/* Copia len bytes de in a out pasando por memoria (destinos sin splice,
+   p. ej. una terminal). Retorna lo que quedó sin escribir. */
+static size_t copy_out(int in, int out, size_t len) {
+    char buf[65536];
+    while (len > 0) {
+        ssize_t r = read(in, buf, len < sizeof(buf) ? len : sizeof(buf));
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return len;
+        for (ssize_t off = 0; off < r; ) {
+            ssize_t w = write(out, buf + off, (size_t)(r - off));
+            if (w < 0 && errno == EINTR) continue;
+            if (w <= 0) return len;
+            off += w;
+        }
+        len -= (size_t)r;
+    }
+    return 0;
+}
+
+/* Mueve exactamente len bytes de la tubería in a out. Retorna lo que quedó
+   sin mover (0 si todo fue bien). */
+static size_t drain(int in, int out, size_t len) {
+    while (len > 0) {
+        ssize_t k = splice(in, NULL, out, NULL, len, SPLICE_F_MOVE);
+        if (k < 0 && errno == EINTR) continue;
+        if (k < 0 && errno == EINVAL) return copy_out(in, out, len);
+        if (k <= 0) return len;
+        len -= (size_t)k;
+    }
+    return 0;
+}
+
+/* Mueve lo que haya en la tubería in (esperando si está vacía) a out.
+   Retorna los bytes movidos, 0 en EOF o -1 si out falló. */
+static ssize_t move_some(int in, int out) {
+    for (;;) {
+        ssize_t k = splice(in, NULL, out, NULL, FAN_CHUNK, SPLICE_F_MOVE);
+        if (k >= 0) return k;
+        if (errno == EINTR) continue;
+        if (errno != EINVAL) return -1;
+        int avail = 0;
+        if (ioctl(in, FIONREAD, &avail) != 0 || avail <= 0) avail = 1;
+        return copy_out(in, out, (size_t)avail) == 0 ? avail : -1;
+    }
+}
+
+/* Descarta len bytes de la tubería (el destino que debía consumirlos falló) */
+static void discard(int in, size_t len) {
+    char buf[65536];
+    while (len > 0) {
+        ssize_t r = read(in, buf, len < sizeof(buf) ? len : sizeof(buf));
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return;
+        len -= (size_t)r;
+    }
+}
+
+static void mark_dead(Fanout *f, int i) {
+    f->dead[i] = 1;
+    f->failed = 1;
+}
+
+/* En cada vuelta los destinos vivos salvo el último reciben una copia con
+   tee y el último consume la tubería original. Sin destinos vivos se sigue
+   leyendo para que el hijo no se quede bloqueado. */
+static void *pump(void *arg) {
+    Fanout *f = arg;
+    for (;;) {
+        int last = f->n - 1;
+        while (last >= 0 && f->dead[last]) last--;
+        if (last < 0) {
+            char buf[65536];
+            ssize_t r = read(f->src, buf, sizeof(buf));
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) break;
+            continue;
+        }
+
+        /* El primer tee fija el tamaño de la vuelta; espera a que haya datos */
+        ssize_t len = -1;
+        for (int i = 0; i < last; i++) {
+            if (f->dead[i]) continue;
+            ssize_t k;
+            do {
+                k = tee(f->src, f->mid[2 * i + 1], len < 0 ? FAN_CHUNK : (size_t)len, 0);
+            } while (k < 0 && errno == EINTR);
+            if (k < 0 || (len >= 0 && k != len)) {
+                mark_dead(f, i);
+                continue;
+            }
+            if (len < 0) len = k;
+            if (len == 0) break;
+            if (drain(f->mid[2 * i], f->out[i], (size_t)k) != 0) mark_dead(f, i);
+        }
+
+        if (len < 0) {
+            /* Solo queda un destino: se le pasa lo que haya */
+            ssize_t k = move_some(f->src, f->out[last]);
+            if (k == 0) break;
+            if (k < 0) mark_dead(f, last);
+            continue;
+        }
+        if (len == 0) break;
+        size_t left = drain(f->src, f->out[last], (size_t)len);
+        if (left) {
+            mark_dead(f, last);
+            discard(f->src, left);
+        }
+    }
+    return NULL;
+}
+
+static void fan_close(Fanout *f) {
+    for (int i = 0; i < f->n; i++) {
+        if (f->out[i] >= 0) close(f->out[i]);
+        if (f->mid[2 * i] >= 0) close(f->mid[2 * i]);
+        if (f->mid[2 * i + 1] >= 0) close(f->mid[2 * i + 1]);
+    }
+    if (f->src >= 0) close(f->src);
+    free(f->out);
+    free(f->mid);
+    free(f->dead);
+    free(f);
+}
+
+Fanout *fanout_open(char *const *targets, int n, int *write_fd) {
+    Fanout *f = calloc(1, sizeof(*f));
+    if (!f) return NULL;
+    f->n = n;
+    f->src = -1;
+    f->out = malloc((size_t)n * sizeof(int));
+    f->mid = malloc((size_t)n * 2 * sizeof(int));
+    f->dead = calloc((size_t)n, 1);
+    if (!f->out || !f->mid || !f->dead) {
+        free(f->out);
+        free(f->mid);
+        free(f->dead);
+        free(f);
+        return NULL;
+    }
+    for (int i = 0; i < n; i++) f->out[i] = f->mid[2 * i] = f->mid[2 * i + 1] = -1;
+
+    int p[2];
+    if (pipe2(p, O_CLOEXEC) != 0) {
+        fan_close(f);
+        return NULL;
+    }
+    f->src = p[0];
+    int size = fcntl(p[0], F_GETPIPE_SZ);
+    for (int i = 0; i < n; i++) {
+        f->out[i] = openat(wish_dirfd, targets[i], O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        if (f->out[i] < 0) goto fail;
+        /* El último consume el original; los demás necesitan su tubería, al
+           menos tan grande como la del hijo para que tee copie la vuelta
+           entera */
+        if (i == n - 1) continue;
+        if (pipe2(f->mid + 2 * i, O_CLOEXEC) != 0) goto fail;
+        if (size > 0 && fcntl(f->mid[2 * i + 1], F_SETPIPE_SZ, size) < 0) goto fail;
+    }
+    if (pthread_create(&f->thread, NULL, pump, f) != 0) goto fail;
+    *write_fd = p[1];
+    return f;
+
+fail:
+    close(p[1]);
+    fan_close(f);
+    return NULL;
+}
+
+int fanout_finish(Fanout *f) {
+    pthread_join(f->thread, NULL);
+    int rc = f->failed ? -1 : 0;
+    fan_close(f);
+    return rc;
+}
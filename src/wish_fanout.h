@@ -0,0 +1,32 @@
+/*
+ * wish_fanout.h – La salida de un comando a varios archivos ('>+')
+ *
+ * "cmd >+ a b c": el hijo escribe stdout y stderr en una tubería y un hilo
+ * del shell reparte lo que llega a todos los destinos sin pasar por
+ * memoria de usuario: tee(2) duplica el contenido de la tubería en una
+ * tubería intermedia por destino (sin consumirlo) y splice(2) lo mueve de
+ * cada una a su archivo; el último destino se lleva el original.
+ *
+ * La contrapresión es la de la tubería: si un destino es lento el hilo se
+ * bloquea en splice, la tubería se llena y el hijo se bloquea en write.
+ * El comando no termina para el planificador hasta que el hilo vació la
+ * tubería, así que lo que venga después en la línea ve los archivos
+ * completos. Si falla la escritura en algún destino el comando termina
+ * con 1 aunque el hijo haya terminado bien.
+ */
+
+#ifndef WISH_FANOUT_H
+#define WISH_FANOUT_H
+
+typedef struct Fanout Fanout;
+
+/* Abre los n destinos (relativos a wish_dirfd, truncándolos) y arranca el
+   hilo. *write_fd recibe el extremo de escritura para el hijo (O_CLOEXEC);
+   el llamador lo cierra en cuanto hizo fork. NULL si algo falló. */
+Fanout *fanout_open(char *const *targets, int n, int *write_fd);
+
+/* Espera a que la tubería se vacíe (todos los escritores la cerraron) y
+   libera todo. Retorna 0, o -1 si algún destino no recibió la salida. */
+int     fanout_finish(Fanout *f);
+
+#endif
@@ -15,9 +15,13 @@
 
 
 #define TESTS_DIR "./tests_unpacked/tests"
+#define DEFAULT_BIN "../bin/wish"
 #define MAX_TESTS 22
 #define BUF_SIZE 1024
 
+// Binario del shell a probar (argv[1] o DEFAULT_BIN)
+static const char *bin = DEFAULT_BIN;
+
 // Leer el contenido completo de un archivo
 char *read_file(const char *path) {
     FILE *fp = fopen(path, "r");
@@ -89,7 +93,7 @@ int run_test(int num) {
         close(fd_in);
 
         // Ejecutar el shell
-        execlp("../bin/wish", "../bin/wish", NULL);
+        execlp(bin, bin, NULL);
         perror("Error ejecutando wish");
         exit(1);
     } else if (pid > 0) {
@@ -117,9 +121,16 @@ int run_test(int num) {
     return (ok_out && ok_err);
 }
 
-int main(void) {
+// Uso: wish_final [binario]
+int main(int argc, char *argv[]) {
+    if (argc > 2) {
+        fprintf(stderr, "uso: %s [binario]\n", argv[0]);
+        return 2;
+    }
+    if (argc == 2) bin = argv[1];
+
     printf("====================================\n");
-    printf("🧪 Laboratorio SO — Test Runner Wish\n");
+    printf("🧪 Laboratorio SO — Test Runner Wish (%s)\n", bin);
     printf("====================================\n");
 
     int passed = 0;
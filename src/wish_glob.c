@@ -0,0 +1,188 @@
+/*
+ * wish_glob.c – Expansión de comodines con listados de directorio en caché
+ */
+
+#define _GNU_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include "wish_glob.h"
+#include "wish_dir.h"
+
+#define GLOB_CACHE_DIRS 64
+
+/* Registro que devuelve el kernel en getdents64 */
+struct linux_dirent64 {
+    uint64_t       d_ino;
+    int64_t        d_off;
+    unsigned short d_reclen;
+    unsigned char  d_type;
+    char           d_name[];
+};
+
+typedef struct {
+    dev_t  dev;
+    ino_t  ino;
+    struct timespec mtime;
+    time_t scanned;          /* segundo en que se leyó */
+    unsigned long line;      /* generación de línea del escaneo */
+    unsigned long used;      /* para desalojo LRU */
+    char  *names;            /* nombres separados por '\0' */
+    char **index;            /* punteros dentro de names */
+    int    count;
+} DirListing;
+
+static DirListing cache[GLOB_CACHE_DIRS];
+static unsigned long line_gen = 1, use_clock;
+
+int glob_has_magic(const char *s) {
+    return strpbrk(s, "*?[") != NULL;
+}
+
+void glob_new_line(void) {
+    line_gen++;
+}
+
+static void listing_free(DirListing *d) {
+    free(d->names);
+    free(d->index);
+    memset(d, 0, sizeof(*d));
+}
+
+void glob_cache_clear(void) {
+    for (int i = 0; i < GLOB_CACHE_DIRS; i++) listing_free(&cache[i]);
+}
+
+/* Lee todos los nombres del directorio con getdents64 */
+static int scan_dir(const char *dir, DirListing *d) {
+    int fd = openat(wish_dirfd, dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return -1;
+
+    size_t cap = 4096, len = 0;
+    char *names = malloc(cap);
+    int count = 0;
+    char buf[32768];
+    long n;
+    while (names && (n = syscall(SYS_getdents64, fd, buf, sizeof(buf))) > 0) {
+        for (long off = 0; off < n; ) {
+            struct linux_dirent64 *de = (struct linux_dirent64 *)(buf + off);
+            off += de->d_reclen;
+            if (!strcmp(de->d_name, ".") || !strcmp(de->d_name, "..")) continue;
+            size_t l = strlen(de->d_name) + 1;
+            if (len + l > cap) {
+                while (len + l > cap) cap *= 2;
+                char *nn = realloc(names, cap);
+                if (!nn) { free(names); names = NULL; break; }
+                names = nn;
+            }
+            memcpy(names + len, de->d_name, l);
+            len += l;
+            count++;
+        }
+    }
+    close(fd);
+    if (!names) return -1;
+
+    char **index = malloc((size_t)(count ? count : 1) * sizeof(char *));
+    if (!index) { free(names); return -1; }
+    char *p = names;
+    for (int i = 0; i < count; i++) {
+        index[i] = p;
+        p += strlen(p) + 1;
+    }
+    d->names = names;
+    d->index = index;
+    d->count = count;
+    return 0;
+}
+
+/* Listado de dir, desde la caché si sigue siendo válido */
+static DirListing *get_listing(const char *dir) {
+    struct stat st;
+    if (fstatat(wish_dirfd, dir, &st, 0) != 0 || !S_ISDIR(st.st_mode)) return NULL;
+
+    DirListing *slot = &cache[0];
+    for (int i = 0; i < GLOB_CACHE_DIRS; i++) {
+        DirListing *d = &cache[i];
+        if (d->names && d->dev == st.st_dev && d->ino == st.st_ino) {
+            int same_mtime = d->mtime.tv_sec == st.st_mtim.tv_sec &&
+                             d->mtime.tv_nsec == st.st_mtim.tv_nsec;
+            int stable = st.st_mtim.tv_sec < d->scanned;
+            if (d->line == line_gen || (same_mtime && stable)) {
+                d->used = ++use_clock;
+                return d;
+            }
+            slot = d;       /* obsoleto: se vuelve a leer en el mismo hueco */
+            goto rescan;
+        }
+        if (!d->names) slot = d;
+        else if (slot->names && d->used < slot->used) slot = d;
+    }
+
+rescan:
+    listing_free(slot);
+    if (scan_dir(dir, slot) != 0) return NULL;
+    slot->dev = st.st_dev;
+    slot->ino = st.st_ino;
+    slot->mtime = st.st_mtim;
+    slot->scanned = time(NULL);
+    slot->line = line_gen;
+    slot->used = ++use_clock;
+    return slot;
+}
+
+static int cmp_str(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+int glob_expand(const char *pattern, char ***out) {
+    *out = NULL;
+
+    /* Separar directorio (literal) y patrón del último componente */
+    const char *slash = strrchr(pattern, '/');
+    const char *base = slash ? slash + 1 : pattern;
+    char dir[4096];
+    if (!slash) snprintf(dir, sizeof(dir), ".");
+    else if (slash == pattern) snprintf(dir, sizeof(dir), "/");
+    else snprintf(dir, sizeof(dir), "%.*s", (int)(slash - pattern), pattern);
+    size_t prefix_len = slash ? (size_t)(base - pattern) : 0;
+
+    if (!glob_has_magic(base)) return 0;
+
+    DirListing *d = get_listing(dir);
+    if (!d) return 0;
+
+    char **v = NULL;
+    int n = 0, cap = 0;
+    for (int i = 0; i < d->count; i++) {
+        if (fnmatch(base, d->index[i], FNM_PERIOD) != 0) continue;
+        if (n == cap) {
+            cap = cap ? cap * 2 : 16;
+            char **nv = realloc(v, (size_t)cap * sizeof(*v));
+            if (!nv) goto fail;
+            v = nv;
+        }
+        size_t l = strlen(d->index[i]);
+        char *s = malloc(prefix_len + l + 1);
+        if (!s) goto fail;
+        memcpy(s, pattern, prefix_len);
+        memcpy(s + prefix_len, d->index[i], l + 1);
+        v[n++] = s;
+    }
+    if (n > 1) qsort(v, (size_t)n, sizeof(*v), cmp_str);
+    *out = v;
+    return n;
+
+fail:
+    for (int i = 0; i < n; i++) free(v[i]);
+    free(v);
+    return -1;
+}
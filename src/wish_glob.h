@@ -0,0 +1,30 @@
+/*
+ * wish_glob.h – Expansión de comodines (*, ?, [...]) con caché de directorios
+ *
+ * El patrón se aplica solo al último componente de la ruta (en "logs/a?.log"
+ * se expande "a?.log"); los componentes anteriores se toman literalmente.
+ * Si no hay coincidencias el argumento se deja tal cual, como hace sh.
+ *
+ * Los listados se leen con getdents64 y se guardan por (dev, inode):
+ * dentro de la misma línea se reutilizan siempre; entre líneas solo si el
+ * mtime del directorio no cambió y ya era "estable" (de un segundo anterior
+ * al del escaneo), para no perder archivos creados en el mismo tick.
+ */
+
+#ifndef WISH_GLOB_H
+#define WISH_GLOB_H
+
+/* 1 si el token contiene *, ? o [ */
+int  glob_has_magic(const char *s);
+
+/* Expande pattern. En *out deja un vector de cadenas (malloc) ordenado.
+   Retorna el número de coincidencias (0 = ninguna) o -1 si error. */
+int  glob_expand(const char *pattern, char ***out);
+
+/* Marca el inicio de una nueva línea (invalida la validez "por línea") */
+void glob_new_line(void);
+
+/* Libera todos los listados guardados */
+void glob_cache_clear(void);
+
+#endif
@@ -0,0 +1,88 @@
+/*
+ * wish_io.c – Lectura de líneas con read(2) y escritura con write(2)
+ */
+
+#define _GNU_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "wish_io.h"
+
+#define IO_CHUNK 65536
+
+LineReader io_stdin = { STDIN_FILENO, NULL, 0, 0, 0 };
+
+void lr_init(LineReader *r, int fd) {
+    memset(r, 0, sizeof(*r));
+    r->fd = fd;
+}
+
+void lr_free(LineReader *r) {
+    free(r->buf);
+    r->buf = NULL;
+    r->len = r->pos = r->cap = 0;
+}
+
+/* Lee otro bloque al final del búfer. Retorna lo leído, 0 en EOF o -1. */
+static ssize_t fill(LineReader *r) {
+    if (r->pos > 0) {
+        /* Lo ya entregado deja sitio al principio */
+        memmove(r->buf, r->buf + r->pos, r->len - r->pos);
+        r->len -= r->pos;
+        r->pos = 0;
+    }
+    if (r->cap - r->len < IO_CHUNK / 2) {
+        size_t ncap = r->cap ? r->cap * 2 : IO_CHUNK;
+        char *nb = realloc(r->buf, ncap);
+        if (!nb) return -1;
+        r->buf = nb;
+        r->cap = ncap;
+    }
+    for (;;) {
+        ssize_t n = read(r->fd, r->buf + r->len, r->cap - r->len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n > 0) r->len += (size_t)n;
+        return n;
+    }
+}
+
+ssize_t lr_getline(LineReader *r, char **line, size_t *cap) {
+    size_t scanned = 0;
+    char *nl;
+    while (!(nl = memchr(r->buf + r->pos + scanned, '\n', r->len - r->pos - scanned))) {
+        scanned = r->len - r->pos;
+        if (fill(r) <= 0) {
+            /* EOF: lo que quede es la última línea, sin '\n' */
+            if (r->len == r->pos) return -1;
+            nl = r->buf + r->len - 1;
+            break;
+        }
+    }
+
+    size_t n = (size_t)(nl - (r->buf + r->pos)) + 1;
+    if (*cap < n + 1) {
+        char *nb = realloc(*line, n + 1);
+        if (!nb) return -1;
+        *line = nb;
+        *cap = n + 1;
+    }
+    memcpy(*line, r->buf + r->pos, n);
+    (*line)[n] = '\0';
+    r->pos += n;
+    return (ssize_t)n;
+}
+
+void io_puts(int fd, const char *s) {
+    size_t len = strlen(s);
+    while (len > 0) {
+        ssize_t n = write(fd, s, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        s += n;
+        len -= (size_t)n;
+    }
+}
@@ -0,0 +1,38 @@
+/*
+ * wish_io.h – Lectura de líneas y escritura sin stdio
+ *
+ * El shell lee los scripts, stdin y las listas de map con read(2) sobre un
+ * búfer propio y escribe el prompt y los mensajes con write(2): ninguna
+ * ruta de arranque ni de ejecución de líneas toca un FILE. Así el binario
+ * estático (make wish-static) arranca sin inicializar stdio y la salida
+ * del shell nunca queda retenida en un búfer que los hijos no ven.
+ */
+
+#ifndef WISH_IO_H
+#define WISH_IO_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+typedef struct {
+    int    fd;
+    char  *buf;
+    size_t len, pos, cap;   /* datos válidos en buf[pos, len) */
+} LineReader;
+
+/* Lector de stdin compartido por el modo interactivo y "map" sin -i, para
+   que ninguno se quede con datos que le tocan al otro */
+extern LineReader io_stdin;
+
+void    lr_init(LineReader *r, int fd);
+void    lr_free(LineReader *r);         /* no cierra fd */
+
+/* Mismo contrato que getline: la línea incluye el '\n' (salvo la última
+   de un archivo que no lo tiene) y va terminada en '\0'. -1 en EOF. Un
+   EOF no es definitivo: en una terminal se puede seguir leyendo. */
+ssize_t lr_getline(LineReader *r, char **line, size_t *cap);
+
+/* write(2) completo de una cadena */
+void    io_puts(int fd, const char *s);
+
+#endif
@@ -0,0 +1,359 @@
+/*
+ * wish_journal.c – Diario de progreso con group commit en un hilo aparte
+ */
+
+#define _GNU_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "wish_journal.h"
+
+static int             jfd = -1;
+static pthread_t       flusher;
+static pthread_mutex_t mu = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  cv = PTHREAD_COND_INITIALIZER;
+static char           *pend;            /* registros aún no escritos */
+static size_t          pend_len, pend_cap;
+static int             stopping;
+static int             idle;            /* el hilo espera trabajo */
+static uint64_t        last_path_hash;
+static int             have_path;
+static uint64_t        last_env_hash;
+static int             have_env;
+
+/* --------------------- Utilidades --------------------- */
+
+static uint32_t fnv32(const void *data, size_t len) {
+    uint32_t h = 2166136261u;
+    const unsigned char *p = data;
+    for (size_t i = 0; i < len; i++) h = (h ^ p[i]) * 16777619u;
+    return h;
+}
+
+static uint64_t strv_hash(char *const *dirs, int n) {
+    uint64_t h = 14695981039346656037ull;
+    for (int i = 0; i < n; i++) {
+        for (const unsigned char *p = (const unsigned char *)dirs[i]; ; p++) {
+            h = (h ^ *p) * 1099511628211ull;
+            if (!*p) break;
+        }
+    }
+    return h;
+}
+
+/* Tamaño y hash FNV-1a del contenido de un archivo; -1 si no se lee */
+static int file_id(const char *file, uint64_t id[2]) {
+    int fd = open(file, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    uint64_t size = 0, h = 14695981039346656037ull;
+    char buf[65536];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            close(fd);
+            return -1;
+        }
+        for (ssize_t i = 0; i < n; i++) h = (h ^ (unsigned char)buf[i]) * 1099511628211ull;
+        size += (uint64_t)n;
+    }
+    close(fd);
+    id[0] = size;
+    id[1] = h;
+    return 0;
+}
+
+static int write_all(int fd, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* --------------------- Escritura (group commit) --------------------- */
+
+static void *flush_loop(void *arg) {
+    (void)arg;
+    char *batch = NULL;
+    size_t batch_cap = 0;
+
+    pthread_mutex_lock(&mu);
+    for (;;) {
+        while (pend_len == 0 && !stopping) {
+            idle = 1;
+            pthread_cond_wait(&cv, &mu);
+            idle = 0;
+        }
+        if (pend_len == 0) break;
+
+        /* Intercambio de búferes: el shell sigue añadiendo mientras tanto */
+        char *tmp = pend;
+        size_t len = pend_len, cap = pend_cap;
+        pend = batch;
+        pend_cap = batch_cap;
+        pend_len = 0;
+        batch = tmp;
+        batch_cap = cap;
+        pthread_mutex_unlock(&mu);
+
+        if (write_all(jfd, batch, len) == 0) fdatasync(jfd);
+
+        pthread_mutex_lock(&mu);
+    }
+    pthread_mutex_unlock(&mu);
+    free(batch);
+    return NULL;
+}
+
+/* Añade un registro al búfer pendiente */
+static void append(uint32_t type, const void *a, size_t alen, const void *b, size_t blen) {
+    char *payload = malloc(alen + blen ? alen + blen : 1);
+    if (!payload) return;
+    memcpy(payload, a, alen);
+    if (blen) memcpy(payload + alen, b, blen);
+    JournalRec r = { JOURNAL_MAGIC, type, (uint32_t)(alen + blen), 0 };
+    r.sum = fnv32(payload, alen + blen) ^ type;
+
+    pthread_mutex_lock(&mu);
+    size_t need = pend_len + sizeof(r) + alen + blen;
+    if (need > pend_cap) {
+        size_t ncap = pend_cap ? pend_cap : 4096;
+        while (ncap < need) ncap *= 2;
+        char *np = realloc(pend, ncap);
+        if (!np) {
+            pthread_mutex_unlock(&mu);
+            free(payload);
+            return;
+        }
+        pend = np;
+        pend_cap = ncap;
+    }
+    memcpy(pend + pend_len, &r, sizeof(r));
+    memcpy(pend + pend_len + sizeof(r), payload, alen + blen);
+    pend_len = need;
+    /* Si el hilo está escribiendo recogerá esto en el siguiente lote */
+    if (idle) pthread_cond_signal(&cv);
+    pthread_mutex_unlock(&mu);
+    free(payload);
+}
+
+/* Cadenas separadas por '\0' */
+static char *pack_strv(char *const *dirs, int n, size_t *len) {
+    size_t total = 0;
+    for (int i = 0; i < n; i++) total += strlen(dirs[i]) + 1;
+    char *buf = malloc(total ? total : 1);
+    if (!buf) return NULL;
+    size_t off = 0;
+    for (int i = 0; i < n; i++) {
+        size_t l = strlen(dirs[i]) + 1;
+        memcpy(buf + off, dirs[i], l);
+        off += l;
+    }
+    *len = total;
+    return buf;
+}
+
+void journal_line_done(uint32_t line, int status, const char *cwd,
+                       char *const *dirs, int ndirs, char *const *env, int failfast) {
+    if (jfd < 0) return;
+    uint64_t h = strv_hash(dirs, ndirs);
+    if (!have_path || h != last_path_hash) {
+        size_t len;
+        char *packed = pack_strv(dirs, ndirs, &len);
+        if (!packed) return;
+        append(REC_PATH, &h, sizeof(h), packed, len);
+        free(packed);
+        last_path_hash = h;
+        have_path = 1;
+    }
+
+    int nenv = 0;
+    while (env[nenv]) nenv++;
+    uint64_t eh = strv_hash(env, nenv) ^ (uint64_t)(failfast != 0);
+    if (!have_env || eh != last_env_hash) {
+        size_t len;
+        char *packed = pack_strv(env, nenv, &len);
+        if (!packed) return;
+        struct { uint64_t hash; int32_t failfast; uint32_t pad; } fixed = { eh, failfast != 0, 0 };
+        append(REC_ENV, &fixed, sizeof(fixed), packed, len);
+        free(packed);
+        last_env_hash = eh;
+        have_env = 1;
+    }
+
+    struct { uint32_t line; int32_t status; uint64_t hash; } fixed = { line, status, h };
+    append(REC_LINE, &fixed, sizeof(fixed), cwd, strlen(cwd) + 1);
+}
+
+/* --------------------- Lectura al reanudar --------------------- */
+
+/* Reemplaza *v (n cadenas, terminado en NULL) por las de data */
+static void set_strv(char ***v, int *n, const char *data, size_t len) {
+    for (int i = 0; i < *n; i++) free((*v)[i]);
+    free(*v);
+    *v = NULL;
+    *n = 0;
+
+    int count = 0;
+    for (size_t i = 0; i < len; i++) count += data[i] == '\0';
+    *v = calloc((size_t)count + 1, sizeof(char *));
+    if (!*v) return;
+    for (size_t off = 0; off < len; off += strlen(data + off) + 1) {
+        (*v)[(*n)++] = strdup(data + off);
+    }
+}
+
+/* Lee los registros válidos; retorna el tamaño hasta el último válido o -1
+   si el diario es de otro script o el script cambió desde entonces */
+static off_t replay(int fd, const char *script, const uint64_t id[2], JournalState *st) {
+    struct stat sb;
+    if (fstat(fd, &sb) != 0) return -1;
+    size_t size = (size_t)sb.st_size;
+    if (size == 0) return 0;
+    char *all = malloc(size);
+    if (!all) return -1;
+    if (pread(fd, all, size, 0) != (ssize_t)size) {
+        free(all);
+        return -1;
+    }
+
+    /* Último PATH visto: candidato para el hash de la siguiente REC_LINE */
+    char *path_data = NULL;
+    size_t path_len = 0;
+    uint64_t path_h = 0;
+    /* Último entorno visto: vale para las REC_LINE que le siguen */
+    const char *env_data = NULL;
+    size_t env_len = 0;
+    uint64_t env_h = 0;
+    int env_ff = 0;
+
+    size_t off = 0;
+    int header_ok = 0;
+    while (size - off >= sizeof(JournalRec)) {
+        JournalRec r;
+        memcpy(&r, all + off, sizeof(r));
+        if (r.magic != JOURNAL_MAGIC || r.len > size - off - sizeof(r)) break;
+        const char *data = all + off + sizeof(r);
+        if ((fnv32(data, r.len) ^ r.type) != r.sum) break;
+
+        if (r.type == REC_HEADER) {
+            if (r.len <= 16 || data[r.len - 1] != '\0' || memcmp(data, id, 16) != 0 ||
+                strcmp(data + 16, script) != 0) {
+                free(all);
+                free(path_data);
+                return -1;
+            }
+            header_ok = 1;
+        } else if (r.type == REC_PATH && r.len >= sizeof(uint64_t)) {
+            free(path_data);
+            memcpy(&path_h, data, sizeof(path_h));
+            path_len = r.len - sizeof(uint64_t);
+            path_data = malloc(path_len ? path_len : 1);
+            if (path_data) memcpy(path_data, data + sizeof(uint64_t), path_len);
+        } else if (r.type == REC_ENV && r.len >= 16 && (r.len == 16 || data[r.len - 1] == '\0')) {
+            int32_t ff;
+            memcpy(&env_h, data, sizeof(env_h));
+            memcpy(&ff, data + 8, sizeof(ff));
+            env_ff = ff != 0;
+            env_data = data + 16;
+            env_len = r.len - 16;
+        } else if (r.type == REC_LINE && r.len > 16 && data[r.len - 1] == '\0') {
+            struct { uint32_t line; int32_t status; uint64_t hash; } fixed;
+            memcpy(&fixed, data, sizeof(fixed));
+            if (path_data && fixed.hash == path_h) {
+                st->line = fixed.line;
+                st->status = fixed.status;
+                free(st->cwd);
+                st->cwd = strdup(data + sizeof(fixed));
+                set_strv(&st->dirs, &st->ndirs, path_data, path_len);
+                last_path_hash = path_h;
+                have_path = 1;
+                if (env_data) {
+                    set_strv(&st->env, &st->nenv, env_data, env_len);
+                    st->failfast = env_ff;
+                    st->has_env = 1;
+                    last_env_hash = env_h;
+                    have_env = 1;
+                }
+            }
+        }
+        off += sizeof(r) + r.len;
+    }
+    free(all);
+    free(path_data);
+    return header_ok ? (off_t)off : 0;
+}
+
+int journal_open(const char *file, const char *script, int resume, JournalState *st) {
+    memset(st, 0, sizeof(*st));
+    uint64_t id[2];
+    if (file_id(script, id) != 0) return -1;
+    int fd = open(file, O_RDWR | O_CREAT | O_CLOEXEC | (resume ? 0 : O_TRUNC), 0644);
+    if (fd < 0) return -1;
+
+    off_t keep = resume ? replay(fd, script, id, st) : 0;
+    if (keep < 0) {
+        close(fd);
+        journal_state_free(st);
+        return -1;
+    }
+    /* Se descarta la cola cortada; si no había cabecera se empieza de cero */
+    if (ftruncate(fd, keep) != 0 || lseek(fd, 0, SEEK_END) < 0) {
+        close(fd);
+        journal_state_free(st);
+        return -1;
+    }
+    if (keep == 0) {
+        journal_state_free(st);
+        have_path = 0;
+        have_env = 0;
+    }
+
+    jfd = fd;
+    stopping = 0;
+    if (pthread_create(&flusher, NULL, flush_loop, NULL) != 0) {
+        close(fd);
+        jfd = -1;
+        journal_state_free(st);
+        return -1;
+    }
+    if (keep == 0) append(REC_HEADER, id, sizeof(id), script, strlen(script) + 1);
+    atexit(journal_close);
+    return 0;
+}
+
+void journal_state_free(JournalState *st) {
+    for (int i = 0; i < st->ndirs; i++) free(st->dirs[i]);
+    free(st->dirs);
+    for (int i = 0; i < st->nenv; i++) free(st->env[i]);
+    free(st->env);
+    free(st->cwd);
+    memset(st, 0, sizeof(*st));
+}
+
+void journal_close(void) {
+    if (jfd < 0) return;
+    pthread_mutex_lock(&mu);
+    stopping = 1;
+    pthread_cond_signal(&cv);
+    pthread_mutex_unlock(&mu);
+    pthread_join(flusher, NULL);
+    close(jfd);
+    jfd = -1;
+    free(pend);
+    pend = NULL;
+    pend_len = pend_cap = 0;
+}
@@ -0,0 +1,70 @@
+/*
+ * wish_journal.h – Diario de progreso para reanudar scripts batch largos
+ *
+ * "wish --journal diario script" añade un registro por cada línea
+ * terminada (número de línea, código de salida, cwd y hash del PATH);
+ * "wish --journal diario --resume script" restaura cd, path, el entorno
+ * (export/unset) y set -e del último registro y salta las líneas ya
+ * hechas.
+ *
+ * Registros binarios: JournalRec seguido de len bytes, con suma FNV-1a
+ * del contenido. Un registro cortado por una caída se descarta al
+ * reanudar (y el archivo se trunca ahí).
+ *   REC_HEADER  tamaño + hash FNV-1a del contenido + ruta del script: el
+ *               diario solo vale para ese script sin cambios
+ *   REC_PATH    hash + directorios, escrito cuando el PATH cambia
+ *   REC_LINE    línea, código, hash del PATH vigente y cwd
+ *   REC_ENV     hash + set -e + "NOMBRE=valor" '\0' ..., escrito cuando el
+ *               entorno o set -e cambian; vale para las REC_LINE siguientes
+ *
+ * Escritura con group commit: journal_line_done solo copia el registro a
+ * un búfer; un hilo aparte escribe todo lo acumulado y hace fdatasync. Lo
+ * que llega mientras dura un fdatasync va en el siguiente lote. Tras una
+ * caída pueden perderse los registros del último lote, así que --resume
+ * puede repetir unas pocas líneas, nunca saltarse una sin terminar.
+ */
+
+#ifndef WISH_JOURNAL_H
+#define WISH_JOURNAL_H
+
+#include <stdint.h>
+
+#define JOURNAL_MAGIC 0x4a485357u     /* "WSHJ" */
+
+enum { REC_HEADER = 1, REC_PATH, REC_LINE, REC_ENV };
+
+typedef struct {
+    uint32_t magic;
+    uint32_t type;
+    uint32_t len;
+    uint32_t sum;
+} JournalRec;
+
+/* Estado recuperado al reanudar */
+typedef struct {
+    uint32_t line;          /* última línea terminada (0 = ninguna) */
+    int      status;
+    char    *cwd;
+    char   **dirs;          /* PATH vigente en esa línea */
+    int      ndirs;
+    int      has_env;       /* 0: diario sin REC_ENV, el entorno no cambia */
+    char   **env;           /* entorno vigente (terminado en NULL) */
+    int      nenv;
+    int      failfast;      /* set -e vigente */
+} JournalState;
+
+/* Abre (o crea) el diario de script. Con resume lee el estado previo en
+   *st; sin resume el diario se empieza de cero. Retorna 0 o -1 (el diario
+   es de otro script, el script cambió o no se pudo abrir). */
+int  journal_open(const char *file, const char *script, int resume, JournalState *st);
+void journal_state_free(JournalState *st);
+
+/* Registra que la línea terminó con status en ese cwd, PATH, entorno
+   (terminado en NULL) y set -e */
+void journal_line_done(uint32_t line, int status, const char *cwd,
+                       char *const *dirs, int ndirs, char *const *env, int failfast);
+
+/* Escribe lo pendiente y cierra (también se llama al salir con exit) */
+void journal_close(void);
+
+#endif
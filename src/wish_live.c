@@ -0,0 +1,152 @@
+/*
+ * wish_live.c – Estado en vivo de un wish batch en memoria compartida
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include "wish_live.h"
+
+#define RATE_WINDOW_NS 1000000000ull    /* el ritmo se recalcula cada segundo */
+#define RATE_WEIGHT    0.3              /* peso de la última ventana */
+
+static LiveShm *shm;
+static char     shm_name[64];
+static uint64_t win_start, win_lines, win_jobs;
+static int      have_rate;
+static int      have_line;      /* ya empezó alguna línea */
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* --------------------- Seqlock (escritor) --------------------- */
+
+static void write_begin(void) {
+    __atomic_store_n(&shm->seq, shm->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/* Cierra la escritura; de paso actualiza el ritmo si pasó la ventana */
+static void write_end(void) {
+    uint64_t now = now_ns();
+    shm->updated_ns = now;
+    if (now - win_start >= RATE_WINDOW_NS) {
+        double secs = (double)(now - win_start) / 1e9;
+        double lr = (double)(shm->lines_done - win_lines) / secs;
+        double jr = (double)(shm->jobs_done - win_jobs) / secs;
+        shm->lines_rate = have_rate ? RATE_WEIGHT * lr + (1 - RATE_WEIGHT) * shm->lines_rate : lr;
+        shm->jobs_rate = have_rate ? RATE_WEIGHT * jr + (1 - RATE_WEIGHT) * shm->jobs_rate : jr;
+        have_rate = 1;
+        win_start = now;
+        win_lines = shm->lines_done;
+        win_jobs = shm->jobs_done;
+    }
+    __atomic_store_n(&shm->seq, shm->seq + 1, __ATOMIC_RELEASE);
+}
+
+/* --------------------- Lado del shell --------------------- */
+
+static void live_close(void) {
+    if (!shm) return;
+    munmap(shm, sizeof(*shm));
+    shm = NULL;
+    shm_unlink(shm_name);
+}
+
+void live_open(const char *script) {
+    snprintf(shm_name, sizeof(shm_name), "/" LIVE_PREFIX "%ld", (long)getpid());
+    int fd = shm_open(shm_name, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return;
+    if (ftruncate(fd, sizeof(LiveShm)) != 0) {
+        close(fd);
+        shm_unlink(shm_name);
+        return;
+    }
+    void *p = mmap(NULL, sizeof(LiveShm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        shm_unlink(shm_name);
+        return;
+    }
+    shm = p;
+    /* Recién creado y a ceros: magic va al final para que un lector no
+       acepte el segmento antes de tiempo */
+    write_begin();
+    shm->version = LIVE_VERSION;
+    shm->shell_pid = (int32_t)getpid();
+    snprintf(shm->script, sizeof(shm->script), "%s", script);
+    shm->started_ns = win_start = now_ns();
+    shm->magic = LIVE_MAGIC;
+    write_end();
+    atexit(live_close);
+}
+
+void live_line(uint32_t line) {
+    if (!shm) return;
+    write_begin();
+    if (have_line) shm->lines_done++;
+    have_line = 1;
+    shm->line = line;
+    write_end();
+}
+
+void live_job_start(pid_t pid, const char *name) {
+    if (!shm) return;
+    write_begin();
+    shm->njobs++;
+    for (int i = 0; i < LIVE_SLOTS; i++) {
+        LiveJob *j = &shm->jobs[i];
+        if (j->pid) continue;
+        j->pid = (int32_t)pid;
+        j->line = shm->line;
+        j->start_ns = now_ns();
+        snprintf(j->name, sizeof(j->name), "%s", name);
+        break;
+    }
+    write_end();
+}
+
+void live_job_end(pid_t pid) {
+    if (!shm) return;
+    write_begin();
+    if (shm->njobs) shm->njobs--;
+    shm->jobs_done++;
+    for (int i = 0; i < LIVE_SLOTS; i++) {
+        if (shm->jobs[i].pid == (int32_t)pid) {
+            shm->jobs[i].pid = 0;
+            break;
+        }
+    }
+    write_end();
+}
+
+void live_detach(void) {
+    if (!shm) return;
+    munmap(shm, sizeof(*shm));
+    shm = NULL;
+}
+
+/* --------------------- Lado del lector --------------------- */
+
+int live_snapshot(const LiveShm *src, LiveShm *out) {
+    for (int tries = 0; tries < 1000; tries++) {
+        uint32_t s1 = __atomic_load_n(&src->seq, __ATOMIC_ACQUIRE);
+        if (s1 & 1) {
+            sched_yield();
+            continue;
+        }
+        memcpy(out, (const void *)src, sizeof(*out));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&src->seq, __ATOMIC_RELAXED) == s1) return 0;
+    }
+    return -1;
+}
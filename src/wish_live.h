@@ -0,0 +1,75 @@
+/*
+ * wish_live.h – Estado en vivo de un wish batch en memoria compartida
+ *
+ * Un wish que ejecuta un script (de texto, .wbc o --multi) publica en
+ * /dev/shm/wish-live.<pid> la línea en curso, los hijos que corren (pid,
+ * comando, cuándo arrancaron) y su ritmo de líneas e hijos por segundo.
+ * wishtop lo lee sin pedir permiso a nadie.
+ *
+ * Escritura con seqlock: el shell incrementa seq (impar = a medias),
+ * escribe y vuelve a incrementarlo; nunca espera a un lector. El lector
+ * copia todo y repite si seq era impar o cambió durante la copia. El
+ * segmento se borra al salir; si el shell muere sin pasar por exit queda
+ * huérfano y wishtop lo elimina al ver que el pid ya no existe.
+ *
+ * Los tiempos son de CLOCK_MONOTONIC, comparables entre procesos de la
+ * misma máquina.
+ */
+
+#ifndef WISH_LIVE_H
+#define WISH_LIVE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#define LIVE_MAGIC    0x564c5357u   /* "WSLV" */
+#define LIVE_VERSION  1
+#define LIVE_PREFIX   "wish-live."  /* en /dev/shm */
+#define LIVE_SLOTS    64            /* hijos con detalle; njobs cuenta todos */
+#define LIVE_NAME_MAX 32
+
+typedef struct {
+    int32_t  pid;                   /* 0 = hueco libre */
+    uint32_t line;                  /* línea que lo lanzó */
+    uint64_t start_ns;
+    char     name[LIVE_NAME_MAX];   /* argv[0], recortado */
+} LiveJob;
+
+typedef struct {
+    uint32_t magic, version;
+    uint32_t seq;                   /* seqlock */
+    int32_t  shell_pid;
+    char     script[128];
+    uint64_t started_ns;
+    uint64_t updated_ns;
+    uint32_t line;                  /* línea en curso (0 con --multi) */
+    uint32_t njobs;                 /* hijos locales vivos */
+    uint64_t lines_done, jobs_done;
+    double   lines_rate, jobs_rate; /* por segundo, media móvil */
+    LiveJob  jobs[LIVE_SLOTS];
+} LiveShm;
+
+/* --- Lado del shell (solo desde el hilo principal) --- */
+
+/* Crea el segmento de este proceso y lo borra al salir (atexit). Sin
+   segmento las demás llamadas no hacen nada. */
+void live_open(const char *script);
+
+/* Empieza la línea line (0 si no hay una sola numeración, como en
+   --multi); la anterior cuenta como terminada */
+void live_line(uint32_t line);
+
+void live_job_start(pid_t pid, const char *name);
+void live_job_end(pid_t pid);
+
+/* En una copia hecha con fork (subshell): deja de publicar sin borrar el
+   segmento, que sigue siendo del padre */
+void live_detach(void);
+
+/* --- Lado del lector --- */
+
+/* Copia coherente de shm en out. Retorna 0, o -1 si el escritor no dejó
+   de escribir en todos los intentos. */
+int  live_snapshot(const LiveShm *shm, LiveShm *out);
+
+#endif
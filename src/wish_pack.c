@@ -0,0 +1,387 @@
+/*
+ * wish_pack.c — Empaquetador de corpus de tests para WISH
+ *
+ * Uso:
+ *   wish_pack pack   <dir_tests> <corpus.wpk>   directorio -> corpus
+ *   wish_pack unpack <corpus.wpk> <dir_tests>   corpus -> directorio (run-tests.sh)
+ *   wish_pack list   <corpus.wpk>               lista tests y archivos auxiliares
+ *   wish_pack show   <corpus.wpk> <test> [ext]  vuelca una parte (por defecto .desc)
+ *
+ * <test> puede ser un número ("7") o un nombre; la búsqueda es O(1).
+ */
+
+#define _GNU_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "wish_corpus.h"
+
+/* --------------------- Utilidades --------------------- */
+
+static void die(const char *msg, const char *arg) {
+    fprintf(stderr, "wish_pack: %s%s%s\n", msg, arg ? ": " : "", arg ? arg : "");
+    exit(1);
+}
+
+static void *xrealloc(void *p, size_t n) {
+    p = realloc(p, n);
+    if (!p) die("sin memoria", NULL);
+    return p;
+}
+
+static char *read_all(const char *path, size_t *len) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) die("no se pudo abrir", path);
+    struct stat st;
+    if (fstat(fd, &st) != 0) die("fstat", path);
+    char *buf = malloc((size_t)st.st_size + 1);
+    if (!buf) die("sin memoria", NULL);
+    size_t got = 0;
+    while (got < (size_t)st.st_size) {
+        ssize_t n = read(fd, buf + got, (size_t)st.st_size - got);
+        if (n <= 0) die("error leyendo", path);
+        got += (size_t)n;
+    }
+    close(fd);
+    *len = got;
+    return buf;
+}
+
+static int write_all(int fd, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int part_index(const char *ext) {
+    for (int i = 0; i < CORPUS_NPARTS; i++) {
+        if (strcmp(ext, corpus_part_ext[i]) == 0) return i;
+    }
+    return -1;
+}
+
+/* Nombre numérico puro ("12") -> número; si no, 0 */
+static uint32_t name_to_num(const char *name) {
+    if (!*name) return 0;
+    for (const char *p = name; *p; p++) if (*p < '0' || *p > '9') return 0;
+    unsigned long v = strtoul(name, NULL, 10);
+    return v > 0xFFFFFFu ? 0 : (uint32_t)v;
+}
+
+/* --------------------- Construcción en memoria --------------------- */
+
+typedef struct {
+    char  *data;
+    size_t len;
+    int    present;
+} Buf;
+
+typedef struct {
+    char *name;
+    uint32_t num;
+    Buf part[CORPUS_NPARTS];
+} PTest;
+
+typedef struct {
+    char *path;
+    uint32_t mode;
+    Buf data;
+} PFile;
+
+static PTest *ptests;
+static size_t nptests;
+static PFile *pfiles;
+static size_t npfiles;
+
+static PTest *get_test(const char *name) {
+    for (size_t i = 0; i < nptests; i++) {
+        if (strcmp(ptests[i].name, name) == 0) return &ptests[i];
+    }
+    ptests = xrealloc(ptests, (nptests + 1) * sizeof(*ptests));
+    PTest *t = &ptests[nptests++];
+    memset(t, 0, sizeof(*t));
+    t->name = strdup(name);
+    t->num = name_to_num(name);
+    return t;
+}
+
+static void add_file(const char *full, const char *rel, mode_t mode) {
+    pfiles = xrealloc(pfiles, (npfiles + 1) * sizeof(*pfiles));
+    PFile *f = &pfiles[npfiles++];
+    f->path = strdup(rel);
+    f->mode = mode & CORPUS_MODE_MASK;
+    f->data.data = read_all(full, &f->data.len);
+    f->data.present = 1;
+}
+
+/* Recorre dir; en el nivel superior agrupa N.ext en tests, el resto es auxiliar */
+static void scan_dir(const char *root, const char *rel, int top) {
+    char dir[4096];
+    snprintf(dir, sizeof(dir), "%s%s%s", root, *rel ? "/" : "", rel);
+
+    struct dirent **list;
+    int n = scandir(dir, &list, NULL, alphasort);
+    if (n < 0) die("no se pudo leer el directorio", dir);
+
+    for (int i = 0; i < n; i++) {
+        const char *name = list[i]->d_name;
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) { free(list[i]); continue; }
+
+        char full[4096 + 256], sub[4096];
+        snprintf(full, sizeof(full), "%s/%s", dir, name);
+        snprintf(sub, sizeof(sub), "%s%s%s", rel, *rel ? "/" : "", name);
+
+        struct stat st;
+        if (stat(full, &st) != 0) die("stat", full);
+        if (S_ISDIR(st.st_mode)) {
+            scan_dir(root, sub, 0);
+        } else if (S_ISREG(st.st_mode)) {
+            const char *dot = strrchr(name, '.');
+            int p = (top && dot && dot != name) ? part_index(dot + 1) : -1;
+            if (p >= 0) {
+                char stem[256];
+                snprintf(stem, sizeof(stem), "%.*s", (int)(dot - name), name);
+                PTest *t = get_test(stem);
+                t->part[p].data = read_all(full, &t->part[p].len);
+                t->part[p].present = 1;
+            } else {
+                add_file(full, sub, st.st_mode);
+            }
+        }
+        free(list[i]);
+    }
+    free(list);
+}
+
+static int cmp_tests(const void *a, const void *b) {
+    const PTest *x = a, *y = b;
+    if (x->num && y->num) return (x->num > y->num) - (x->num < y->num);
+    if (x->num != y->num) return x->num ? -1 : 1;   /* numéricos primero */
+    return strcmp(x->name, y->name);
+}
+
+/* --------------------- pack --------------------- */
+
+static uint64_t align8(uint64_t v) { return (v + 7) & ~(uint64_t)7; }
+
+static int do_pack(const char *dir, const char *out) {
+    scan_dir(dir, "", 1);
+    qsort(ptests, nptests, sizeof(*ptests), cmp_tests);
+
+    CorpusHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, CORPUS_MAGIC, sizeof(CORPUS_MAGIC));
+    h.version = CORPUS_VERSION;
+    h.ntests = (uint32_t)nptests;
+    h.nfiles = (uint32_t)npfiles;
+    for (size_t i = 0; i < nptests; i++) {
+        if (ptests[i].num > h.max_num) h.max_num = ptests[i].num;
+    }
+    h.hash_size = 1;
+    while (h.hash_size < nptests * 2) h.hash_size <<= 1;
+
+    /* Tablas de longitud fija al principio, luego strtab y blobs */
+    uint64_t off = align8(sizeof(h));
+    h.num_index_off = off;  off = align8(off + ((uint64_t)h.max_num + 1) * sizeof(uint32_t));
+    h.name_hash_off = off;  off = align8(off + (uint64_t)h.hash_size * sizeof(uint32_t));
+    h.tests_off = off;      off = align8(off + nptests * sizeof(CorpusTest));
+    h.files_off = off;      off = align8(off + npfiles * sizeof(CorpusFile));
+
+    uint32_t  *num_index = calloc((size_t)h.max_num + 1, sizeof(uint32_t));
+    uint32_t  *name_hash = calloc(h.hash_size, sizeof(uint32_t));
+    CorpusTest *tests = calloc(nptests ? nptests : 1, sizeof(CorpusTest));
+    CorpusFile *files = calloc(npfiles ? npfiles : 1, sizeof(CorpusFile));
+    if (!num_index || !name_hash || !tests || !files) die("sin memoria", NULL);
+
+    for (size_t i = 0; i < nptests; i++) {
+        PTest *t = &ptests[i];
+        tests[i].num = t->num;
+        tests[i].name_off = (uint32_t)off;
+        off += strlen(t->name) + 1;
+        /* "07" y "7" serían el mismo test: uno taparía al otro */
+        if (t->num && num_index[t->num]) die("número de test repetido", t->name);
+        if (t->num) num_index[t->num] = (uint32_t)i + 1;
+
+        uint32_t mask = h.hash_size - 1;
+        uint32_t k = corpus_hash_name(t->name) & mask;
+        while (name_hash[k]) k = (k + 1) & mask;
+        name_hash[k] = (uint32_t)i + 1;
+    }
+    for (size_t i = 0; i < npfiles; i++) {
+        files[i].path_off = (uint32_t)off;
+        files[i].mode = pfiles[i].mode;
+        off += strlen(pfiles[i].path) + 1;
+    }
+    off = align8(off);
+    for (size_t i = 0; i < nptests; i++) {
+        for (int p = 0; p < CORPUS_NPARTS; p++) {
+            Buf *b = &ptests[i].part[p];
+            tests[i].part[p].off = off;
+            tests[i].part[p].len = b->len;
+            tests[i].part[p].present = (uint32_t)b->present;
+            off = align8(off + b->len);
+        }
+    }
+    for (size_t i = 0; i < npfiles; i++) {
+        files[i].data.off = off;
+        files[i].data.len = pfiles[i].data.len;
+        files[i].data.present = 1;
+        off = align8(off + pfiles[i].data.len);
+    }
+    h.total_size = off;
+
+    /* Escritura en un temporal + rename para no dejar corpus a medias */
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", out);
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) die("no se pudo crear", tmp);
+
+    static const char zeros[8];
+    uint64_t pos = 0;
+#define EMIT(ptr, n) do { if (write_all(fd, (ptr), (n)) < 0) die("error escribiendo", tmp); pos += (n); } while (0)
+#define PAD() do { uint64_t a_ = align8(pos); if (a_ > pos) EMIT(zeros, a_ - pos); } while (0)
+    EMIT(&h, sizeof(h)); PAD();
+    EMIT(num_index, ((size_t)h.max_num + 1) * sizeof(uint32_t)); PAD();
+    EMIT(name_hash, (size_t)h.hash_size * sizeof(uint32_t)); PAD();
+    EMIT(tests, nptests * sizeof(CorpusTest)); PAD();
+    EMIT(files, npfiles * sizeof(CorpusFile)); PAD();
+    for (size_t i = 0; i < nptests; i++) EMIT(ptests[i].name, strlen(ptests[i].name) + 1);
+    for (size_t i = 0; i < npfiles; i++) EMIT(pfiles[i].path, strlen(pfiles[i].path) + 1);
+    PAD();
+    for (size_t i = 0; i < nptests; i++) {
+        for (int p = 0; p < CORPUS_NPARTS; p++) {
+            Buf *b = &ptests[i].part[p];
+            if (b->len) EMIT(b->data, b->len);
+            PAD();
+        }
+    }
+    for (size_t i = 0; i < npfiles; i++) {
+        if (pfiles[i].data.len) EMIT(pfiles[i].data.data, pfiles[i].data.len);
+        PAD();
+    }
+#undef PAD
+#undef EMIT
+    if (pos != h.total_size) die("tamaño inconsistente", tmp);
+    if (close(fd) != 0 || rename(tmp, out) != 0) die("no se pudo publicar", out);
+
+    printf("%s: %u tests, %u archivos auxiliares, %llu bytes\n",
+           out, h.ntests, h.nfiles, (unsigned long long)h.total_size);
+    free(num_index);
+    free(name_hash);
+    free(tests);
+    free(files);
+    return 0;
+}
+
+/* --------------------- unpack / list / show --------------------- */
+
+static void mkdirs_for(const char *path) {
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s", path);
+    for (char *p = tmp + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        mkdir(tmp, 0755);
+        *p = '/';
+    }
+}
+
+static void write_file(const char *path, const void *data, size_t len, mode_t mode) {
+    mkdirs_for(path);
+    mode &= CORPUS_MODE_MASK;
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, mode);
+    if (fd < 0 || write_all(fd, data, len) < 0) die("no se pudo escribir", path);
+    fchmod(fd, mode);
+    close(fd);
+}
+
+static int do_unpack(const char *wpk, const char *dir) {
+    Corpus c;
+    if (corpus_open(&c, wpk) != 0) die("corpus inválido", wpk);
+    mkdir(dir, 0755);
+
+    char path[4096 + 512];
+    for (uint32_t i = 0; i < c.hdr->ntests; i++) {
+        const CorpusTest *t = &c.tests[i];
+        for (int p = 0; p < CORPUS_NPARTS; p++) {
+            if (!t->part[p].present) continue;
+            snprintf(path, sizeof(path), "%s/%s.%s", dir,
+                     corpus_str(&c, t->name_off), corpus_part_ext[p]);
+            write_file(path, corpus_blob(&c, &t->part[p]), t->part[p].len, 0644);
+        }
+    }
+    for (uint32_t i = 0; i < c.hdr->nfiles; i++) {
+        const CorpusFile *f = &c.files[i];
+        snprintf(path, sizeof(path), "%s/%s", dir, corpus_str(&c, f->path_off));
+        write_file(path, corpus_blob(&c, &f->data), f->data.len, f->mode);
+    }
+    corpus_close(&c);
+    return 0;
+}
+
+static int do_list(const char *wpk) {
+    Corpus c;
+    if (corpus_open(&c, wpk) != 0) die("corpus inválido", wpk);
+    for (uint32_t i = 0; i < c.hdr->ntests; i++) {
+        const CorpusTest *t = &c.tests[i];
+        const CorpusBlob *d = &t->part[PART_DESC];
+        int dl = (int)d->len;
+        const char *ds = corpus_blob(&c, d);
+        while (dl > 0 && (ds[dl - 1] == '\n' || ds[dl - 1] == '\r')) dl--;
+        printf("%-6s %.*s\n", corpus_str(&c, t->name_off), dl, ds);
+    }
+    for (uint32_t i = 0; i < c.hdr->nfiles; i++) {
+        printf("  [archivo] %s (%04o, %llu bytes)\n", corpus_str(&c, c.files[i].path_off),
+               c.files[i].mode, (unsigned long long)c.files[i].data.len);
+    }
+    corpus_close(&c);
+    return 0;
+}
+
+static int do_show(const char *wpk, const char *test, const char *ext) {
+    Corpus c;
+    if (corpus_open(&c, wpk) != 0) die("corpus inválido", wpk);
+    uint32_t num = name_to_num(test);
+    const CorpusTest *t = num ? corpus_find_num(&c, num) : corpus_find_name(&c, test);
+    if (!t) die("no existe el test", test);
+    int p = part_index(ext);
+    if (p < 0) die("parte desconocida", ext);
+    if (!t->part[p].present) die("el test no tiene esa parte", ext);
+    write_all(STDOUT_FILENO, corpus_blob(&c, &t->part[p]), t->part[p].len);
+    corpus_close(&c);
+    return 0;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "uso: wish_pack pack <dir> <corpus.wpk>\n"
+            "     wish_pack unpack <corpus.wpk> <dir>\n"
+            "     wish_pack list <corpus.wpk>\n"
+            "     wish_pack show <corpus.wpk> <test> [ext]\n");
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) usage();
+    if (!strcmp(argv[1], "pack") && argc == 4)   return do_pack(argv[2], argv[3]);
+    if (!strcmp(argv[1], "unpack") && argc == 4) return do_unpack(argv[2], argv[3]);
+    if (!strcmp(argv[1], "list") && argc == 3)   return do_list(argv[2]);
+    if (!strcmp(argv[1], "show") && (argc == 4 || argc == 5))
+        return do_show(argv[2], argv[3], argc == 5 ? argv[4] : "desc");
+    usage();
+    return 1;
+}
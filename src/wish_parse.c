@@ -0,0 +1,404 @@
+/*
+ * wish_parse.c – Léxico, gramática y construcción de argv para WISH
+ */
+
+#define _GNU_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wish_parse.h"
+#include "wish_glob.h"
+#include "wish_env.h"
+
+#define ARGV_INIT_CAP 16   /* capacidad inicial; argv crece según haga falta */
+
+/* --------------------- Léxico --------------------- */
+
+typedef enum {
+    T_WORD, T_GT, T_TEE, T_LT, T_HERE, T_AMP, T_SEMI, T_AND, T_OR, T_LPAREN, T_RPAREN, T_PIPE, T_END
+} TokType;
+
+typedef struct {
+    TokType type;
+    char   *text;          /* solo T_WORD */
+} Tok;
+
+typedef struct {
+    Tok *t;
+    int  n, pos;
+} Parser;
+
+static int is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static int is_meta(char c) {
+    return c == '>' || c == '<' || c == '&' || c == '|' || c == ';' || c == '(' || c == ')';
+}
+
+static int push_tok(Parser *p, TokType type, char *text) {
+    Tok *nt = realloc(p->t, (size_t)(p->n + 1) * sizeof(Tok));
+    if (!nt) { free(text); return -1; }
+    p->t = nt;
+    p->t[p->n].type = type;
+    p->t[p->n].text = text;
+    p->n++;
+    return 0;
+}
+
+/* Texto de un '<<<': entre comillas (sin escapes) o una palabra normal */
+static const char *here_text(const char *s, Parser *p, int *r) {
+    while (is_space(*s)) s++;
+    if (*s != '"' && *s != '\'') return s;
+    const char *end = strchr(s + 1, *s);
+    if (!end) {
+        *r = -1;          /* comilla sin cerrar: error de estructura */
+        return s;
+    }
+    char *w = strndup(s + 1, (size_t)(end - s - 1));
+    *r = w ? push_tok(p, T_WORD, w) : -1;
+    return end + 1;
+}
+
+/* Los operadores no necesitan espacios alrededor: "a&b", "ls>out" */
+static int tokenize(const char *s, Parser *p) {
+    while (*s) {
+        if (is_space(*s)) { s++; continue; }
+        int r;
+        if (s[0] == '&' && s[1] == '&')      { r = push_tok(p, T_AND, NULL); s += 2; }
+        else if (s[0] == '|' && s[1] == '|') { r = push_tok(p, T_OR, NULL); s += 2; }
+        else if (*s == '&') { r = push_tok(p, T_AMP, NULL); s++; }
+        else if (*s == '|') { r = push_tok(p, T_PIPE, NULL); s++; }
+        else if (*s == ';') { r = push_tok(p, T_SEMI, NULL); s++; }
+        else if (s[0] == '>' && s[1] == '+') { r = push_tok(p, T_TEE, NULL); s += 2; }
+        else if (*s == '>') { r = push_tok(p, T_GT, NULL); s++; }
+        else if (!strncmp(s, "<<<", 3)) {
+            r = push_tok(p, T_HERE, NULL);
+            if (r == 0) s = here_text(s + 3, p, &r);
+            else s += 3;
+        }
+        else if (*s == '<') { r = push_tok(p, T_LT, NULL); s++; }
+        else if (*s == '(') { r = push_tok(p, T_LPAREN, NULL); s++; }
+        else if (*s == ')') { r = push_tok(p, T_RPAREN, NULL); s++; }
+        else {
+            const char *b = s;
+            while (*s && !is_space(*s) && !is_meta(*s)) s++;
+            char *w = strndup(b, (size_t)(s - b));
+            r = w ? push_tok(p, T_WORD, w) : -1;
+        }
+        if (r < 0) return -1;
+    }
+    return push_tok(p, T_END, NULL);
+}
+
+static Tok *peek(Parser *p) {
+    return &p->t[p->pos];
+}
+
+/* --------------------- Nodos --------------------- */
+
+static Node *node_new(NodeType type) {
+    Node *n = calloc(1, sizeof(*n));
+    if (n) n->type = type;
+    return n;
+}
+
+static int node_add(Node *parent, Node *kid, int op, int dep) {
+    int k = parent->nkids;
+    Node **nk = realloc(parent->kids, (size_t)(k + 1) * sizeof(Node *));
+    if (!nk) return -1;
+    parent->kids = nk;
+    int *no = realloc(parent->ops, (size_t)(k + 1) * sizeof(int));
+    if (!no) return -1;
+    parent->ops = no;
+    int *nd = realloc(parent->dep, (size_t)(k + 1) * sizeof(int));
+    if (!nd) return -1;
+    parent->dep = nd;
+
+    parent->kids[k] = kid;
+    parent->ops[k] = op;
+    parent->dep[k] = dep;
+    parent->nkids++;
+    kid->parent = parent;
+    kid->index = k;
+    return 0;
+}
+
+void node_free(Node *n) {
+    if (!n) return;
+    for (int i = 0; i < n->nkids; i++) node_free(n->kids[i]);
+    for (int i = 0; i < n->sc.nwords; i++) free(n->sc.words[i]);
+    free(n->sc.words);
+    free(n->sc.redir);
+    free(n->sc.in);
+    for (int i = 0; i < n->sc.ntee; i++) free(n->sc.tee[i]);
+    free(n->sc.tee);
+    free(n->kids);
+    free(n->ops);
+    free(n->dep);
+    free(n);
+}
+
+/* --------------------- Gramática --------------------- */
+
+static Node *parse_list(Parser *p, int nested);
+
+static int is_redir(TokType t) {
+    return t == T_GT || t == T_TEE || t == T_LT || t == T_HERE;
+}
+
+/* comando := palabra+ redir*
+   *empty = 1 si no había ningún token de comando */
+static Node *parse_simple(Parser *p, int *empty) {
+    int start = p->pos;
+    int nwords = 0, ngt = 0, nin = 0, ntee = 0, bad = 0;
+    while (peek(p)->type == T_WORD || is_redir(peek(p)->type)) {
+        TokType t = peek(p)->type;
+        p->pos++;
+        if (t == T_WORD) {
+            if (ngt || nin) bad = 1;      /* argumento tras una redirección */
+            else nwords++;
+            continue;
+        }
+        if (t == T_GT || t == T_TEE) ngt++;
+        else nin++;
+        if (peek(p)->type != T_WORD) {
+            bad = 1;
+            continue;
+        }
+        p->pos++;
+        /* '>+' se lleva todas las palabras que le siguen */
+        if (t == T_TEE) {
+            ntee++;
+            while (peek(p)->type == T_WORD) { p->pos++; ntee++; }
+        }
+    }
+    *empty = (p->pos == start);
+    if (*empty) return NULL;
+
+    /* Como mucho una salida ('>' o '>+') y una entrada, cada una con su
+       palabra, y con comando delante */
+    if (bad || ngt > 1 || nin > 1 || nwords == 0) {
+        return node_new(NODE_ERROR);
+    }
+
+    Node *n = node_new(NODE_CMD);
+    if (!n) return NULL;
+    n->sc.words = calloc((size_t)nwords + 1, sizeof(char *));
+    n->sc.tee = ntee ? calloc((size_t)ntee, sizeof(char *)) : NULL;
+    if (!n->sc.words || (ntee && !n->sc.tee)) { node_free(n); return NULL; }
+    int in_tee = 0;
+    for (int i = start; i < p->pos; i++) {
+        Tok *t = &p->t[i];
+        if (t->type != T_WORD) {
+            in_tee = (t->type == T_TEE);
+            continue;
+        }
+        TokType op = i > start ? p->t[i - 1].type : T_WORD;
+        if (in_tee) {
+            n->sc.tee[n->sc.ntee++] = t->text;
+        } else if (op == T_GT) {
+            n->sc.redir = t->text;
+        } else if (is_redir(op)) {
+            n->sc.in = t->text;
+            n->sc.here = (op == T_HERE);
+        } else {
+            n->sc.words[n->sc.nwords++] = t->text;
+        }
+        t->text = NULL;      /* el nodo se queda con la cadena */
+    }
+    return n;
+}
+
+/* etapa := comando | '(' lista ')' */
+static Node *parse_stage(Parser *p, int *empty) {
+    *empty = 0;
+    if (peek(p)->type != T_LPAREN) return parse_simple(p, empty);
+
+    p->pos++;
+    Node *inner = parse_list(p, 1);
+    if (!inner) return NULL;
+    if (peek(p)->type != T_RPAREN) { node_free(inner); return NULL; }
+    p->pos++;
+    return inner;
+}
+
+/* and_or := etapa ( ('&&' | '||') etapa )* */
+static Node *parse_andor(Parser *p) {
+    int empty;
+    Node *first = parse_stage(p, &empty);
+    if (!first) return NULL;
+    if (peek(p)->type != T_AND && peek(p)->type != T_OR) return first;
+
+    Node *ao = node_new(NODE_ANDOR);
+    if (!ao || node_add(ao, first, OP_SEQ, -1) < 0) {
+        node_free(ao);
+        node_free(first);
+        return NULL;
+    }
+    while (peek(p)->type == T_AND || peek(p)->type == T_OR) {
+        int op = peek(p)->type == T_AND ? OP_AND : OP_OR;
+        p->pos++;
+        Node *next = parse_stage(p, &empty);
+        if (!next || node_add(ao, next, op, -1) < 0) {
+            node_free(next);
+            node_free(ao);
+            return NULL;
+        }
+    }
+    return ao;
+}
+
+/* lista := and_or ( ('&' | ';') and_or )* [ '&' | ';' ]
+   Los elementos vacíos ("&", "a & & b") se ignoran. */
+static Node *parse_list(Parser *p, int nested) {
+    Node *list = node_new(NODE_LIST);
+    if (!list) return NULL;
+    list->group = nested;
+
+    int last_seq = -1;
+    for (;;) {
+        TokType t = peek(p)->type;
+        if (t == T_END) {
+            if (nested) goto bad;     /* falta ')' */
+            break;
+        }
+        if (t == T_RPAREN) {
+            if (!nested) goto bad;
+            break;
+        }
+        if (t == T_AMP || t == T_SEMI) { p->pos++; continue; }
+
+        Node *e = parse_andor(p);
+        if (!e) goto bad;
+
+        int sep = OP_SEQ;
+        t = peek(p)->type;
+        if (t == T_AMP) { sep = OP_PAR; p->pos++; }
+        else if (t == T_SEMI) { p->pos++; }
+        else if (t != T_END && t != T_RPAREN) { node_free(e); goto bad; }
+
+        if (node_add(list, e, sep, last_seq) < 0) { node_free(e); goto bad; }
+        if (sep == OP_SEQ) last_seq = list->nkids - 1;
+    }
+    /* Un grupo vacío "()" es un error, como en sh */
+    if (nested && list->nkids == 0) goto bad;
+    return list;
+
+bad:
+    node_free(list);
+    return NULL;
+}
+
+Node *parse_line(const char *line) {
+    Parser p = { NULL, 0, 0 };
+    Node *root = NULL;
+    if (tokenize(line, &p) == 0) {
+        root = parse_list(&p, 0);
+        if (root && peek(&p)->type != T_END) {
+            node_free(root);
+            root = NULL;
+        }
+    }
+    for (int i = 0; i < p.n; i++) free(p.t[i].text);
+    free(p.t);
+    return root;
+}
+
+int line_is_blank(const char *line, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (!is_space(line[i])) return 0;
+    }
+    return 1;
+}
+
+/* --------------------- argv expandido --------------------- */
+
+/* Añade un argumento; argv se duplica cuando se llena */
+static int cmd_push(Cmd *cmd, char *arg) {
+    if (cmd->argc + 1 >= cmd->cap) {
+        int ncap = cmd->cap ? cmd->cap * 2 : ARGV_INIT_CAP;
+        char **nv = realloc(cmd->argv, (size_t)ncap * sizeof(char *));
+        if (!nv) return -1;
+        cmd->argv = nv;
+        cmd->cap = ncap;
+    }
+    cmd->argv[cmd->argc++] = arg;
+    cmd->argv[cmd->argc] = NULL;
+    return 0;
+}
+
+/* Registra una cadena cuya memoria pertenece al Cmd */
+static int cmd_own(Cmd *cmd, char *s) {
+    char **nv = realloc(cmd->owned, (size_t)(cmd->nowned + 1) * sizeof(char *));
+    if (!nv) return -1;
+    cmd->owned = nv;
+    cmd->owned[cmd->nowned++] = s;
+    return 0;
+}
+
+void cmd_free(Cmd *cmd) {
+    for (int i = 0; i < cmd->nowned; i++) free(cmd->owned[i]);
+    free(cmd->owned);
+    free(cmd->argv);
+    free(cmd->redir_file);
+    free(cmd->in_file);
+    free(cmd->here);
+    free(cmd->assign);
+    memset(cmd, 0, sizeof(*cmd));
+}
+
+/* Añade una palabra, expandiendo comodines si los tiene */
+static int cmd_push_word(Cmd *cmd, char *word) {
+    if (!glob_has_magic(word)) return cmd_push(cmd, word);
+
+    char **matches;
+    int n = glob_expand(word, &matches);
+    if (n < 0) return -1;
+    if (n == 0) return cmd_push(cmd, word);   /* sin coincidencias: literal */
+
+    int rc = 0;
+    for (int i = 0; i < n; i++) {
+        if (rc == 0 && cmd_own(cmd, matches[i]) == 0) {
+            rc = cmd_push(cmd, matches[i]);
+        } else {
+            free(matches[i]);
+            rc = -1;
+        }
+    }
+    free(matches);
+    return rc;
+}
+
+int cmd_build(const SimpleCmd *sc, Cmd *cmd) {
+    memset(cmd, 0, sizeof(*cmd));
+    int first = 0;
+    while (first < sc->nwords && env_is_assignment(sc->words[first])) first++;
+    if (first > 0) {
+        cmd->assign = malloc((size_t)first * sizeof(char *));
+        if (!cmd->assign) return -1;
+        memcpy(cmd->assign, sc->words, (size_t)first * sizeof(char *));
+        cmd->nassign = first;
+    }
+    for (int i = first; i < sc->nwords; i++) {
+        if (cmd_push_word(cmd, sc->words[i]) < 0) return -1;
+    }
+    cmd->tee = sc->tee;
+    cmd->ntee = sc->ntee;
+    if (sc->redir) {
+        cmd->has_redir = 1;
+        cmd->redir_file = strdup(sc->redir);
+        if (!cmd->redir_file) return -1;
+    }
+    if (sc->in && sc->here) {
+        if (asprintf(&cmd->here, "%s\n", sc->in) < 0) {
+            cmd->here = NULL;
+            return -1;
+        }
+    } else if (sc->in) {
+        cmd->in_file = strdup(sc->in);
+        if (!cmd->in_file) return -1;
+    }
+    return cmd->argc > 0 ? 0 : -1;
+}
@@ -0,0 +1,103 @@
+/*
+ * wish_parse.h – Analizador de líneas de WISH
+ *
+ * Gramática (de menor a mayor precedencia):
+ *   lista    := and_or ( ('&' | ';') and_or )* [ '&' | ';' ]
+ *   and_or   := etapa ( ('&&' | '||') etapa )*
+ *   etapa    := comando | '(' lista ')'
+ *   comando  := palabra+ redir*
+ *   redir    := '>' archivo | '>+' archivo+ | '<' archivo | '<<<' texto
+ *
+ * Una línea se convierte en un árbol de nodos que el planificador recorre
+ * como un grafo de dependencias: en una lista, cada elemento depende solo
+ * del último elemento terminado en ';' que lo precede, así que todo lo
+ * separado por '&' arranca a la vez.
+ *
+ * Cada redirección toma exactamente una palabra, salvo '>+', que se lleva
+ * todas las que la siguen (la misma salida a varios archivos), y tras la
+ * primera ya no puede haber argumentos. El texto de '<<<' puede ir entre comillas dobles
+ * o simples para incluir espacios y operadores ("<<< 'a & b'"); son las
+ * únicas comillas que entiende el léxico. Como en bash, el comando lo
+ * recibe con un '\n' final.
+ *
+ * Los errores dentro de un comando simple (varias salidas o varias entradas,
+ * una redirección sin palabra o sin comando) no invalidan la línea: generan un nodo NODE_ERROR que
+ * imprime el error al ejecutarse, como hacía el parseo por segmentos.
+ * Los errores de estructura (paréntesis sin cerrar, '&&' sin operando,
+ * '|') invalidan la línea completa.
+ */
+
+#ifndef WISH_PARSE_H
+#define WISH_PARSE_H
+
+#include <stddef.h>
+
+/* Separadores de lista y operadores and_or */
+enum { OP_SEQ, OP_PAR, OP_AND, OP_OR };
+
+typedef enum { NODE_CMD, NODE_ERROR, NODE_ANDOR, NODE_LIST } NodeType;
+
+/* Comando tal como aparece en la línea: sin expandir comodines */
+typedef struct {
+    char **words;
+    int    nwords;
+    char  *redir;          /* destino de '>' o NULL */
+    char  *in;             /* origen de '<', texto de '<<<' o NULL */
+    int    here;           /* in es el texto de un '<<<' */
+    char **tee;            /* destinos de '>+' */
+    int    ntee;
+} SimpleCmd;
+
+typedef struct Node {
+    NodeType type;
+    SimpleCmd sc;                /* NODE_CMD */
+
+    struct Node **kids;          /* NODE_ANDOR / NODE_LIST */
+    int   *ops;                  /* ANDOR: ops[i] une kids[i-1] con kids[i];
+                                    LIST: ops[i] es el separador tras kids[i] */
+    int   *dep;                  /* LIST: elemento del que depende kids[i] (-1: ninguno) */
+    int    nkids;
+    int    group;                /* LIST escrita entre paréntesis */
+
+    /* Estado de ejecución (lo mantiene el planificador) */
+    struct Node *parent;
+    int    index;                /* posición dentro de parent->kids */
+    int    started, done, status;
+    int    cur;                  /* ANDOR: hijo en ejecución */
+    int    remaining;            /* LIST: hijos sin terminar */
+} Node;
+
+/* argv ya expandido, listo para execv */
+typedef struct {
+    char **argv;           /* argumentos (argv[0] = comando), terminado en NULL */
+    int   argc;
+    int   cap;
+    int   has_redir;
+    char *redir_file;      /* nombre del archivo si has_redir */
+    char *in_file;         /* '<' o NULL */
+    char *here;            /* '<<<' (con el '\n' final) o NULL */
+    char **assign;         /* "NOMBRE=valor" delante del comando (apuntan a
+                              las palabras del SimpleCmd) */
+    int   nassign;
+    char *const *tee;      /* destinos de '>+' (los del SimpleCmd) */
+    int   ntee;
+    char **owned;          /* cadenas propias (resultados de comodines) */
+    int   nowned;
+} Cmd;
+
+/* Analiza una línea. Retorna el árbol (una NODE_LIST, posiblemente vacía)
+   o NULL si la línea tiene un error de estructura. */
+Node *parse_line(const char *line);
+void  node_free(Node *n);
+
+/* 1 si la línea solo tiene espacios (el lector batch la salta) */
+int   line_is_blank(const char *line, size_t len);
+
+/* Construye el argv de un comando expandiendo comodines en ese momento
+   (después de los cd previos de la misma línea). Las palabras NOMBRE=valor
+   del principio no van al argv sino a assign. Retorna 0 o -1 (también si
+   no queda comando). */
+int   cmd_build(const SimpleCmd *sc, Cmd *cmd);
+void  cmd_free(Cmd *cmd);
+
+#endif
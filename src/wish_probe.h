@@ -0,0 +1,45 @@
+/*
+ * wish_probe.h – Sondas USDT para trazar un wish en marcha
+ *
+ * Con <sys/sdt.h> (systemtap-sdt-dev) cada sonda es un nop y una nota ELF
+ * que bpftrace o perf convierten en un breakpoint al engancharse; sin
+ * nadie enganchado cuesta ese nop y preparar los argumentos, que aquí son
+ * siempre valores ya calculados. Sin el encabezado, o con -DWISH_NO_USDT,
+ * las sondas desaparecen del binario.
+ *
+ * Proveedor "wish":
+ *   line__read   (char *línea, long longitud)      línea leída
+ *   parse__start (char *línea)                     antes de analizarla
+ *                                                  (NULL en un .wbc)
+ *   parse__end   (void *árbol, u64 ns)             NULL: error de sintaxis
+ *   spawn        (char *comando)                   justo antes de fork
+ *   spawn__done  (int pid, u64 ns del fork)        en el padre
+ *   exec__fail   (char *comando, int errno)        en el hijo; ENOENT si
+ *                                                  no está en el PATH
+ *   reap         (int pid, int estado, u64 ns)     estado de waitpid y
+ *                                                  tiempo desde el fork
+ *
+ * Scripts de ejemplo en probes/ (ver probes/README).
+ */
+
+#ifndef WISH_PROBE_H
+#define WISH_PROBE_H
+
+#if !defined(WISH_NO_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define WISH_USDT 1
+#endif
+#endif
+
+#ifdef WISH_USDT
+#define WISH_PROBE1(name, a)        DTRACE_PROBE1(wish, name, a)
+#define WISH_PROBE2(name, a, b)     DTRACE_PROBE2(wish, name, a, b)
+#define WISH_PROBE3(name, a, b, c)  DTRACE_PROBE3(wish, name, a, b, c)
+#else
+#define WISH_PROBE1(name, a)        do { } while (0)
+#define WISH_PROBE2(name, a, b)     do { } while (0)
+#define WISH_PROBE3(name, a, b, c)  do { } while (0)
+#endif
+
+#endif
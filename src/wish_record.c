@@ -0,0 +1,245 @@
+/*
+ * wish_record.c – Captura de la carga y reproducción
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "wish_record.h"
+
+/* --------------------- Captura --------------------- */
+
+static int      rfd = -1;
+static uint64_t t0;                 /* inicio de la captura (monotónico) */
+static char    *last_cwd;
+static uint64_t last_dirs_hash;
+static int      have_dirs;
+
+static uint64_t dirs_hash(char *const *dirs, int n) {
+    uint64_t h = 14695981039346656037ull;
+    for (int i = 0; i < n; i++) {
+        for (const unsigned char *p = (const unsigned char *)dirs[i]; ; p++) {
+            h = (h ^ *p) * 1099511628211ull;
+            if (!*p) break;
+        }
+    }
+    return h;
+}
+
+static int write_all(int fd, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* Búfer de la línea en curso: todos sus registros salen en un solo write */
+typedef struct {
+    char  *data;
+    size_t len, cap;
+    int    failed;
+} Buf;
+
+static void *buf_grow(Buf *b, size_t n) {
+    if (b->len + n > b->cap) {
+        size_t ncap = b->cap ? b->cap : 512;
+        while (ncap < b->len + n) ncap *= 2;
+        char *nd = realloc(b->data, ncap);
+        if (!nd) {
+            b->failed = 1;
+            return NULL;
+        }
+        b->data = nd;
+        b->cap = ncap;
+    }
+    void *p = b->data + b->len;
+    b->len += n;
+    return p;
+}
+
+static void buf_put(Buf *b, const void *data, size_t n) {
+    void *p = buf_grow(b, n);
+    if (p) memcpy(p, data, n);
+}
+
+static void buf_rec(Buf *b, uint32_t type, uint32_t len) {
+    RecordRec r = { type, len };
+    buf_put(b, &r, sizeof(r));
+}
+
+int record_open(const char *file) {
+    rfd = open(file, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (rfd < 0) return -1;
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    RecordHdr h = { RECORD_MAGIC, RECORD_VERSION,
+                    (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec };
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    t0 = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+    if (write_all(rfd, &h, sizeof(h)) != 0) {
+        close(rfd);
+        rfd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+void record_line(const char *text, const char *cwd, char *const *dirs, int ndirs,
+                 uint64_t start, uint64_t end, int status, const int32_t *seg, int nseg) {
+    if (rfd < 0) return;
+    Buf b = { NULL, 0, 0, 0 };
+
+    if (cwd && (!last_cwd || strcmp(cwd, last_cwd) != 0)) {
+        size_t l = strlen(cwd) + 1;
+        buf_rec(&b, RR_CWD, (uint32_t)l);
+        buf_put(&b, cwd, l);
+        free(last_cwd);
+        last_cwd = strdup(cwd);
+    }
+    uint64_t h = dirs_hash(dirs, ndirs);
+    if (!have_dirs || h != last_dirs_hash) {
+        size_t total = 0;
+        for (int i = 0; i < ndirs; i++) total += strlen(dirs[i]) + 1;
+        buf_rec(&b, RR_DIRS, (uint32_t)total);
+        for (int i = 0; i < ndirs; i++) buf_put(&b, dirs[i], strlen(dirs[i]) + 1);
+        last_dirs_hash = h;
+        have_dirs = 1;
+    }
+
+    if (nseg > RECORD_MAX_SEG) nseg = RECORD_MAX_SEG;
+    size_t tl = strlen(text);
+    while (tl > 0 && (text[tl - 1] == '\n' || text[tl - 1] == '\r')) tl--;
+    RecordLine ln = { start - t0, end - start, status, (uint32_t)nseg };
+    buf_rec(&b, RR_LINE, (uint32_t)(sizeof(ln) + (size_t)nseg * sizeof(int32_t) + tl + 1));
+    buf_put(&b, &ln, sizeof(ln));
+    buf_put(&b, seg, (size_t)nseg * sizeof(int32_t));
+    buf_put(&b, text, tl);
+    buf_put(&b, "", 1);
+
+    /* Un log a medias no sirve de referencia: al primer fallo se deja */
+    if (b.failed || write_all(rfd, b.data, b.len) != 0) record_close();
+    free(b.data);
+}
+
+void record_close(void) {
+    if (rfd >= 0) close(rfd);
+    rfd = -1;
+    free(last_cwd);
+    last_cwd = NULL;
+    have_dirs = 0;
+}
+
+/* --------------------- Reproducción --------------------- */
+
+struct Replay {
+    const char *data;
+    size_t      len, off;
+    const char *cwd;
+    char      **dirs;
+    int         ndirs, cap;
+};
+
+Replay *replay_open(const char *file) {
+    int fd = open(file, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+    struct stat st;
+    Replay *r = NULL;
+    RecordHdr h;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(h) &&
+        (r = calloc(1, sizeof(*r))) != NULL) {
+        r->len = (size_t)st.st_size;
+        r->data = mmap(NULL, r->len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (r->data == MAP_FAILED) {
+            free(r);
+            r = NULL;
+        }
+    }
+    close(fd);
+    if (!r) return NULL;
+    memcpy(&h, r->data, sizeof(h));
+    if (h.magic != RECORD_MAGIC || h.version != RECORD_VERSION) {
+        replay_close(r);
+        return NULL;
+    }
+    r->off = sizeof(h);
+    return r;
+}
+
+/* Directorios del PATH del registro (cada uno termina en '\0') */
+static int load_dirs(Replay *r, const char *p, uint32_t len) {
+    r->ndirs = 0;
+    for (uint32_t i = 0; i < len; ) {
+        if (r->ndirs == r->cap) {
+            int ncap = r->cap ? r->cap * 2 : 8;
+            char **nd = realloc(r->dirs, (size_t)ncap * sizeof(char *));
+            if (!nd) return -1;
+            r->dirs = nd;
+            r->cap = ncap;
+        }
+        const char *end = memchr(p + i, '\0', len - i);
+        if (!end) return -1;
+        r->dirs[r->ndirs++] = (char *)(p + i);
+        i = (uint32_t)(end - p) + 1;
+    }
+    return 0;
+}
+
+int replay_next(Replay *r, ReplayLine *out) {
+    out->cwd_changed = out->dirs_changed = 0;
+    for (;;) {
+        RecordRec rec;
+        /* Un registro cortado al final (captura interrumpida) es el fin */
+        if (r->len - r->off < sizeof(rec)) return 0;
+        memcpy(&rec, r->data + r->off, sizeof(rec));
+        if (r->len - r->off - sizeof(rec) < rec.len) return 0;
+        const char *p = r->data + r->off + sizeof(rec);
+        r->off += sizeof(rec) + rec.len;
+
+        switch (rec.type) {
+        case RR_CWD:
+            if (rec.len == 0 || p[rec.len - 1] != '\0') return -1;
+            r->cwd = p;
+            out->cwd_changed = 1;
+            break;
+        case RR_DIRS:
+            if (load_dirs(r, p, rec.len) < 0) return -1;
+            out->dirs_changed = 1;
+            break;
+        case RR_LINE: {
+            if (rec.len < sizeof(RecordLine) + 1 || p[rec.len - 1] != '\0') return -1;
+            memcpy(&out->hdr, p, sizeof(RecordLine));
+            size_t segs = (size_t)out->hdr.nseg * sizeof(int32_t);
+            if (out->hdr.nseg > RECORD_MAX_SEG || sizeof(RecordLine) + segs >= rec.len) return -1;
+            memcpy(out->seg, p + sizeof(RecordLine), segs);
+            out->text = p + sizeof(RecordLine) + segs;
+            out->cwd = r->cwd;
+            out->dirs = r->dirs;
+            out->ndirs = r->ndirs;
+            return 1;
+        }
+        default:
+            /* Tipo desconocido (versión posterior compatible): se salta */
+            break;
+        }
+    }
+}
+
+void replay_close(Replay *r) {
+    if (!r) return;
+    munmap((void *)r->data, r->len);
+    free(r->dirs);
+    free(r);
+}
@@ -0,0 +1,89 @@
+/*
+ * wish_record.h – Captura de la carga (--record) y reproducción (--replay)
+ *
+ * "wish --record log [script]" guarda cada línea ejecutada: su texto, el
+ * cwd y el PATH con los que corrió, cuándo empezó (ns desde el inicio de
+ * la captura), cuánto tardó, su código y el de cada comando simple en el
+ * orden de la línea (-1 si no llegó a correr). Vale para scripts de texto,
+ * para -c y en modo interactivo.
+ *
+ * Formato: RecordHdr y después registros RecordRec + len bytes.
+ *   RR_CWD   cwd terminado en '\0'
+ *   RR_DIRS  directorios del PATH, cada uno terminado en '\0'
+ *   RR_LINE  RecordLine, nseg códigos int32 y el texto terminado en '\0'
+ * cwd y PATH solo se escriben cuando cambian, así que una línea típica
+ * ocupa su texto más unos 30 bytes. Todo en el orden de bytes de la
+ * máquina que grabó.
+ *
+ * "wish --replay log [--speed N]" vuelve a ejecutar las líneas con su cwd
+ * y PATH. Con N > 0 respeta los tiempos entre llegadas originales
+ * divididos por N (1 = tiempo real); con 0 va lo más rápido posible. Por
+ * stderr compara la latencia de cada línea con la grabada y marca las que
+ * terminaron con códigos distintos.
+ */
+
+#ifndef WISH_RECORD_H
+#define WISH_RECORD_H
+
+#include <stdint.h>
+
+#define RECORD_MAGIC   0x52485357u     /* "WSHR" */
+#define RECORD_VERSION 1
+#define RECORD_MAX_SEG 64              /* códigos guardados por línea */
+
+enum { RR_CWD = 1, RR_DIRS, RR_LINE };
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t wall_ns;       /* inicio de la captura (CLOCK_REALTIME) */
+} RecordHdr;
+
+typedef struct {
+    uint32_t type;
+    uint32_t len;
+} RecordRec;
+
+typedef struct {
+    uint64_t start_ns;      /* desde el inicio de la captura */
+    uint64_t dur_ns;
+    int32_t  status;
+    uint32_t nseg;
+} RecordLine;
+
+/* --- Captura --- */
+
+/* Crea el log (lo trunca si existía). Retorna 0 o -1. */
+int  record_open(const char *file);
+
+/* Una línea terminada. start y end son instantes de CLOCK_MONOTONIC en ns
+   (como stats_now()); cwd y dirs, los vigentes al empezar. */
+void record_line(const char *text, const char *cwd, char *const *dirs, int ndirs,
+                 uint64_t start, uint64_t end, int status, const int32_t *seg, int nseg);
+
+void record_close(void);
+
+/* --- Reproducción --- */
+
+/* Línea leída del log. Los punteros valen hasta replay_close. */
+typedef struct {
+    RecordLine     hdr;
+    int32_t        seg[RECORD_MAX_SEG];
+    const char    *text;
+    const char    *cwd;         /* vigente; NULL si el log no lo trae */
+    char         **dirs;        /* PATH vigente */
+    int            ndirs;
+    int            cwd_changed, dirs_changed;
+} ReplayLine;
+
+typedef struct Replay Replay;
+
+/* Abre el log. NULL si no existe o no es un log de wish. */
+Replay *replay_open(const char *file);
+
+/* Siguiente línea: 1, 0 al terminar o -1 si el log está dañado */
+int     replay_next(Replay *r, ReplayLine *out);
+
+void    replay_close(Replay *r);
+
+#endif
@@ -0,0 +1,506 @@
+/*
+ * wish_remote.c – Protocolo con wish_worker y despacho de trabajos remotos
+ */
+
+#define _GNU_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "wish_remote.h"
+
+#define REMOTE_MAX_MSG (16u << 20)     /* tope de un mensaje: 16 MiB */
+
+static const char ERRMSG[] = "An error has occurred\n";
+
+/* --------------------- Utilidades del protocolo --------------------- */
+
+static int write_all(int fd, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == ENOTSOCK) n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+int remote_send(int fd, uint32_t type, uint32_t id, const void *data, size_t len) {
+    if (len > REMOTE_MAX_MSG) return -1;
+    RemoteMsg m = { htonl(type), htonl(id), htonl((uint32_t)len) };
+    if (write_all(fd, &m, sizeof(m)) < 0) return -1;
+    return len ? write_all(fd, data, len) : 0;
+}
+
+int remote_read_token(const char *file, char tok[REMOTE_TOKEN_MAX]) {
+    int fd = open(file, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    ssize_t n = read(fd, tok, REMOTE_TOKEN_MAX - 1);
+    close(fd);
+    if (n <= 0) return -1;
+    tok[n] = '\0';
+    size_t len = strcspn(tok, "\r\n");
+    /* Sin fin de línea dentro de lo leído: la clave podría seguir */
+    if (len == 0 || (len == (size_t)n && n == REMOTE_TOKEN_MAX - 1)) return -1;
+    tok[len] = '\0';
+    return (int)len;
+}
+
+ssize_t remote_pack_strv(char **buf, size_t *cap, size_t off, char *const *v, int n) {
+    for (int i = 0; i < n; i++) {
+        size_t l = strlen(v[i]) + 1;
+        if (off + l > *cap) {
+            size_t ncap = *cap ? *cap : 256;
+            while (off + l > ncap) ncap *= 2;
+            char *nb = realloc(*buf, ncap);
+            if (!nb) return -1;
+            *buf = nb;
+            *cap = ncap;
+        }
+        memcpy(*buf + off, v[i], l);
+        off += l;
+    }
+    return (ssize_t)off;
+}
+
+static int unix_socket(const char *path, int do_listen) {
+    struct sockaddr_un sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(sa.sun_path)) return -1;
+    strcpy(sa.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (do_listen) {
+        /* Solo el dueño puede conectarse: el agente ejecuta lo que le pidan */
+        unlink(path);
+        mode_t old = umask(077);
+        int ok = bind(fd, (struct sockaddr *)&sa, sizeof(sa)) == 0;
+        umask(old);
+        if (ok && listen(fd, 64) == 0) return fd;
+    } else if (connect(fd, (struct sockaddr *)&sa, sizeof(sa)) == 0) {
+        return fd;
+    }
+    close(fd);
+    return -1;
+}
+
+/* Socket conectado o escuchando en sa; -1 si falla */
+static int tcp_try(int family, const struct sockaddr *sa, socklen_t len, int do_listen) {
+    int fd = socket(family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    if (do_listen) {
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, sa, len) == 0 && listen(fd, 64) == 0) return fd;
+    } else if (connect(fd, sa, len) == 0) {
+        /* Mensajes pequeños e interactivos: sin Nagle */
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        return fd;
+    }
+    close(fd);
+    return -1;
+}
+
+/* "host:puerto" o solo "puerto" (loopback, también al escuchar) */
+static int tcp_socket(const char *addr, int do_listen) {
+    char host[256];
+    const char *port = strrchr(addr, ':');
+    if (port) {
+        size_t hl = (size_t)(port - addr);
+        if (hl >= sizeof(host)) return -1;
+        memcpy(host, addr, hl);
+        host[hl] = '\0';
+        port++;
+    } else {
+        port = addr;
+    }
+    const char *h = addr != port && *host ? host : NULL;
+
+#ifdef WISH_STATIC
+    /* Binario estático: sin NSS no hay getaddrinfo, solo direcciones
+       numéricas y "localhost" */
+    char *end;
+    long pn = strtol(port, &end, 10);
+    if (*port == '\0' || *end || pn < 0 || pn > 65535) return -1;
+    struct sockaddr_in in4;
+    struct sockaddr_in6 in6;
+    memset(&in4, 0, sizeof(in4));
+    memset(&in6, 0, sizeof(in6));
+    in4.sin_family = AF_INET;
+    in4.sin_port = htons((uint16_t)pn);
+    in6.sin6_family = AF_INET6;
+    in6.sin6_port = in4.sin_port;
+    if (!h || !strcmp(h, "localhost")) {
+        in4.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    } else if (inet_pton(AF_INET6, h, &in6.sin6_addr) == 1) {
+        return tcp_try(AF_INET6, (struct sockaddr *)&in6, sizeof(in6), do_listen);
+    } else if (inet_pton(AF_INET, h, &in4.sin_addr) != 1) {
+        return -1;
+    }
+    return tcp_try(AF_INET, (struct sockaddr *)&in4, sizeof(in4), do_listen);
+#else
+    struct addrinfo hints, *res;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = h ? AF_UNSPEC : AF_INET;  /* sin host: 127.0.0.1 */
+    hints.ai_socktype = SOCK_STREAM;
+    /* Sin host y sin AI_PASSIVE getaddrinfo da las de loopback */
+    hints.ai_flags = do_listen && h ? AI_PASSIVE : 0;
+    if (getaddrinfo(h, port, &hints, &res) != 0) return -1;
+
+    int fd = -1;
+    for (struct addrinfo *ai = res; ai && fd < 0; ai = ai->ai_next) {
+        fd = tcp_try(ai->ai_family, ai->ai_addr, ai->ai_addrlen, do_listen);
+    }
+    freeaddrinfo(res);
+    return fd;
+#endif
+}
+
+int remote_socket(const char *spec, int do_listen) {
+    if (!strncmp(spec, "unix:", 5)) return unix_socket(spec + 5, do_listen);
+    if (!strncmp(spec, "tcp:", 4)) return tcp_socket(spec + 4, do_listen);
+    return -1;
+}
+
+/* --------------------- Cliente --------------------- */
+
+typedef struct {
+    int      fd;                /* -1 si el agente se perdió */
+    int      inflight;          /* trabajos enviados sin MSG_EXIT */
+    int      has_state;
+    uint32_t state_hash;        /* último cwd/path/entorno enviado */
+    char    *rx;                /* mensajes recibidos a medias */
+    size_t   rx_len, rx_cap;
+} Worker;
+
+typedef struct {
+    uint32_t id;
+    int      worker;
+    int      out_fd, err_fd;
+    int      own_fd;            /* out_fd es el archivo de '>' */
+} RJob;
+
+typedef struct {
+    uint32_t id;
+    int      code;
+} Done;
+
+static Worker   workers[REMOTE_MAX_WORKERS];
+static int      nworkers;
+static RJob    *rjobs;
+static int      nrjobs, cap_rjobs;
+static Done    *done;
+static int      ndone, cap_done;
+static uint32_t next_id = 1;
+static char    *txbuf;
+static size_t   txcap;
+
+int remote_enabled(void) {
+    return nworkers > 0;
+}
+
+/* Presenta la clave y espera la aceptación del agente */
+static int hello(int fd, const char *tok, size_t len) {
+    RemoteMsg m;
+    if (remote_send(fd, MSG_HELLO, 0, tok, len) < 0) return -1;
+    for (size_t got = 0; got < sizeof(m); ) {
+        ssize_t n = read(fd, (char *)&m + got, sizeof(m) - got);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        got += (size_t)n;
+    }
+    return ntohl(m.type) == MSG_HELLO && m.len == 0 ? 0 : -1;
+}
+
+int remote_connect(const char *specs, const char *token_file) {
+    char tok[REMOTE_TOKEN_MAX];
+    int toklen = token_file ? remote_read_token(token_file, tok) : 0;
+    if (toklen < 0) return -1;
+    char *copy = strdup(specs);
+    if (!copy) return -1;
+    int rc = 0;
+    char *save = NULL;
+    for (char *s = strtok_r(copy, ",", &save); s; s = strtok_r(NULL, ",", &save)) {
+        if (nworkers == REMOTE_MAX_WORKERS) { rc = -1; break; }
+        int fd = remote_socket(s, 0);
+        if (fd >= 0 && toklen > 0 && hello(fd, tok, (size_t)toklen) < 0) {
+            close(fd);
+            fd = -1;
+        }
+        /* Tras el saludo el socket no bloquea: ver worker_send */
+        if (fd >= 0 && fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0) {
+            close(fd);
+            fd = -1;
+        }
+        if (fd < 0) { rc = -1; break; }
+        memset(&workers[nworkers], 0, sizeof(Worker));
+        workers[nworkers++].fd = fd;
+    }
+    free(copy);
+    if (rc == 0 && nworkers == 0) rc = -1;
+    if (rc < 0) remote_close();
+    return rc;
+}
+
+void remote_close(void) {
+    for (int i = 0; i < nworkers; i++) {
+        if (workers[i].fd >= 0) close(workers[i].fd);
+        free(workers[i].rx);
+    }
+    for (int i = 0; i < nrjobs; i++) {
+        if (rjobs[i].own_fd) close(rjobs[i].out_fd);
+    }
+    nworkers = 0;
+    free(rjobs);
+    rjobs = NULL;
+    nrjobs = cap_rjobs = 0;
+    free(done);
+    done = NULL;
+    ndone = cap_done = 0;
+    free(txbuf);
+    txbuf = NULL;
+    txcap = 0;
+}
+
+static RJob *find_job(uint32_t id) {
+    for (int i = 0; i < nrjobs; i++) {
+        if (rjobs[i].id == id) return &rjobs[i];
+    }
+    return NULL;
+}
+
+/* Saca el trabajo de la tabla y deja su código listo para remote_wait */
+static void job_done(RJob *j, int code) {
+    if (ndone == cap_done) {
+        int ncap = cap_done ? cap_done * 2 : 16;
+        Done *nd = realloc(done, (size_t)ncap * sizeof(Done));
+        if (!nd) return;        /* sin memoria: el trabajo queda colgado */
+        done = nd;
+        cap_done = ncap;
+    }
+    done[ndone++] = (Done){ j->id, code };
+    workers[j->worker].inflight--;
+    if (j->own_fd) close(j->out_fd);
+    *j = rjobs[--nrjobs];
+}
+
+/* Agente perdido: sus trabajos fallan como lo haría un fork/exec local */
+static void worker_lost(int w) {
+    close(workers[w].fd);
+    workers[w].fd = -1;
+    for (int i = nrjobs - 1; i >= 0; i--) {
+        if (rjobs[i].worker != w) continue;
+        write_all(rjobs[i].err_fd, ERRMSG, strlen(ERRMSG));
+        job_done(&rjobs[i], 1);
+    }
+}
+
+static uint32_t hash_str(uint32_t h, const char *s) {
+    for (const unsigned char *p = (const unsigned char *)s; ; p++) {
+        h = (h ^ *p) * 16777619u;
+        if (!*p) return h;
+    }
+}
+
+static uint32_t state_hash(const char *cwd, char *const *paths, int npaths, char *const *envp) {
+    uint32_t h = hash_str(2166136261u, cwd);
+    for (int i = 0; i < npaths; i++) h = hash_str(h, paths[i]);
+    /* Separa los dirs del entorno: "path a" + "B=1" no es "path a B=1" */
+    h = (h ^ 0xff) * 16777619u;
+    for (int i = 0; envp[i]; i++) h = hash_str(h, envp[i]);
+    return h;
+}
+
+static int fill(int w);
+
+/* Escribe en el socket del agente w. Si está lleno se atiende lo que llega
+   mientras tanto: el agente puede estar bloqueado enviando la salida de
+   otro trabajo, y si nadie la leyera ninguno de los dos avanzaría. */
+static int worker_write(int w, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = send(workers[w].fd, p, len, MSG_NOSIGNAL);
+        if (n >= 0) {
+            p += n;
+            len -= (size_t)n;
+            continue;
+        }
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) return -1;
+        struct pollfd pfd = { workers[w].fd, POLLIN | POLLOUT, 0 };
+        if (poll(&pfd, 1, -1) < 0 && errno != EINTR) return -1;
+        if ((pfd.revents & (POLLIN | POLLHUP | POLLERR)) && fill(w) < 0) return -1;
+    }
+    return 0;
+}
+
+/* remote_send hacia un agente del cliente */
+static int worker_send(int w, uint32_t type, uint32_t id, const void *data, size_t len) {
+    if (len > REMOTE_MAX_MSG) return -1;
+    RemoteMsg m = { htonl(type), htonl(id), htonl((uint32_t)len) };
+    if (worker_write(w, &m, sizeof(m)) < 0) return -1;
+    return len ? worker_write(w, data, len) : 0;
+}
+
+static int send_state(int w, const char *cwd, char *const *paths, int npaths, char *const *envp) {
+    Worker *wk = &workers[w];
+    uint32_t h = state_hash(cwd, paths, npaths, envp);
+    if (wk->has_state && wk->state_hash == h) return 0;
+    char *const one[1] = { (char *)cwd };
+    int nenv = 0;
+    while (envp[nenv]) nenv++;
+    ssize_t len = remote_pack_strv(&txbuf, &txcap, 0, one, 1);
+    if (len >= 0) len = remote_pack_strv(&txbuf, &txcap, (size_t)len, paths, npaths);
+    if (len >= 0) len = remote_pack_strv(&txbuf, &txcap, (size_t)len, envp, nenv);
+    if (len < 0 || worker_send(w, MSG_STATE, (uint32_t)npaths, txbuf, (size_t)len) < 0) {
+        return -1;
+    }
+    wk->has_state = 1;
+    wk->state_hash = h;
+    return 0;
+}
+
+int remote_dispatch(char *const *argv, int fd, const char *cwd,
+                    char *const *paths, int npaths, char *const *envp, uint32_t *id) {
+    if (nrjobs == cap_rjobs) {
+        int ncap = cap_rjobs ? cap_rjobs * 2 : 16;
+        RJob *nj = realloc(rjobs, (size_t)ncap * sizeof(RJob));
+        if (!nj) return -1;
+        rjobs = nj;
+        cap_rjobs = ncap;
+    }
+
+    int argc = 0;
+    while (argv[argc]) argc++;
+    if (!txcap) {
+        txbuf = malloc(256);
+        if (!txbuf) return -1;
+        txcap = 256;
+    }
+
+    for (;;) {
+        /* Agente vivo con menos trabajos en curso */
+        int best = -1;
+        for (int i = 0; i < nworkers; i++) {
+            if (workers[i].fd < 0) continue;
+            if (best < 0 || workers[i].inflight < workers[best].inflight) best = i;
+        }
+        if (best < 0) break;
+
+        Worker *wk = &workers[best];
+        ssize_t len = -1;
+        if (send_state(best, cwd, paths, npaths, envp) == 0) {
+            txbuf[0] = fd >= 0 ? RUN_COMBINED : 0;
+            len = remote_pack_strv(&txbuf, &txcap, 1, argv, argc);
+        }
+        if (len >= 0 && worker_send(best, MSG_RUN, next_id, txbuf, (size_t)len) == 0) {
+            RJob *j = &rjobs[nrjobs++];
+            j->id = next_id++;
+            j->worker = best;
+            j->out_fd = fd >= 0 ? fd : STDOUT_FILENO;
+            j->err_fd = fd >= 0 ? fd : STDERR_FILENO;
+            j->own_fd = fd >= 0;
+            wk->inflight++;
+            *id = j->id;
+            return 0;
+        }
+        worker_lost(best);
+    }
+    return -1;
+}
+
+/* Procesa los mensajes completos que haya en el búfer del agente w */
+static int drain(int w) {
+    Worker *wk = &workers[w];
+    size_t pos = 0;
+    while (wk->rx_len - pos >= sizeof(RemoteMsg)) {
+        RemoteMsg m;
+        memcpy(&m, wk->rx + pos, sizeof(m));
+        m.type = ntohl(m.type);
+        m.id = ntohl(m.id);
+        m.len = ntohl(m.len);
+        if (m.len > REMOTE_MAX_MSG) return -1;
+        if (wk->rx_len - pos - sizeof(m) < m.len) break;
+        const char *data = wk->rx + pos + sizeof(m);
+        pos += sizeof(m) + m.len;
+
+        RJob *j = find_job(m.id);
+        if (!j) continue;
+        if (m.type == MSG_OUT) {
+            write_all(j->out_fd, data, m.len);
+        } else if (m.type == MSG_ERR) {
+            write_all(j->err_fd, data, m.len);
+        } else if (m.type == MSG_EXIT && m.len == sizeof(uint32_t)) {
+            uint32_t code;
+            memcpy(&code, data, sizeof(code));
+            job_done(j, (int)ntohl(code));
+        }
+    }
+    memmove(wk->rx, wk->rx + pos, wk->rx_len - pos);
+    wk->rx_len -= pos;
+    return 0;
+}
+
+static int fill(int w) {
+    Worker *wk = &workers[w];
+    if (wk->rx_cap - wk->rx_len < 65536) {
+        char *nb = realloc(wk->rx, wk->rx_cap + 65536);
+        if (!nb) return -1;
+        wk->rx = nb;
+        wk->rx_cap += 65536;
+    }
+    ssize_t n;
+    do {
+        n = read(wk->fd, wk->rx + wk->rx_len, wk->rx_cap - wk->rx_len);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+    if (n <= 0) return -1;
+    wk->rx_len += (size_t)n;
+    return drain(w);
+}
+
+int remote_wait(int timeout_ms, uint32_t *id, int *code) {
+    struct pollfd pfd[REMOTE_MAX_WORKERS];
+    int map[REMOTE_MAX_WORKERS];
+
+    while (ndone == 0) {
+        int n = 0;
+        for (int i = 0; i < nworkers; i++) {
+            if (workers[i].fd < 0 || workers[i].inflight == 0) continue;
+            pfd[n].fd = workers[i].fd;
+            pfd[n].events = POLLIN;
+            map[n++] = i;
+        }
+        if (n == 0) return 0;
+
+        int r = poll(pfd, (nfds_t)n, timeout_ms);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return 0;
+        for (int k = 0; k < n; k++) {
+            if (pfd[k].revents && fill(map[k]) < 0) worker_lost(map[k]);
+        }
+    }
+
+    *id = done[0].id;
+    *code = done[0].code;
+    memmove(done, done + 1, (size_t)(--ndone) * sizeof(Done));
+    return 1;
+}
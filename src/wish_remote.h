@@ -0,0 +1,96 @@
+/*
+ * wish_remote.h – Ejecución de comandos externos en agentes remotos
+ *
+ * "wish --workers unix:/ruta,tcp:host:puerto [script]" conecta con uno o
+ * más wish_worker y les envía los comandos externos de cada línea: cada
+ * comando va al agente con menos trabajos en curso. El agente devuelve
+ * stdout, stderr y el código de salida por el mismo socket; la redirección
+ * '>' se aplica aquí, en la máquina de wish.
+ *
+ * Seguridad: un agente ejecuta cualquier binario que le pida quien se
+ * conecte, con los permisos de su usuario. Por eso "tcp:puerto" sin host
+ * escucha solo en loopback (para otras máquinas hay que dar la dirección,
+ * p. ej. "tcp:0.0.0.0:puerto"), y con TCP el agente exige un secreto
+ * compartido: "wish_worker -k archivo" y "wish --workers ... --token
+ * archivo" leen la misma clave y la sesión no se acepta hasta que wish la
+ * presenta (MSG_HELLO). El socket UNIX queda con permisos 0600 y la clave
+ * es opcional. El canal no va cifrado: la clave y los datos viajan en
+ * claro, así que entre máquinas conviene una red de confianza o un túnel.
+ *
+ * Protocolo: mensajes con cabecera RemoteMsg (en orden de red) seguida de
+ * len bytes.
+ *   MSG_HELLO  wish -> agente  la clave; el agente responde MSG_HELLO vacío
+ *   MSG_STATE  wish -> agente  cwd '\0' dir1 '\0' ... dirN '\0' y después
+ *                              el entorno, "NOMBRE=valor" '\0' ...
+ *                              (id = número de dirs)
+ *   MSG_RUN    wish -> agente  flags (1 byte) + argv separado por '\0'
+ *   MSG_OUT    agente -> wish  bytes de stdout (o de ambos si RUN_COMBINED)
+ *   MSG_ERR    agente -> wish  bytes de stderr
+ *   MSG_EXIT   agente -> wish  código de salida (uint32_t en orden de red,
+ *                              128+señal)
+ * El estado (cwd, path y el entorno que mantienen export/unset) es por
+ * sesión: wish lo reenvía a cada agente solo cuando cambió desde el último
+ * comando que le mandó, y los comandos remotos ven el mismo entorno que
+ * los locales.
+ */
+
+#ifndef WISH_REMOTE_H
+#define WISH_REMOTE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define REMOTE_MAX_WORKERS 32
+
+enum { MSG_STATE = 1, MSG_RUN, MSG_OUT, MSG_ERR, MSG_EXIT, MSG_HELLO };
+
+#define REMOTE_TOKEN_MAX 256
+
+#define RUN_COMBINED 0x1    /* stdout y stderr por el mismo canal ('>') */
+
+typedef struct {
+    uint32_t type;
+    uint32_t id;            /* trabajo al que se refiere el mensaje */
+    uint32_t len;
+} RemoteMsg;
+
+/* --------------------- Utilidades del protocolo --------------------- */
+
+/* Abre un socket según spec ("unix:/ruta", "tcp:host:puerto");
+   listen != 0 para el lado del agente. Retorna el fd o -1. */
+int remote_socket(const char *spec, int listen);
+
+/* Lee la clave compartida (primera línea de file, sin el '\n'). Retorna su
+   longitud o -1 si falta, está vacía o es demasiado larga. */
+int remote_read_token(const char *file, char tok[REMOTE_TOKEN_MAX]);
+
+/* Envía un mensaje completo (la cabecera se pasa a orden de red). Retorna
+   0 o -1. */
+int remote_send(int fd, uint32_t type, uint32_t id, const void *data, size_t len);
+
+/* Empaqueta un vector de cadenas separadas por '\0' a partir de off.
+   Retorna el nuevo tamaño o -1. */
+ssize_t remote_pack_strv(char **buf, size_t *cap, size_t off, char *const *v, int n);
+
+/* --------------------- Cliente (wish) --------------------- */
+
+/* Conecta con la lista de agentes separada por comas y, con token_file,
+   se presenta a cada uno con la clave. Retorna 0 o -1. */
+int  remote_connect(const char *specs, const char *token_file);
+int  remote_enabled(void);
+void remote_close(void);
+
+/* Envía argv al agente menos cargado, que lo ejecuta en cwd con ese PATH
+   y el entorno envp. Si redir_fd >= 0 la salida combinada se escribe ahí
+   y el fd pasa a ser del módulo. Retorna 0 (en *id el trabajo) o -1 si no
+   hay agentes disponibles (el fd sigue siendo del llamador). */
+int  remote_dispatch(char *const *argv, int redir_fd, const char *cwd,
+                     char *const *paths, int npaths, char *const *envp, uint32_t *id);
+
+/* Espera hasta timeout_ms (-1 = sin límite) a que termine algún trabajo.
+   Retorna 1 con *id y *code, o 0 si venció el plazo. Si un agente se
+   desconecta, sus trabajos terminan con código 1. */
+int  remote_wait(int timeout_ms, uint32_t *id, int *code);
+
+#endif
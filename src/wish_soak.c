@@ -0,0 +1,297 @@
+/*
+ * wish_soak.c — Prueba de resistencia (soak) y fugas para el shell WISH
+ *
+ * Alimenta a wish (modo batch sobre /dev/stdin) con millones de líneas
+ * generadas: built-ins, redirecciones, grupos '&' y errores de sintaxis.
+ * Cada -s líneas toma una muestra de VmRSS (/proc/<pid>/status) y del número
+ * de descriptores abiertos (/proc/<pid>/fd). Falla si, pasada la fase de
+ * calentamiento, la RSS crece de forma monótona por encima de la tolerancia
+ * o si el número de descriptores aumenta.
+ *
+ * Uso: wish_soak [-b binario] [-n líneas] [-s cada] [-x 1/N externos]
+ *                [-k tolerancia_kb] [-S semilla] [-a [lib.so]]
+ *   -a  ejecuta wish con LD_PRELOAD del contador de asignaciones
+ *       (wish_alloc_count.c) e informa asignaciones y bloques vivos por línea
+ */
+
+#define _GNU_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <signal.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/wait.h>
+
+#define DEFAULT_BIN   "../bin/wish_victory_v2"
+#define DEFAULT_LIB   "../bin/libwish_alloc_count.so"
+#define MAX_SAMPLES   4096
+
+typedef struct {
+    long line;
+    long rss_kb;
+    int  fds;
+    unsigned long allocs, live;   /* solo en modo -a */
+} Sample;
+
+static Sample samples[MAX_SAMPLES];
+static int nsamples;
+
+/* --------------------- Muestreo de /proc --------------------- */
+
+static long read_rss_kb(pid_t pid) {
+    char path[64], line[256];
+    snprintf(path, sizeof(path), "/proc/%d/status", (int)pid);
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    long kb = -1;
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "VmRSS: %ld", &kb) == 1) break;
+    }
+    fclose(f);
+    return kb;
+}
+
+static int count_fds(pid_t pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/fd", (int)pid);
+    DIR *d = opendir(path);
+    if (!d) return -1;
+    int n = 0;
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        if (de->d_name[0] != '.') n++;
+    }
+    closedir(d);
+    return n;
+}
+
+/* Última línea del reporte del contador de asignaciones */
+static int read_alloc_report(const char *path, unsigned long *allocs, unsigned long *live) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    char line[256];
+    int ok = -1;
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "allocs=%lu frees=%*u live=%lu", allocs, live) == 2) ok = 0;
+    }
+    fclose(f);
+    return ok;
+}
+
+/* --------------------- Generador de líneas --------------------- */
+
+/* Rota por una mezcla fija con algo de azar; los externos van con 1/ext_every */
+static int gen_line(char *buf, size_t sz, long i, int ext_every) {
+    int r = rand();
+    if (ext_every > 0 && r % ext_every == 0) {
+        switch ((r / ext_every) % 4) {
+        case 0:  return snprintf(buf, sz, "true\n");
+        case 1:  return snprintf(buf, sz, "echo %ld > soak_out\n", i);
+        case 2:  return snprintf(buf, sz, "true & true & echo x>soak_par\n");
+        default: return snprintf(buf, sz, "ls /no/such/dir_%ld\n", i % 7);
+        }
+    }
+    switch (r % 14) {
+    case 0:  return snprintf(buf, sz, "cd .\n");
+    case 1:  return snprintf(buf, sz, "cd\n");                       /* error */
+    case 2:  return snprintf(buf, sz, "cd a b\n");                   /* error */
+    case 3:  return snprintf(buf, sz, "path /bin /usr/bin\n");
+    case 4:  return snprintf(buf, sz, "path /bin /usr/bin /usr/local/bin /sbin\n");
+    case 5:  return snprintf(buf, sz, "exit %ld\n", i);              /* error */
+    case 6:  return snprintf(buf, sz, "> soak_%ld\n", i % 5);        /* sintaxis */
+    case 7:  return snprintf(buf, sz, "ls > a > b\n");               /* sintaxis */
+    case 8:  return snprintf(buf, sz, "ls > a b\n");                 /* sintaxis */
+    case 9:  return snprintf(buf, sz, "ls >\n");                     /* sintaxis */
+    case 10: return snprintf(buf, sz, "&\n");
+    case 11: return snprintf(buf, sz, " & & \n");
+    case 12: return snprintf(buf, sz, "cd . & cd . & path /bin\n");
+    default: return snprintf(buf, sz, "   \t \n");
+    }
+}
+
+/* --------------------- Análisis --------------------- */
+
+/* Crecimiento monótono: la RSS final supera a la inicial (tras calentamiento)
+   en más de tol_kb y no disminuye en al menos el 80% de los intervalos */
+static int rss_grows(int from, long tol_kb) {
+    if (nsamples - from < 3) return 0;
+    int up = 0, steps = 0;
+    for (int i = from + 1; i < nsamples; i++, steps++) {
+        if (samples[i].rss_kb >= samples[i - 1].rss_kb) up++;
+    }
+    long growth = samples[nsamples - 1].rss_kb - samples[from].rss_kb;
+    return growth > tol_kb && up * 5 >= steps * 4;
+}
+
+static int fds_grow(int from) {
+    for (int i = from + 1; i < nsamples; i++) {
+        if (samples[i].fds > samples[from].fds) return 1;
+    }
+    return 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "uso: %s [-b bin] [-n líneas] [-s cada] [-x N] [-k kb] [-S semilla] [-a [lib.so]]\n",
+            prog);
+    exit(2);
+}
+
+int main(int argc, char *argv[]) {
+    const char *bin = DEFAULT_BIN;
+    const char *lib = NULL;
+    long nlines = 1000000;
+    long every = 10000;
+    int ext_every = 200;
+    long tol_kb = 512;
+    unsigned seed = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "b:n:s:x:k:S:a::")) != -1) {
+        switch (opt) {
+        case 'b': bin = optarg; break;
+        case 'n': nlines = atol(optarg); break;
+        case 's': every = atol(optarg); break;
+        case 'x': ext_every = atoi(optarg); break;
+        case 'k': tol_kb = atol(optarg); break;
+        case 'S': seed = (unsigned)strtoul(optarg, NULL, 10); break;
+        case 'a': lib = optarg ? optarg : DEFAULT_LIB; break;
+        default:  usage(argv[0]);
+        }
+    }
+    if (nlines <= 0 || every <= 0) usage(argv[0]);
+    if (nlines / every > MAX_SAMPLES - 1) every = nlines / (MAX_SAMPLES - 1) + 1;
+    srand(seed);
+
+    char bin_abs[PATH_MAX], lib_abs[PATH_MAX];
+    if (!realpath(bin, bin_abs)) { perror(bin); return 2; }
+    if (lib && !realpath(lib, lib_abs)) { perror(lib); return 2; }
+
+    /* Directorio de trabajo privado: las redirecciones escriben aquí */
+    char workdir[] = "/tmp/wish_soak_XXXXXX";
+    if (!mkdtemp(workdir)) { perror("mkdtemp"); return 2; }
+    char report[PATH_MAX];
+    snprintf(report, sizeof(report), "%s/alloc.report", workdir);
+
+    int pfd[2];
+    if (pipe(pfd) != 0) { perror("pipe"); return 2; }
+    signal(SIGPIPE, SIG_IGN);
+
+    pid_t pid = fork();
+    if (pid < 0) { perror("fork"); return 2; }
+    if (pid == 0) {
+        dup2(pfd[0], STDIN_FILENO);
+        close(pfd[0]);
+        close(pfd[1]);
+        if (freopen("/dev/null", "w", stdout) == NULL ||
+            freopen("/dev/null", "w", stderr) == NULL) _exit(127);
+        if (chdir(workdir) != 0) _exit(127);
+        if (lib) {
+            setenv("LD_PRELOAD", lib_abs, 1);
+            setenv("WISH_ALLOC_REPORT", report, 1);
+        }
+        execl(bin_abs, bin_abs, "/dev/stdin", (char *)NULL);
+        _exit(127);
+    }
+    close(pfd[0]);
+    FILE *to = fdopen(pfd[1], "w");
+
+    printf("🧪 Soak de %s: %ld líneas, muestra cada %ld%s\n",
+           bin, nlines, every, lib ? " (contador de asignaciones)" : "");
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    char line[256];
+    long i;
+    for (i = 0; i < nlines; i++) {
+        int n = gen_line(line, sizeof(line), i, ext_every);
+        if (fwrite(line, 1, (size_t)n, to) != (size_t)n) break;   /* wish murió */
+
+        if ((i + 1) % every == 0 && nsamples < MAX_SAMPLES) {
+            fflush(to);
+            Sample *s = &samples[nsamples];
+            s->line = i + 1;
+            s->rss_kb = read_rss_kb(pid);
+            s->fds = count_fds(pid);
+            s->allocs = s->live = 0;
+            if (s->rss_kb < 0 || s->fds < 0) break;
+            if (lib) {
+                kill(pid, SIGUSR1);
+                usleep(1000);
+                read_alloc_report(report, &s->allocs, &s->live);
+            }
+            nsamples++;
+        }
+    }
+    fclose(to);
+
+    int status;
+    waitpid(pid, &status, 0);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+    int failed = 0;
+    if (i < nlines || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        printf("❌ wish terminó antes de tiempo en la línea %ld (estado %d)\n", i, status);
+        failed = 1;
+    }
+
+    printf("%10s %10s %6s", "línea", "RSS(kB)", "fds");
+    if (lib) printf(" %12s %10s", "allocs", "vivos");
+    printf("\n");
+    int stride = nsamples > 20 ? nsamples / 20 : 1;
+    for (int k = 0; k < nsamples; k += stride) {
+        printf("%10ld %10ld %6d", samples[k].line, samples[k].rss_kb, samples[k].fds);
+        if (lib) printf(" %12lu %10lu", samples[k].allocs, samples[k].live);
+        printf("\n");
+    }
+
+    int warm = nsamples / 10;
+    if (rss_grows(warm, tol_kb)) {
+        printf("❌ RSS crece de forma monótona: %ld kB → %ld kB\n",
+               samples[warm].rss_kb, samples[nsamples - 1].rss_kb);
+        failed = 1;
+    }
+    if (nsamples > 0 && fds_grow(warm)) {
+        printf("❌ Los descriptores abiertos crecen: %d → %d\n",
+               samples[warm].fds, samples[nsamples - 1].fds);
+        failed = 1;
+    }
+
+    if (lib) {
+        unsigned long allocs = 0, live = 0;
+        if (read_alloc_report(report, &allocs, &live) == 0 && i > 0) {
+            printf("📊 %.2f asignaciones por línea; %lu bloques sin liberar al salir\n",
+                   (double)allocs / (double)i, live);
+            if (nsamples > warm + 1) {
+                long dl = samples[nsamples - 1].line - samples[warm].line;
+                long dv = (long)samples[nsamples - 1].live - (long)samples[warm].live;
+                printf("📊 %.4f bloques vivos nuevos por línea tras el calentamiento\n",
+                       dl ? (double)dv / (double)dl : 0.0);
+                if (dv > 0 && dv * 1000 > dl) {
+                    printf("❌ Los bloques vivos crecen con el número de líneas\n");
+                    failed = 1;
+                }
+            }
+        } else {
+            printf("⚠️  No se obtuvo el reporte de asignaciones (%s)\n", report);
+        }
+    }
+
+    printf("⏱️  %.1f s (%.0f líneas/s)\n", secs, secs > 0 ? (double)i / secs : 0.0);
+    printf("%s\n", failed ? "❌ SOAK FALLÓ" : "✅ SOAK SUPERADO");
+
+    /* Limpieza del directorio de trabajo */
+    const char *junk[] = { "alloc.report", "soak_out", "soak_par", "a",
+                           "soak_0", "soak_1", "soak_2", "soak_3", "soak_4" };
+    char p[PATH_MAX + 32];
+    for (size_t k = 0; k < sizeof(junk) / sizeof(junk[0]); k++) {
+        snprintf(p, sizeof(p), "%s/%s", workdir, junk[k]);
+        unlink(p);
+    }
+    rmdir(workdir);
+    return failed;
+}
@@ -0,0 +1,161 @@
+/*
+ * wish_startup.c — Tiempo de arranque (exec→exit) de varios binarios WISH
+ *
+ * Lanza cada binario N veces con un fragmento mínimo y mide desde
+ * posix_spawn hasta que waitpid lo recoge: cargador dinámico, inicio de
+ * libc, lectura del fragmento y salida. Los binarios se alternan en cada
+ * ronda para repartir el ruido, y antes se hacen unas rondas de
+ * calentamiento que no se cuentan.
+ *
+ * Por defecto el fragmento se escribe en un script temporal que se pasa
+ * como argumento y también como stdin: así sirve igual para los shells en
+ * modo batch y para bin/wish, que solo lee stdin. Con -c se ejecuta
+ * "binario -c fragmento" (solo los binarios que entienden -c).
+ *
+ * Uso: wish_startup [-n N] [-l fragmento] [-c] binario...
+ *   -n   ejecuciones por binario (por defecto 1000)
+ *   -l   fragmento a ejecutar (por defecto "cd /")
+ *
+ * Reporta mínimo, mediana, p90 y media en microsegundos, y la mediana de
+ * cada binario respecto a la del primero.
+ */
+
+#define _GNU_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <time.h>
+#include <sys/wait.h>
+
+#define MAX_BINS  8
+#define WARMUP    20
+
+extern char **environ;
+
+typedef struct {
+    const char *path;
+    double     *us;         /* una muestra por ejecución correcta */
+    int         n;
+    int         failed;     /* ejecuciones que no terminaron con 0 */
+} Bin;
+
+static void die(const char *msg, const char *arg) {
+    fprintf(stderr, "wish_startup: %s%s%s\n", msg, arg ? ": " : "", arg ? arg : "");
+    exit(1);
+}
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Una ejecución; retorna los microsegundos o -1 si el binario falló */
+static double run_once(const char *bin, char *const *args, const char *in_path) {
+    posix_spawn_file_actions_t fa;
+    posix_spawn_file_actions_init(&fa);
+    posix_spawn_file_actions_addopen(&fa, STDIN_FILENO, in_path, O_RDONLY, 0);
+    posix_spawn_file_actions_addopen(&fa, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addopen(&fa, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+    double t0 = now_us();
+    pid_t pid;
+    int rc = posix_spawn(&pid, bin, &fa, NULL, args, environ);
+    posix_spawn_file_actions_destroy(&fa);
+    if (rc != 0) die("no se pudo ejecutar", bin);
+
+    int status;
+    if (waitpid(pid, &status, 0) < 0) die("waitpid", bin);
+    double t = now_us() - t0;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? t : -1;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "uso: %s [-n N] [-l fragmento] [-c] binario...\n", prog);
+    exit(2);
+}
+
+int main(int argc, char *argv[]) {
+    int n = 1000;
+    const char *snippet = "cd /";
+    int use_c = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:l:c")) != -1) {
+        switch (opt) {
+        case 'n': n = atoi(optarg); break;
+        case 'l': snippet = optarg; break;
+        case 'c': use_c = 1; break;
+        default: usage(argv[0]);
+        }
+    }
+    int nbins = argc - optind;
+    if (n < 1 || nbins < 1 || nbins > MAX_BINS) usage(argv[0]);
+
+    /* Script con el fragmento; con -c no se usa y stdin es /dev/null */
+    char script[] = "/tmp/wish_startup_XXXXXX";
+    int fd = mkstemp(script);
+    if (fd < 0) die("mkstemp", NULL);
+    dprintf(fd, "%s\n", snippet);
+    close(fd);
+
+    Bin bins[MAX_BINS];
+    for (int b = 0; b < nbins; b++) {
+        bins[b].path = argv[optind + b];
+        bins[b].n = bins[b].failed = 0;
+        bins[b].us = malloc((size_t)n * sizeof(double));
+        if (!bins[b].us) die("sin memoria", NULL);
+        if (access(bins[b].path, X_OK) != 0) die("no es ejecutable", bins[b].path);
+    }
+
+    for (int r = -WARMUP; r < n; r++) {
+        for (int b = 0; b < nbins; b++) {
+            char *args[4] = { (char *)bins[b].path, NULL, NULL, NULL };
+            if (use_c) {
+                args[1] = "-c";
+                args[2] = (char *)snippet;
+            } else {
+                args[1] = script;
+            }
+            double t = run_once(bins[b].path, args, use_c ? "/dev/null" : script);
+            if (r < 0) continue;
+            if (t < 0) bins[b].failed++;
+            else bins[b].us[bins[b].n++] = t;
+        }
+    }
+    unlink(script);
+
+    printf("Arranque exec→exit, %d ejecuciones por binario, fragmento \"%s\"%s\n\n",
+           n, snippet, use_c ? " (-c)" : "");
+    printf("%-28s %9s %9s %9s %9s %8s\n", "binario", "mín µs", "mediana", "p90", "media", "vs 1.º");
+    double base = 0;
+    for (int b = 0; b < nbins; b++) {
+        double *v = bins[b].us;
+        int k = bins[b].n;
+        if (k > 0) {
+            qsort(v, (size_t)k, sizeof(double), cmp_double);
+            double sum = 0;
+            for (int i = 0; i < k; i++) sum += v[i];
+            double med = (k % 2) ? v[k / 2] : (v[k / 2 - 1] + v[k / 2]) / 2.0;
+            if (b == 0) base = med;
+            printf("%-28s %9.1f %9.1f %9.1f %9.1f %7.2fx\n", bins[b].path, v[0], med,
+                   v[(int)(k * 0.9)], sum / k, base > 0 ? med / base : 0.0);
+        } else {
+            printf("%-28s %9s\n", bins[b].path, "-");
+        }
+        if (bins[b].failed) {
+            printf("%-28s ⚠️  %d ejecuciones terminaron con error\n", "", bins[b].failed);
+        }
+        free(v);
+    }
+    return 0;
+}
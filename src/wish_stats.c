@@ -0,0 +1,220 @@
+/*
+ * wish_stats.c – Contadores e histogramas del propio shell
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "wish_stats.h"
+
+/* --------------------- Histogramas --------------------- */
+
+/* Valores < SUB van cada uno a su cubeta; a partir de ahí cada potencia
+   de dos se parte en SUB cubetas iguales */
+#define SUB_BITS  3
+#define SUB       (1 << SUB_BITS)
+#define NBUCKETS  ((64 - SUB_BITS + 1) * SUB)
+
+typedef struct {
+    uint64_t b[NBUCKETS];
+    uint64_t count, sum, max;
+} Hist;
+
+static const struct {
+    const char *name;       /* métrica de Prometheus */
+    const char *label;      /* tabla de "stats" */
+    const char *help;
+} hinfo[ST_NHIST] = {
+    { "wish_parse_seconds", "análisis", "Tiempo de análisis de una línea" },
+    { "wish_fork_seconds",  "fork",     "Duración de fork() en el padre" },
+    { "wish_wait_seconds",  "espera",   "Tiempo bloqueado esperando a los hijos" },
+    { "wish_line_seconds",  "línea",    "Tiempo de pared por línea" },
+};
+
+static const struct {
+    const char *name;
+    const char *label;
+    const char *help;
+} cinfo[SC_NCOUNT] = {
+    { "wish_forks_total",        "hijos",          "Hijos lanzados" },
+    { "wish_builtins_total",     "built-ins",      "Built-ins ejecutados" },
+    { "wish_exec_failures_total", "exec fallidos", "execve que retornó" },
+    { "wish_path_misses_total",  "fuera del PATH", "Comandos que no están en el PATH" },
+};
+
+static Hist      hists[ST_NHIST];
+static uint64_t  local_counts[SC_NCOUNT];
+static uint64_t *counts = local_counts;     /* página compartida si se pudo */
+
+static int bucket_of(uint64_t v) {
+    if (v < SUB) return (int)v;
+    int e = 63 - __builtin_clzll(v);
+    return (e - SUB_BITS + 1) * SUB + (int)((v >> (e - SUB_BITS)) & (SUB - 1));
+}
+
+/* Primer valor de la cubeta i y su ancho */
+static uint64_t bucket_low(int i, uint64_t *width) {
+    if (i < SUB) {
+        *width = 1;
+        return (uint64_t)i;
+    }
+    int e = i / SUB + SUB_BITS - 1;
+    *width = 1ull << (e - SUB_BITS);
+    return (uint64_t)(SUB + i % SUB) << (e - SUB_BITS);
+}
+
+/* Lecturas desde el hilo exportador: un solo escritor (el hilo principal)
+   que publica con stores atómicos relajados, sin lock en la ruta caliente */
+static uint64_t load(const uint64_t *p) {
+    return __atomic_load_n(p, __ATOMIC_RELAXED);
+}
+
+static void bump(uint64_t *p, uint64_t v) {
+    __atomic_store_n(p, *p + v, __ATOMIC_RELAXED);
+}
+
+void stats_record(StatHist h, uint64_t ns) {
+    Hist *x = &hists[h];
+    bump(&x->b[bucket_of(ns)], 1);
+    bump(&x->count, 1);
+    bump(&x->sum, ns);
+    if (ns > x->max) __atomic_store_n(&x->max, ns, __ATOMIC_RELAXED);
+}
+
+void stats_count(StatCounter c) {
+    __atomic_fetch_add(&counts[c], 1, __ATOMIC_RELAXED);
+}
+
+uint64_t stats_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Valor del percentil q (0..1): el mayor de su cubeta, sin pasar del máximo */
+static uint64_t percentile(const Hist *x, double q) {
+    uint64_t n = load(&x->count);
+    if (n == 0) return 0;
+    uint64_t want = (uint64_t)(q * (double)n + 0.5), acc = 0;
+    if (want == 0) want = 1;
+    uint64_t max = load(&x->max);
+    for (int i = 0; i < NBUCKETS; i++) {
+        acc += load(&x->b[i]);
+        if (acc >= want) {
+            uint64_t w, v = bucket_low(i, &w) + w - 1;
+            return v < max ? v : max;
+        }
+    }
+    return max;
+}
+
+/* --------------------- Built-in stats --------------------- */
+
+/* Ancho de campo en bytes para que s ocupe width columnas (UTF-8) */
+static int cols(const char *s, int width) {
+    for (; *s; s++) {
+        if ((*s & 0xC0) == 0x80) width++;
+    }
+    return width;
+}
+
+void stats_print(int fd) {
+    dprintf(fd, "%-10s %10s %*s %*s %*s %*s\n", "", "n", cols("p50 µs", 10), "p50 µs",
+            cols("p90 µs", 10), "p90 µs", cols("p99 µs", 10), "p99 µs",
+            cols("máx µs", 10), "máx µs");
+    for (int h = 0; h < ST_NHIST; h++) {
+        const Hist *x = &hists[h];
+        dprintf(fd, "%-*s %10llu %10.1f %10.1f %10.1f %10.1f\n", cols(hinfo[h].label, 10),
+                hinfo[h].label, (unsigned long long)load(&x->count), percentile(x, 0.50) / 1e3,
+                percentile(x, 0.90) / 1e3, percentile(x, 0.99) / 1e3, load(&x->max) / 1e3);
+    }
+    for (int c = 0; c < SC_NCOUNT; c++) {
+        dprintf(fd, "%-*s %llu\n", cols(cinfo[c].label, 15), cinfo[c].label,
+                (unsigned long long)__atomic_load_n(&counts[c], __ATOMIC_RELAXED));
+    }
+}
+
+/* --------------------- Exportación a Prometheus --------------------- */
+
+/* Límites "le" del histograma exportado: 2^10 ns (~1 µs) a 2^36 ns (~69 s)
+   de cuatro en cuatro. Coinciden con bordes de cubeta, así que la cuenta
+   acumulada es exacta. */
+#define LE_FIRST 10
+#define LE_LAST  36
+
+static const char     *metrics_file;
+static pthread_mutex_t export_mu = PTHREAD_MUTEX_INITIALIZER;
+static int             export_done;
+
+static void write_hist(int fd, StatHist h) {
+    const Hist *x = &hists[h];
+    const char *name = hinfo[h].name;
+    dprintf(fd, "# HELP %s %s.\n# TYPE %s histogram\n", name, hinfo[h].help, name);
+    uint64_t acc = 0;
+    int i = 0;
+    for (int k = LE_FIRST; k <= LE_LAST; k += 2) {
+        for (int end = bucket_of(1ull << k); i < end; i++) acc += load(&x->b[i]);
+        dprintf(fd, "%s_bucket{le=\"%g\"} %llu\n", name, (double)(1ull << k) / 1e9,
+                (unsigned long long)acc);
+    }
+    dprintf(fd, "%s_bucket{le=\"+Inf\"} %llu\n", name, (unsigned long long)load(&x->count));
+    dprintf(fd, "%s_sum %.9f\n", name, load(&x->sum) / 1e9);
+    dprintf(fd, "%s_count %llu\n", name, (unsigned long long)load(&x->count));
+}
+
+/* Temporal junto al destino y rename encima */
+static void export_now(void) {
+    char tmp[4096];
+    if (snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", metrics_file, (long)getpid()) >=
+        (int)sizeof(tmp)) return;
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return;
+    for (int h = 0; h < ST_NHIST; h++) write_hist(fd, (StatHist)h);
+    for (int c = 0; c < SC_NCOUNT; c++) {
+        dprintf(fd, "# HELP %s %s.\n# TYPE %s counter\n%s %llu\n", cinfo[c].name,
+                cinfo[c].help, cinfo[c].name, cinfo[c].name,
+                (unsigned long long)__atomic_load_n(&counts[c], __ATOMIC_RELAXED));
+    }
+    if (close(fd) != 0 || rename(tmp, metrics_file) != 0) unlink(tmp);
+}
+
+static void *exporter(void *arg) {
+    (void)arg;
+    for (;;) {
+        struct timespec ts = { STATS_EXPORT_SEC, 0 };
+        while (nanosleep(&ts, &ts) != 0) {}
+        pthread_mutex_lock(&export_mu);
+        int done = export_done;
+        if (!done) export_now();
+        pthread_mutex_unlock(&export_mu);
+        if (done) return NULL;
+    }
+}
+
+/* Exportación final; el hilo ya no vuelve a escribir */
+static void export_final(void) {
+    pthread_mutex_lock(&export_mu);
+    if (!export_done) export_now();
+    export_done = 1;
+    pthread_mutex_unlock(&export_mu);
+}
+
+void stats_init(void) {
+    uint64_t *shared = mmap(NULL, sizeof(local_counts), PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared != MAP_FAILED) counts = shared;
+
+    const char *f = getenv("WISH_METRICS_FILE");
+    if (!f || !*f) return;
+    metrics_file = f;
+    pthread_t t;
+    if (pthread_create(&t, NULL, exporter, NULL) != 0) return;
+    pthread_detach(t);
+    atexit(export_final);
+}
@@ -0,0 +1,49 @@
+/*
+ * wish_stats.h – Contadores e histogramas del propio shell
+ *
+ * Siempre activos y baratos: medir es un clock_gettime (vDSO) y sumar en
+ * un histograma de estilo HDR con 8 sub-cubetas por potencia de dos (error
+ * relativo < 12,5 % en cualquier escala, de nanosegundos a horas) sin
+ * reservar memoria al registrar.
+ *
+ * Histogramas: análisis de la línea, fork (lo que tarda la llamada en el
+ * padre), espera en el planificador y tiempo de pared por línea.
+ * Contadores: hijos lanzados, built-ins, exec fallidos y comandos que no
+ * están en el PATH. Los dos últimos ocurren en el hijo, así que los
+ * contadores viven en una página compartida (MAP_SHARED) y se suman con
+ * operaciones atómicas.
+ *
+ * El built-in "stats" los muestra. Con WISH_METRICS_FILE=/ruta/wish.prom
+ * un hilo los escribe cada STATS_EXPORT_SEC segundos (y al salir) en
+ * formato de texto de Prometheus, en un temporal que se renombra encima:
+ * el textfile collector de node_exporter nunca lee un archivo a medias.
+ * Un fallo al exportar no afecta al shell.
+ */
+
+#ifndef WISH_STATS_H
+#define WISH_STATS_H
+
+#include <stdint.h>
+
+#define STATS_EXPORT_SEC 5
+
+typedef enum { ST_PARSE, ST_FORK, ST_WAIT, ST_LINE, ST_NHIST } StatHist;
+typedef enum { SC_FORKS, SC_BUILTINS, SC_EXEC_FAIL, SC_PATH_MISS, SC_NCOUNT } StatCounter;
+
+/* Prepara la página compartida y, con WISH_METRICS_FILE, el hilo
+   exportador (y la exportación final con atexit) */
+void     stats_init(void);
+
+/* Reloj monotónico en nanosegundos */
+uint64_t stats_now(void);
+
+/* Suma una muestra (en ns) al histograma h. Solo desde el hilo principal. */
+void     stats_record(StatHist h, uint64_t ns);
+
+/* Incrementa un contador; vale también en un hijo recién creado con fork */
+void     stats_count(StatCounter c);
+
+/* Tabla legible para el built-in "stats" */
+void     stats_print(int fd);
+
+#endif
@@ -1,14 +1,59 @@
 /*
  * wish_test_summary_v2.c — Verificador de tests del shell WISH
  *
- * Este programa ejecuta ../bin/wish_victory_v2 sobre los tests ubicados en
- * ../tests_unpacked/tests/, comparando:
+ * Este programa ejecuta uno o varios binarios del shell (por defecto
+ * ../bin/wish_victory_v2) sobre los tests ubicados en ../tests_unpacked/tests/,
+ * comparando:
  *   - salida estándar (.out)
  *   - salida de error (.err)
  *   - código de retorno (.rc)
  *
  * Imprime el resultado ✅ o ❌ para cada test con su descripción (.desc)
  * y al final muestra el porcentaje total de tests superados.
+ *
+ * Los tests se descubren con scandir (todo N.in del directorio, en orden
+ * numérico) y se reparten entre -j procesos. Cada test corre en su propio
+ * directorio temporal, con una copia de sus archivos N.* en tests/ y
+ * enlaces a los auxiliares compartidos (p1.sh, p2a-test/...): los que
+ * crean archivos en el directorio actual no se pisan entre sí, y los
+ * ganchos N.pre y N.post se ejecutan (con /bin/sh) dentro de ese mismo
+ * directorio, antes y después del test. Un N.run distinto del habitual
+ * "./wish tests/N.in" (opciones, varias invocaciones...) se ejecuta con
+ * /bin/sh -c en ese directorio, con ./wish apuntando al binario probado;
+ * su tiempo incluye el del sh. Los informes se imprimen siempre
+ * en el orden de los tests, sea cual sea el orden en que terminan. Las
+ * rutas absolutas que use un test (p. ej. /tmp/output22) no se aíslan.
+ *
+ * Uso: wish_test_summary_v2 [-x binario]... [-p corpus.wpk] [-j N] [-r N]
+ *                            [-b base.json] [-u] [-t pct] [-W] [-T seg] [test ...]
+ *   -x   binario a probar; repetido, compara varios (hasta MAX_BINS)
+ *   -p   lee los tests de un corpus empaquetado (ver wish_pack.c) mapeado
+ *        con mmap, en lugar de abrir los archivos uno a uno
+ *   -j   tests en paralelo (por defecto 1; 0 = uno por CPU). Los tiempos
+ *        medidos con -j > 1 incluyen la contención entre tests: para
+ *        crear o comparar la línea base conviene -j 1
+ *   -r   repeticiones por test para medir tiempos (por defecto 1)
+ *   -b   línea base de tiempos del primer binario (por defecto
+ *        <binario>.perf.json)
+ *   -u   guarda los tiempos medidos como nueva línea base
+ *   -t   umbral de regresión en % sobre la mediana base (por defecto 20)
+ *   -W   solo avisa de las regresiones, sin fallar
+ *   -T   segundos máximos por ejecución (por defecto 30; 0 = sin límite);
+ *        un binario que se cuelga termina con SIGALRM y cuenta como rc -1
+ *   test número o nombre de los tests a ejecutar (por defecto, todos)
+ *
+ * De cada test se reporta la mediana y la MAD (desviación absoluta mediana)
+ * del tiempo exec→exit. Si existe línea base, un test cuya mediana la supere
+ * en más del umbral (y por encima del ruido medido) se marca como regresión
+ * y el programa termina con código 1.
+ *
+ * Con varios binarios cada test se ejecuta en todos (alternándolos en cada
+ * repetición para repartir el ruido) y además de contra lo esperado se
+ * compara la salida estándar, la de error y el código de cada binario con
+ * los del primero. Las discrepancias se listan por test, la tabla de
+ * tiempos muestra los binarios lado a lado y el programa termina con
+ * código 1 si alguno se comporta distinto: un binario más rápido solo se
+ * promueve si es idéntico en todo.
  */
 
 #define _GNU_SOURCE
@@ -18,17 +63,153 @@
 #include <unistd.h>
 #include <sys/wait.h>
 #include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <dirent.h>
+#include <ctype.h>
+#include "wish_corpus.h"
 
 #define MAX_PATH 256
-#define TEST_COUNT 22
-#define BIN_PATH "../bin/wish_victory_v2"
+#define DEFAULT_BIN "../bin/wish_victory_v2"
+#define MAX_BINS 8
 #define TEST_DIR "../tests_unpacked/tests"
 #define ERRMSG "An error has occurred\n"
+#define MAX_REPS 100
+#define NOISE_FLOOR_MS 0.5   /* diferencias menores se consideran ruido */
+#define MAX_PENDING 256      /* tests lanzados cuyo informe aún no se imprimió */
 
 static void print_separator(void) {
     printf("====================================\n");
 }
 
+/* ---------------- Tiempos por test ---------------- */
+
+typedef struct {
+    char   name[32];
+    char   desc[256];
+    double median[MAX_BINS];    /* ms, uno por binario */
+    double mad[MAX_BINS];       /* ms */
+} TestTiming;
+
+/* Lo que un test devuelve al proceso principal (en memoria compartida) */
+typedef struct {
+    char       label[32];
+    int        ok;                  /* lo supera el primer binario */
+    int        bin_ok[MAX_BINS];
+    int        differs;             /* los binarios se comportan distinto */
+    int        timed;
+    TestTiming timing;
+} TestResult;
+
+static int reps = 1;
+static int jobs = 1;
+static unsigned timeout_s = 30;
+static TestTiming *timings;
+static int ntimings;
+
+static const char *bins[MAX_BINS];
+static int nbins;
+static int disagreements;       /* tests en que los binarios difieren */
+static int bin_passed[MAX_BINS];
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double median_of(double *v, int n) {
+    qsort(v, (size_t)n, sizeof(*v), cmp_double);
+    return (n % 2) ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2.0;
+}
+
+static void record_timing(TestTiming *t, const char *name, const char *desc,
+                          double samples[][MAX_REPS], int n) {
+    snprintf(t->name, sizeof(t->name), "%s", name);
+    snprintf(t->desc, sizeof(t->desc), "%s", desc);
+
+    for (int b = 0; b < nbins; b++) {
+        double v[MAX_REPS], dev[MAX_REPS];
+        memcpy(v, samples[b], (size_t)n * sizeof(*v));
+        double med = median_of(v, n);
+        for (int i = 0; i < n; i++) dev[i] = v[i] > med ? v[i] - med : med - v[i];
+        t->median[b] = med;
+        t->mad[b] = median_of(dev, n);
+    }
+}
+
+/* Línea N.run del test en curso cuando no es "./wish tests/N.in"; NULL si
+   lo es. Cada test corre en su propio proceso: basta una variable. */
+static char *run_cmd;
+
+static void set_run(const char *text, size_t len, const char *name) {
+    while (len > 0 && (text[len - 1] == '\n' || text[len - 1] == '\r' || text[len - 1] == ' ')) len--;
+    char std[64];
+    int n = snprintf(std, sizeof(std), "./wish tests/%s.in", name);
+    if ((size_t)n == len && memcmp(text, std, len) == 0) return;
+    run_cmd = strndup(text, len);
+}
+
+/* Deja vacío un archivo temporal reutilizado entre repeticiones */
+static void reset_capture(int fd) {
+    if (ftruncate(fd, 0) != 0) perror("ftruncate");
+    lseek(fd, 0, SEEK_SET);
+}
+
+/* Lanza el shell con arg como archivo batch (en cwd si no es NULL) y mide
+   el tiempo hasta que termina. Retorna el código de salida o -1. */
+static int spawn_timed(const char *bin, const char *arg, const char *cwd,
+                       int fd_out, int fd_err, double *ms) {
+    double t0 = now_ms();
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return -1;
+    }
+    if (pid == 0) {
+        /* Redirigir stdout y stderr a los archivos temporales; stdin vacío
+           para que un binario que lo lea no se quede esperando */
+        int fd_null = open("/dev/null", O_RDONLY);
+        if (fd_null >= 0) {
+            dup2(fd_null, STDIN_FILENO);
+            close(fd_null);
+        }
+        dup2(fd_out, STDOUT_FILENO);
+        dup2(fd_err, STDERR_FILENO);
+        close(fd_out);
+        close(fd_err);
+        if (cwd && chdir(cwd) != 0) exit(127);
+        /* La alarma sobrevive a exec: corta un shell que no termina */
+        if (timeout_s) alarm(timeout_s);
+
+        if (run_cmd) {
+            unlink("wish");
+            if (symlink(bin, "wish") != 0) {
+                perror("symlink");
+                exit(127);
+            }
+            execl("/bin/sh", "sh", "-c", run_cmd, (char *)NULL);
+        } else {
+            execlp(bin, bin, arg, (char *)NULL);
+        }
+        perror("exec");
+        exit(127);
+    }
+
+    int status;
+    waitpid(pid, &status, 0);
+    *ms = now_ms() - t0;
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
 /* Función auxiliar: compara dos archivos línea a línea */
 static int compare_files(const char *f1, const char *f2) {
     FILE *a = fopen(f1, "r");
@@ -56,19 +237,121 @@ static int compare_files(const char *f1, const char *f2) {
     return 1; // Archivos idénticos
 }
 
-/* Ejecuta un test individual */
-static int run_test(int num) {
-    char base[MAX_PATH];
-    snprintf(base, sizeof(base), "%s/%d", TEST_DIR, num);
+/* Lo que debe producir un test: archivos (modo directorio) o blobs del
+   corpus */
+typedef struct {
+    const char *out_file, *err_file;
+    const void *out_blob, *err_blob;
+    size_t      out_len, err_len;
+    int         rc;
+} Expect;
+
+static int compare_file_blob(const char *path, const void *blob, size_t len);
+
+static int expect_match(const Expect *e, const char *out_tmp, const char *err_tmp, int rc) {
+    int ok_out = e->out_file ? compare_files(out_tmp, e->out_file)
+                             : compare_file_blob(out_tmp, e->out_blob, e->out_len);
+    int ok_err = e->err_file ? compare_files(err_tmp, e->err_file)
+                             : compare_file_blob(err_tmp, e->err_blob, e->err_len);
+    return ok_out && ok_err && rc == e->rc;
+}
+
+static const char *bin_name(int b) {
+    const char *slash = strrchr(bins[b], '/');
+    return slash ? slash + 1 : bins[b];
+}
+
+/* Captura de un binario en el test en curso */
+typedef struct {
+    char out[32], err[32];
+    int  fd_out, fd_err;
+    int  rc;
+    int  ok;
+} BinRun;
+
+/* Ejecuta el test con cada binario, lo compara con lo esperado y, con
+   varios binarios, con el primero. El resultado queda en res. */
+static void run_bins(const char *label, const char *desc, const char *in, const Expect *e,
+                     TestResult *res) {
+    printf("🔹 TEST %s: %s\n", label, desc);
+
+    BinRun run[MAX_BINS];
+    for (int b = 0; b < nbins; b++) {
+        snprintf(run[b].out, sizeof(run[b].out), "/tmp/wish_out_XXXXXX");
+        snprintf(run[b].err, sizeof(run[b].err), "/tmp/wish_err_XXXXXX");
+        run[b].fd_out = mkstemp(run[b].out);
+        run[b].fd_err = mkstemp(run[b].err);
+        run[b].ok = 1;
+        if (run[b].fd_out < 0 || run[b].fd_err < 0) {
+            perror("mkstemp");
+            return;
+        }
+    }
+
+    /* Cada repetición debe ser correcta; los tiempos se agregan al final.
+       Los binarios se alternan dentro de cada repetición. */
+    static double samples[MAX_BINS][MAX_REPS];
+    for (int r = 0; r < reps; r++) {
+        for (int b = 0; b < nbins; b++) {
+            reset_capture(run[b].fd_out);
+            reset_capture(run[b].fd_err);
+            run[b].rc = spawn_timed(bins[b], in, NULL, run[b].fd_out, run[b].fd_err, &samples[b][r]);
+            run[b].ok &= expect_match(e, run[b].out, run[b].err, run[b].rc);
+        }
+    }
+    record_timing(&res->timing, label, desc, samples, reps);
+    res->timed = 1;
+
+    /* Discrepancias con el primer binario (última repetición) */
+    int differs = 0;
+    for (int b = 1; b < nbins; b++) {
+        int d_out = !compare_files(run[0].out, run[b].out);
+        int d_err = !compare_files(run[0].err, run[b].err);
+        int d_rc = run[0].rc != run[b].rc;
+        if (!d_out && !d_err && !d_rc) continue;
+        differs = 1;
+        printf("   ≠ %s vs %s:%s%s", bin_name(b), bin_name(0),
+               d_out ? " stdout" : "", d_err ? " stderr" : "");
+        if (d_rc) printf(" rc (%d vs %d)", run[b].rc, run[0].rc);
+        printf("\n");
+    }
+    res->differs = differs;
+
+    for (int b = 0; b < nbins; b++) {
+        res->bin_ok[b] = run[b].ok;
+        close(run[b].fd_out);
+        close(run[b].fd_err);
+        unlink(run[b].out);
+        unlink(run[b].err);
+    }
+
+    if (nbins == 1) {
+        if (run[0].ok) printf("✅ TEST %s superado.\n\n", label);
+        else printf("❌ TEST %s falló.\n\n", label);
+    } else {
+        for (int b = 0; b < nbins; b++) {
+            printf("   %s %s\n", run[b].ok ? "✅" : "❌", bin_name(b));
+        }
+        printf("\n");
+    }
+    res->ok = run[0].ok;
+}
+
+/* Ejecuta un test individual desde su directorio privado (ver
+   enter_private_dir), donde sus archivos están en tests/ */
+static void run_test(int num, TestResult *res) {
+    char base[32];
+    snprintf(base, sizeof(base), "tests/%d", num);
 
     char in_file[MAX_PATH], out_expected[MAX_PATH], err_expected[MAX_PATH];
-    char desc_file[MAX_PATH], rc_file[MAX_PATH];
+    char desc_file[MAX_PATH], rc_file[MAX_PATH], run_file[MAX_PATH];
 
     snprintf(in_file, sizeof(in_file), "%s.in", base);
     snprintf(out_expected, sizeof(out_expected), "%s.out", base);
     snprintf(err_expected, sizeof(err_expected), "%s.err", base);
     snprintf(desc_file, sizeof(desc_file), "%s.desc", base);
     snprintf(rc_file, sizeof(rc_file), "%s.rc", base);
+    snprintf(run_file, sizeof(run_file), "%s.run", base);
 
     char desc[256] = "(sin descripción)";
     FILE *df = fopen(desc_file, "r");
@@ -78,79 +361,677 @@ static int run_test(int num) {
         fclose(df);
     }
 
-    printf("🔹 TEST %02d: %s\n", num, desc);
+    /* Leer código esperado */
+    Expect e = { out_expected, err_expected, NULL, NULL, 0, 0, 0 };
+    FILE *frc = fopen(rc_file, "r");
+    if (frc) {
+        fscanf(frc, "%d", &e.rc);
+        fclose(frc);
+    }
 
-    /* Archivos temporales para capturar la salida */
-    char out_tmp[] = "/tmp/wish_out_XXXXXX";
-    char err_tmp[] = "/tmp/wish_err_XXXXXX";
-    int fd_out = mkstemp(out_tmp);
-    int fd_err = mkstemp(err_tmp);
+    FILE *fr = fopen(run_file, "r");
+    if (fr) {
+        char run[1024];
+        size_t n = fread(run, 1, sizeof(run), fr);
+        fclose(fr);
+        set_run(run, n, base + strlen("tests/"));
+    }
 
-    if (fd_out < 0 || fd_err < 0) {
-        perror("mkstemp");
-        return 0;
+    char label[16];
+    snprintf(label, sizeof(label), "%02d", num);
+    run_bins(label, desc, in_file, &e, res);
+}
+
+/* ---------------- Modo corpus (.wpk) ---------------- */
+
+static char corpus_workdir[] = "/tmp/wish_corpus_XXXXXX";
+
+/* Compara el contenido de un archivo con un blob del corpus */
+static int compare_file_blob(const char *path, const void *blob, size_t len) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    int ok = fstat(fd, &st) == 0 && (size_t)st.st_size == len;
+    if (ok && len > 0) {
+        void *m = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        ok = (m != MAP_FAILED) && memcmp(m, blob, len) == 0;
+        if (m != MAP_FAILED) munmap(m, len);
+    }
+    close(fd);
+    return ok;
+}
+
+/* Los archivos auxiliares (p1.sh, p2a-test/...) se materializan una sola vez
+   en <workdir>/tests para que "path tests" funcione igual que en el repo */
+static int corpus_setup(const Corpus *c) {
+    char path[PATH_MAX];
+    if (!mkdtemp(corpus_workdir)) {
+        perror("mkdtemp");
+        return -1;
+    }
+    snprintf(path, sizeof(path), "%s/tests", corpus_workdir);
+    mkdir(path, 0755);
+    for (uint32_t i = 0; i < c->hdr->nfiles; i++) {
+        const CorpusFile *f = &c->files[i];
+        snprintf(path, sizeof(path), "%s/tests/%s", corpus_workdir, corpus_str(c, f->path_off));
+        for (char *p = path + strlen(corpus_workdir) + 1; *p; p++) {
+            if (*p == '/') { *p = '\0'; mkdir(path, 0755); *p = '/'; }
+        }
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, f->mode & CORPUS_MODE_MASK);
+        if (fd < 0) { perror(path); return -1; }
+        if (write(fd, corpus_blob(c, &f->data), f->data.len) != (ssize_t)f->data.len) {
+            perror(path);
+        }
+        close(fd);
+    }
+    return 0;
+}
+
+static int rm_entry(const char *path, const struct stat *sb, int flag, struct FTW *ftw) {
+    (void)sb; (void)flag; (void)ftw;
+    return remove(path);
+}
+
+static void rm_tree(const char *dir) {
+    nftw(dir, rm_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+static void run_corpus_test(const Corpus *c, const CorpusTest *t, TestResult *res) {
+    const char *name = corpus_str(c, t->name_off);
+    const CorpusBlob *d = &t->part[PART_DESC];
+    const char *ds = corpus_blob(c, d);
+    int dl = (int)d->len;
+    while (dl > 0 && (ds[dl - 1] == '\n' || ds[dl - 1] == '\r')) dl--;
+    char desc[256];
+    if (d->present) snprintf(desc, sizeof(desc), "%.*s", dl, ds);
+    else snprintf(desc, sizeof(desc), "(sin descripción)");
+
+    /* La entrada va en un memfd: nada se escribe en disco */
+    int fd_in = memfd_create("wish_in", 0);
+    if (fd_in < 0) {
+        perror("memfd");
+        return;
+    }
+    const CorpusBlob *in = &t->part[PART_IN];
+    if (in->len && write(fd_in, corpus_blob(c, in), in->len) != (ssize_t)in->len) {
+        perror("memfd");
+    }
+    char in_path[64];
+    snprintf(in_path, sizeof(in_path), "/dev/fd/%d", fd_in);
+
+    /* Un .run propio lee tests/<nombre>.in: se escribe en el directorio
+       privado del test */
+    const CorpusBlob *rb = &t->part[PART_RUN];
+    if (rb->present) set_run(corpus_blob(c, rb), rb->len, name);
+    if (run_cmd) {
+        snprintf(in_path, sizeof(in_path), "tests/%s.in", name);
+        int fd = open(in_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || (in->len && write(fd, corpus_blob(c, in), in->len) != (ssize_t)in->len)) {
+            perror(in_path);
+        }
+        if (fd >= 0) close(fd);
+    }
+
+    Expect e = { NULL, NULL, corpus_blob(c, &t->part[PART_OUT]), corpus_blob(c, &t->part[PART_ERR]),
+                 t->part[PART_OUT].len, t->part[PART_ERR].len, 0 };
+    const CorpusBlob *rcb = &t->part[PART_RC];
+    if (rcb->len) {
+        char tmp[32];
+        size_t n = rcb->len < sizeof(tmp) - 1 ? rcb->len : sizeof(tmp) - 1;
+        memcpy(tmp, corpus_blob(c, rcb), n);
+        tmp[n] = '\0';
+        e.rc = atoi(tmp);
+    }
+
+    run_bins(name, desc, in_path, &e, res);
+    close(fd_in);
+}
+
+/* Busca un test por número o por nombre (O(1) en ambos casos) */
+static const CorpusTest *corpus_lookup(const Corpus *c, const char *sel) {
+    char *end;
+    unsigned long n = strtoul(sel, &end, 10);
+    if (*sel && *end == '\0') return corpus_find_num(c, (uint32_t)n);
+    return corpus_find_name(c, sel);
+}
+
+/* ---------------- Aislamiento y ejecución en paralelo ---------------- */
+
+/* Auxiliares compartidos por todos los tests (todo lo que no es N.<parte>):
+   se enlazan en el tests/ de cada directorio privado */
+static char shared_root[PATH_MAX];
+static char **shared;
+static int nshared;
+
+static int not_dots(const struct dirent *d) {
+    return strcmp(d->d_name, ".") != 0 && strcmp(d->d_name, "..") != 0;
+}
+
+/* Parte de un test a la que corresponde name ("N.out" -> PART_OUT), o -1 */
+static int part_of(const char *name) {
+    const char *dot = strrchr(name, '.');
+    if (!dot || dot == name) return -1;
+    for (int p = 0; p < CORPUS_NPARTS; p++) {
+        if (strcmp(dot + 1, corpus_part_ext[p]) == 0) return p;
+    }
+    return -1;
+}
+
+static int cmp_int(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+/* Recorre root con scandir: guarda los auxiliares y, si nums no es NULL,
+   los números de los tests (cada N.in) en orden numérico. Retorna cuántos
+   tests hay o -1. */
+static int discover_tests(const char *root, int **nums) {
+    if (!realpath(root, shared_root)) {
+        perror(root);
+        return -1;
+    }
+    struct dirent **list;
+    int n = scandir(shared_root, &list, not_dots, alphasort);
+    if (n < 0) {
+        perror(shared_root);
+        return -1;
+    }
+    int ntests = 0;
+    shared = malloc((size_t)n * sizeof(*shared));
+    if (nums) *nums = malloc((size_t)n * sizeof(**nums));
+    for (int i = 0; i < n; i++) {
+        const char *name = list[i]->d_name;
+        int p = part_of(name);
+        if (p < 0) {
+            shared[nshared++] = strdup(name);
+        } else if (nums && p == PART_IN && isdigit((unsigned char)name[0])) {
+            char *end;
+            long num = strtol(name, &end, 10);
+            if (*end == '.') (*nums)[ntests++] = (int)num;
+        }
+        free(list[i]);
+    }
+    free(list);
+    if (nums) qsort(*nums, (size_t)ntests, sizeof(**nums), cmp_int);
+    return ntests;
+}
+
+/* Crea un directorio temporal con tests/ (enlaces a los auxiliares) y
+   entra en él; dir recibe su ruta para borrarlo al terminar */
+static int enter_private_dir(char *dir, size_t len) {
+    snprintf(dir, len, "/tmp/wish_test_XXXXXX");
+    if (!mkdtemp(dir) || chdir(dir) != 0 || mkdir("tests", 0755) != 0) {
+        perror(dir);
+        return -1;
+    }
+    char src[PATH_MAX + 256], dst[PATH_MAX];
+    for (int i = 0; i < nshared; i++) {
+        snprintf(src, sizeof(src), "%s/%s", shared_root, shared[i]);
+        snprintf(dst, sizeof(dst), "tests/%s", shared[i]);
+        if (symlink(src, dst) != 0) perror(dst);
+    }
+    return 0;
+}
+
+static void leave_private_dir(const char *dir) {
+    if (chdir("/") != 0) perror("chdir");
+    rm_tree(dir);
+}
+
+/* Copia src en dst; 0 si src no existe */
+static int copy_file(const char *src, const char *dst) {
+    int in = open(src, O_RDONLY);
+    if (in < 0) return 0;
+    struct stat st;
+    int out = fstat(in, &st) == 0 ? open(dst, O_WRONLY | O_CREAT | O_TRUNC, st.st_mode & 07777) : -1;
+    if (out < 0) {
+        perror(dst);
+        close(in);
+        return -1;
+    }
+    char buf[8192];
+    ssize_t n;
+    while ((n = read(in, buf, sizeof(buf))) > 0) {
+        if (write(out, buf, (size_t)n) != n) {
+            perror(dst);
+            break;
+        }
     }
+    close(in);
+    close(out);
+    return 1;
+}
 
+/* Gancho .pre/.post: sh -c script en el directorio del test. Su salida
+   forma parte del informe del test. */
+static void run_hook(const char *script) {
+    fflush(stdout);
     pid_t pid = fork();
     if (pid == 0) {
-        /* Redirigir stdout y stderr a los archivos temporales */
-        dup2(fd_out, STDOUT_FILENO);
-        dup2(fd_err, STDERR_FILENO);
-        close(fd_out);
-        close(fd_err);
+        int fd_null = open("/dev/null", O_RDONLY);
+        if (fd_null >= 0) {
+            dup2(fd_null, STDIN_FILENO);
+            close(fd_null);
+        }
+        execl("/bin/sh", "sh", "-c", script, (char *)NULL);
+        _exit(127);
+    }
+    if (pid > 0) waitpid(pid, NULL, 0);
+}
 
-        execlp(BIN_PATH, BIN_PATH, in_file, NULL);
-        perror("exec");
-        exit(127);
+/* Modo directorio: copia los archivos del test (el .pre puede regenerar
+   lo esperado sin tocar el original), ejecuta los ganchos y el test */
+static int *test_nums;
+
+static void dir_task(int i, TestResult *res) {
+    int num = test_nums[i];
+    snprintf(res->label, sizeof(res->label), "%02d", num);
+    char dir[64];
+    if (enter_private_dir(dir, sizeof(dir)) != 0) return;
+
+    char src[PATH_MAX + 64], dst[64];
+    for (int p = 0; p < CORPUS_NPARTS; p++) {
+        snprintf(src, sizeof(src), "%s/%d.%s", shared_root, num, corpus_part_ext[p]);
+        snprintf(dst, sizeof(dst), "tests/%d.%s", num, corpus_part_ext[p]);
+        copy_file(src, dst);
+    }
+    snprintf(dst, sizeof(dst), "tests/%d.in", num);
+    if (access(dst, F_OK) != 0) {
+        printf("❌ TEST %02d no existe.\n\n", num);
+    } else {
+        char hook[64];
+        snprintf(hook, sizeof(hook), ". tests/%d.pre", num);
+        snprintf(dst, sizeof(dst), "tests/%d.pre", num);
+        if (access(dst, F_OK) == 0) run_hook(hook);
+        run_test(num, res);
+        snprintf(hook, sizeof(hook), ". tests/%d.post", num);
+        snprintf(dst, sizeof(dst), "tests/%d.post", num);
+        if (access(dst, F_OK) == 0) run_hook(hook);
     }
+    leave_private_dir(dir);
+}
 
-    close(fd_out);
-    close(fd_err);
+/* Modo corpus: los auxiliares ya están materializados en corpus_workdir;
+   los ganchos se ejecutan desde el mapeo */
+static const Corpus *corpus;
+static const CorpusTest **corpus_sel;   /* NULL: el test pedido no existe */
+static char **corpus_args;
 
-    int status;
-    waitpid(pid, &status, 0);
-    int rc = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+static void corpus_hook(const CorpusBlob *b) {
+    if (!b->present) return;
+    char *script = strndup(corpus_blob(corpus, b), b->len);
+    if (!script) return;
+    run_hook(script);
+    free(script);
+}
 
-    /* Leer código esperado */
-    int rc_expected = 0;
-    FILE *frc = fopen(rc_file, "r");
-    if (frc) {
-        fscanf(frc, "%d", &rc_expected);
-        fclose(frc);
+static void corpus_task(int i, TestResult *res) {
+    const CorpusTest *t = corpus_sel[i];
+    snprintf(res->label, sizeof(res->label), "%s", t ? corpus_str(corpus, t->name_off) : corpus_args[i]);
+    if (!t) {
+        printf("❌ TEST %s no existe en el corpus.\n\n", corpus_args[i]);
+        return;
     }
+    char dir[64];
+    if (enter_private_dir(dir, sizeof(dir)) != 0) return;
+    corpus_hook(&t->part[PART_PRE]);
+    run_corpus_test(corpus, t, res);
+    corpus_hook(&t->part[PART_POST]);
+    leave_private_dir(dir);
+}
 
-    int ok_out = compare_files(out_tmp, out_expected);
-    int ok_err = compare_files(err_tmp, err_expected);
-    int ok_rc  = (rc == rc_expected);
+/* Suma un resultado a los totales, en el orden de los tests */
+static void merge_result(const TestResult *r, int *passed) {
+    *passed += r->ok;
+    disagreements += r->differs;
+    for (int b = 0; b < nbins; b++) bin_passed[b] += r->bin_ok[b];
+    if (!r->timed) return;
+    TestTiming *nt = realloc(timings, (size_t)(ntimings + 1) * sizeof(*timings));
+    if (!nt) return;
+    timings = nt;
+    timings[ntimings++] = r->timing;
+}
 
-    unlink(out_tmp);
-    unlink(err_tmp);
+/* Vuelca el informe capturado de un test en stdout */
+static void print_capture(int fd) {
+    char buf[8192];
+    ssize_t n;
+    lseek(fd, 0, SEEK_SET);
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        if (write(STDOUT_FILENO, buf, (size_t)n) != n) break;
+    }
+}
 
-    if (ok_out && ok_err && ok_rc) {
-        printf("✅ TEST %02d superado.\n\n", num);
-        return 1;
-    } else {
-        printf("❌ TEST %02d falló.\n\n", num);
-        return 0;
+/* Ejecuta task(0..n-1) con hasta "jobs" procesos a la vez. Cada test corre
+   en un hijo que escribe su informe en un memfd y su resultado en una
+   región compartida; el padre los imprime y acumula en orden a medida que
+   se completa el prefijo. Retorna los tests superados por el primer
+   binario. */
+static int run_pool(int n, void (*task)(int, TestResult *)) {
+    if (n == 0) return 0;
+    TestResult *res = mmap(NULL, (size_t)n * sizeof(*res), PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    pid_t *pids = calloc((size_t)n, sizeof(*pids));
+    int *cap = malloc((size_t)n * sizeof(*cap));
+    if (res == MAP_FAILED || !pids || !cap) {
+        perror("run_pool");
+        exit(2);
     }
+
+    int passed = 0, launched = 0, printed = 0, running = 0;
+    fflush(stdout);
+    while (printed < n) {
+        while (running < jobs && launched < n && launched - printed < MAX_PENDING) {
+            int i = launched;
+            cap[i] = memfd_create("wish_report", MFD_CLOEXEC);
+            if (cap[i] < 0) {
+                perror("memfd");
+                exit(2);
+            }
+            pid_t pid = fork();
+            if (pid < 0) {
+                perror("fork");
+                exit(2);
+            }
+            if (pid == 0) {
+                dup2(cap[i], STDOUT_FILENO);
+                task(i, &res[i]);
+                fflush(stdout);
+                _exit(0);
+            }
+            pids[i] = pid;
+            launched++;
+            running++;
+        }
+
+        int status;
+        pid_t pid = wait(&status);
+        if (pid < 0) {
+            perror("wait");
+            exit(2);
+        }
+        for (int i = printed; i < launched; i++) {
+            if (pids[i] != pid) continue;
+            pids[i] = -1;
+            running--;
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                dprintf(cap[i], "❌ TEST %s: el proceso del test terminó de forma anormal\n\n",
+                        res[i].label[0] ? res[i].label : "?");
+            }
+            break;
+        }
+
+        while (printed < launched && pids[printed] == -1) {
+            print_capture(cap[printed]);
+            close(cap[printed]);
+            merge_result(&res[printed], &passed);
+            printed++;
+        }
+    }
+
+    munmap(res, (size_t)n * sizeof(*res));
+    free(pids);
+    free(cap);
+    return passed;
+}
+
+/* ---------------- Línea base de rendimiento (JSON) ---------------- */
+
+typedef struct {
+    char   name[32];
+    double median;
+    double mad;
+} BaselineEntry;
+
+/* Lee el JSON generado por save_baseline (una entrada por línea) */
+static int load_baseline(const char *path, BaselineEntry **out) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    BaselineEntry *v = NULL;
+    int n = 0;
+    char line[1024];
+    while (fgets(line, sizeof(line), f)) {
+        BaselineEntry e;
+        if (sscanf(line, " \"%31[^\"]\": {\"median_ms\": %lf, \"mad_ms\": %lf",
+                   e.name, &e.median, &e.mad) != 3) continue;
+        BaselineEntry *nv = realloc(v, (size_t)(n + 1) * sizeof(*v));
+        if (!nv) break;
+        v = nv;
+        v[n++] = e;
+    }
+    fclose(f);
+    *out = v;
+    return n;
+}
+
+static void json_string(FILE *f, const char *s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') fputc('\\', f);
+        if ((unsigned char)*s >= 0x20) fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+static int save_baseline(const char *path, const char *bin) {
+    char tmp[PATH_MAX];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *f = fopen(tmp, "w");
+    if (!f) {
+        perror(tmp);
+        return -1;
+    }
+    fprintf(f, "{\n  \"binary\": ");
+    json_string(f, bin);
+    fprintf(f, ",\n  \"reps\": %d,\n  \"tests\": {\n", reps);
+    for (int i = 0; i < ntimings; i++) {
+        fprintf(f, "    \"%s\": {\"median_ms\": %.3f, \"mad_ms\": %.3f, \"desc\": ",
+                timings[i].name, timings[i].median[0], timings[i].mad[0]);
+        json_string(f, timings[i].desc);
+        fprintf(f, "}%s\n", i + 1 < ntimings ? "," : "");
+    }
+    fprintf(f, "  }\n}\n");
+    if (fclose(f) != 0 || rename(tmp, path) != 0) {
+        perror(path);
+        return -1;
+    }
+    return 0;
+}
+
+/* Tabla de tiempos por test del primer binario contra su línea base;
+   retorna el número de regresiones */
+static int report_timings(const BaselineEntry *base, int nbase, double threshold) {
+    int regressions = 0;
+    print_separator();
+    printf("⏱️  Tiempos (%d repeticiones por test)\n", reps);
+    print_separator();
+    printf("%-6s %10s %8s %10s %8s  %s\n", "TEST", "mediana", "MAD", "base", "Δ%", "descripción");
+    for (int i = 0; i < ntimings; i++) {
+        const TestTiming *t = &timings[i];
+        double med = t->median[0], mad = t->mad[0];
+        const BaselineEntry *b = NULL;
+        for (int j = 0; j < nbase; j++) {
+            if (strcmp(base[j].name, t->name) == 0) { b = &base[j]; break; }
+        }
+        if (!b) {
+            printf("%-6s %8.2fms %6.2fms %10s %8s  %s\n", t->name, med, mad, "-", "-", t->desc);
+            continue;
+        }
+        double delta = b->median > 0 ? (med - b->median) / b->median * 100.0 : 0.0;
+        double noise = 3.0 * (b->mad > mad ? b->mad : mad);
+        if (noise < NOISE_FLOOR_MS) noise = NOISE_FLOOR_MS;
+        int slow = delta > threshold && (med - b->median) > noise;
+        regressions += slow;
+        printf("%-6s %8.2fms %6.2fms %8.2fms %+7.1f%%  %s%s\n", t->name, med, mad,
+               b->median, delta, slow ? "⚠️  REGRESIÓN: " : "", t->desc);
+    }
+    return regressions;
+}
+
+/* Medianas de todos los binarios lado a lado; los demás llevan su
+   diferencia con el primero, que también se marca si supera el ruido */
+static void report_side_by_side(void) {
+    print_separator();
+    printf("⏱️  Tiempos por binario (mediana, %d repeticiones por test)\n", reps);
+    print_separator();
+    printf("%-6s", "TEST");
+    for (int b = 0; b < nbins; b++) printf(" %18.18s", bin_name(b));
+    printf("\n");
+
+    double total[MAX_BINS] = { 0 };
+    for (int i = 0; i < ntimings; i++) {
+        const TestTiming *t = &timings[i];
+        printf("%-6s %16.2fms", t->name, t->median[0]);
+        total[0] += t->median[0];
+        for (int b = 1; b < nbins; b++) {
+            double delta = t->median[0] > 0
+                ? (t->median[b] - t->median[0]) / t->median[0] * 100.0 : 0.0;
+            double noise = 3.0 * (t->mad[0] > t->mad[b] ? t->mad[0] : t->mad[b]);
+            if (noise < NOISE_FLOOR_MS) noise = NOISE_FLOOR_MS;
+            int sig = (t->median[b] - t->median[0] > noise) || (t->median[0] - t->median[b] > noise);
+            printf(" %7.2fms %+6.0f%%%s", t->median[b], delta, sig ? "*" : " ");
+            total[b] += t->median[b];
+        }
+        printf("\n");
+    }
+    printf("%-6s %16.2fms", "total", total[0]);
+    for (int b = 1; b < nbins; b++) {
+        double delta = total[0] > 0 ? (total[b] - total[0]) / total[0] * 100.0 : 0.0;
+        printf(" %7.2fms %+6.0f%% ", total[b], delta);
+    }
+    printf("\n(* diferencia por encima del ruido medido)\n");
 }
 
 /* ---------------- MAIN ---------------- */
-int main(void) {
+int main(int argc, char *argv[]) {
+    const char *corpus_path = NULL;
+    const char *baseline_path = NULL;
+    double threshold = 20.0;
+    int update = 0, warn_only = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "x:p:j:r:b:ut:WT:")) != -1) {
+        switch (opt) {
+        case 'x':
+            if (nbins == MAX_BINS) {
+                fprintf(stderr, "como mucho %d binarios\n", MAX_BINS);
+                return 2;
+            }
+            bins[nbins++] = optarg;
+            break;
+        case 'p': corpus_path = optarg; break;
+        case 'j': jobs = atoi(optarg); break;
+        case 'r': reps = atoi(optarg); break;
+        case 'b': baseline_path = optarg; break;
+        case 'u': update = 1; break;
+        case 't': threshold = atof(optarg); break;
+        case 'W': warn_only = 1; break;
+        case 'T': timeout_s = (unsigned)atoi(optarg); break;
+        default:
+            fprintf(stderr, "uso: %s [-x binario]... [-p corpus.wpk] [-j N] [-r N] [-b base.json] [-u] "
+                    "[-t pct] [-W] [-T seg] [test ...]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (reps < 1) reps = 1;
+    if (reps > MAX_REPS) reps = MAX_REPS;
+    if (nbins == 0) bins[nbins++] = DEFAULT_BIN;
+    if (jobs <= 0) jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (jobs <= 0) jobs = 1;
+
+    /* La línea base es la del primer binario; se guarda con su ruta original */
+    const char *base_bin = bins[0];
+    char default_base[PATH_MAX];
+    if (!baseline_path) {
+        snprintf(default_base, sizeof(default_base), "%s.perf.json", bins[0]);
+        baseline_path = default_base;
+    }
+
+    /* Los tests corren en su directorio privado: las rutas deben ser absolutas */
+    static char bin_paths[MAX_BINS][PATH_MAX];
+    for (int b = 0; b < nbins; b++) {
+        if (!realpath(bins[b], bin_paths[b])) {
+            perror(bins[b]);
+            return 2;
+        }
+        bins[b] = bin_paths[b];
+    }
+
     print_separator();
-    printf("🧪 Verificador de tests — wish_victory_v2\n");
+    printf("🧪 Verificador de tests — ");
+    for (int b = 0; b < nbins; b++) printf("%s%s", b ? " vs " : "", bin_name(b));
+    printf("\n");
     print_separator();
     printf("\n");
 
     int passed = 0;
-    for (int i = 1; i <= TEST_COUNT; i++) {
-        passed += run_test(i);
+    int total = 0;
+
+    if (corpus_path) {
+        Corpus c;
+        if (corpus_open(&c, corpus_path) != 0) {
+            fprintf(stderr, "corpus inválido: %s\n", corpus_path);
+            return 2;
+        }
+        if (corpus_setup(&c) != 0) return 2;
+        char aux[PATH_MAX];
+        snprintf(aux, sizeof(aux), "%s/tests", corpus_workdir);
+        if (discover_tests(aux, NULL) < 0) return 2;
+
+        corpus = &c;
+        total = optind < argc ? argc - optind : (int)c.hdr->ntests;
+        corpus_sel = malloc((size_t)total * sizeof(*corpus_sel));
+        corpus_args = argv + optind;
+        for (int i = 0; i < total; i++) {
+            corpus_sel[i] = optind < argc ? corpus_lookup(&c, argv[optind + i]) : &c.tests[i];
+        }
+        passed = run_pool(total, corpus_task);
+        free(corpus_sel);
+        rm_tree(corpus_workdir);
+        corpus_close(&c);
+    } else {
+        total = discover_tests(TEST_DIR, &test_nums);
+        if (total < 0) return 2;
+        if (optind < argc) {
+            total = argc - optind;
+            for (int i = 0; i < total; i++) test_nums[i] = atoi(argv[optind + i]);
+        }
+        passed = run_pool(total, dir_task);
+        free(test_nums);
     }
 
     print_separator();
-    double pct = (double)passed / TEST_COUNT * 100.0;
-    printf("🏁 RESULTADO FINAL: %d/%d tests superados (%.2f%%)\n", passed, TEST_COUNT, pct);
+    double pct = total ? (double)passed / total * 100.0 : 0.0;
+    printf("🏁 RESULTADO FINAL: %d/%d tests superados (%.2f%%)\n", passed, total, pct);
+    if (nbins > 1) {
+        for (int b = 0; b < nbins; b++) {
+            printf("   %-24s %d/%d\n", bin_name(b), bin_passed[b], total);
+        }
+        if (disagreements) printf("🔀 %d test(s) con comportamiento distinto entre binarios\n", disagreements);
+        else printf("🟰 Todos los binarios se comportan igual\n");
+    }
     print_separator();
 
-    return 0;
+    if (nbins > 1) report_side_by_side();
+
+    BaselineEntry *base = NULL;
+    int nbase = update ? 0 : load_baseline(baseline_path, &base);
+    if (nbase < 0) nbase = 0;
+    int regressions = report_timings(base, nbase, threshold);
+    free(base);
+    print_separator();
+
+    if (update) {
+        if (save_baseline(baseline_path, base_bin) == 0) {
+            printf("💾 Línea base guardada en %s\n", baseline_path);
+        }
+    } else if (nbase == 0) {
+        printf("ℹ️  Sin línea base en %s (use -u para crearla)\n", baseline_path);
+    } else if (regressions > 0) {
+        printf("%s %d test(s) superan la línea base en más de %.0f%%\n",
+               warn_only ? "⚠️ " : "❌", regressions, threshold);
+        if (!warn_only) return 1;
+    } else {
+        printf("✅ Sin regresiones de rendimiento (umbral %.0f%%)\n", threshold);
+    }
+    return disagreements ? 1 : 0;
 }
@@ -0,0 +1,334 @@
+/*
+ * wish_trie.c – Trie de ejecutables del PATH mantenido con inotify
+ */
+
+#define _GNU_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include "wish_trie.h"
+
+#define TRIE_NONE UINT32_MAX
+
+/* Hijos como lista enlazada ordenada por carácter (primer hijo / hermano) */
+typedef struct {
+    uint32_t child, next;
+    uint32_t count;         /* directorios que aportan el nombre que acaba aquí */
+    uint32_t live;          /* nombres con count > 0 en el subárbol */
+    unsigned char c;
+} TrieNode;
+
+typedef struct {
+    char  *path;
+    int    wd;              /* -1 si no se pudo vigilar */
+    int    fd;              /* para comprobar permisos con faccessat */
+    char **names;           /* ejecutables que aporta */
+    int    nnames, cap;
+} WatchDir;
+
+static TrieNode *nodes;
+static uint32_t  nnodes, cap_nodes;
+static WatchDir *dirs_w;
+static int       ndirs_w;
+static int       ino_fd = -1;
+
+/* --------------------- Trie --------------------- */
+
+static uint32_t node_new(unsigned char c) {
+    if (nnodes == cap_nodes) {
+        uint32_t ncap = cap_nodes ? cap_nodes * 2 : 1024;
+        TrieNode *nn = realloc(nodes, (size_t)ncap * sizeof(TrieNode));
+        if (!nn) return TRIE_NONE;
+        nodes = nn;
+        cap_nodes = ncap;
+    }
+    nodes[nnodes] = (TrieNode){ TRIE_NONE, TRIE_NONE, 0, 0, c };
+    return nnodes++;
+}
+
+/* Hijo de n con carácter c; si create, lo inserta en orden */
+static uint32_t child_of(uint32_t n, unsigned char c, int create) {
+    uint32_t prev = TRIE_NONE, k = nodes[n].child;
+    while (k != TRIE_NONE && nodes[k].c < c) {
+        prev = k;
+        k = nodes[k].next;
+    }
+    if (k != TRIE_NONE && nodes[k].c == c) return k;
+    if (!create) return TRIE_NONE;
+
+    uint32_t nk = node_new(c);      /* puede mover nodes[] */
+    if (nk == TRIE_NONE) return TRIE_NONE;
+    nodes[nk].next = k;
+    if (prev == TRIE_NONE) nodes[n].child = nk;
+    else nodes[prev].next = nk;
+    return nk;
+}
+
+/* Suma delta al contador del nombre; ajusta "live" en el camino si el
+   nombre aparece o desaparece */
+static int trie_adjust(const char *name, int delta) {
+    if (nnodes == 0 && node_new(0) == TRIE_NONE) return -1;
+
+    uint32_t path[256];
+    size_t depth = 0;
+    uint32_t n = 0;
+    path[depth++] = n;
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        if (depth == sizeof(path) / sizeof(path[0])) return -1;
+        n = child_of(n, *p, delta > 0);
+        if (n == TRIE_NONE) return -1;
+        path[depth++] = n;
+    }
+
+    uint32_t before = nodes[n].count;
+    if (delta < 0 && before == 0) return -1;
+    nodes[n].count = before + (uint32_t)delta;
+    int flip = (before == 0) - (nodes[n].count == 0);
+    if (flip) {
+        for (size_t i = 0; i < depth; i++) nodes[path[i]].live += (uint32_t)flip;
+    }
+    return 0;
+}
+
+/* --------------------- Directorios vigilados --------------------- */
+
+static int is_exec(int dfd, const char *name) {
+    struct stat st;
+    return fstatat(dfd, name, &st, 0) == 0 && S_ISREG(st.st_mode) &&
+           faccessat(dfd, name, X_OK, 0) == 0;
+}
+
+static int dir_find(const WatchDir *d, const char *name) {
+    for (int i = 0; i < d->nnames; i++) {
+        if (!strcmp(d->names[i], name)) return i;
+    }
+    return -1;
+}
+
+static void dir_add(WatchDir *d, const char *name) {
+    if (d->nnames == d->cap) {
+        int ncap = d->cap ? d->cap * 2 : 64;
+        char **nv = realloc(d->names, (size_t)ncap * sizeof(char *));
+        if (!nv) return;
+        d->names = nv;
+        d->cap = ncap;
+    }
+    char *s = strdup(name);
+    if (!s) return;
+    if (trie_adjust(s, +1) < 0) {
+        free(s);
+        return;
+    }
+    d->names[d->nnames++] = s;
+}
+
+static void dir_remove(WatchDir *d, int i) {
+    trie_adjust(d->names[i], -1);
+    free(d->names[i]);
+    d->names[i] = d->names[--d->nnames];
+}
+
+/* Vuelve a decidir si name (de d) debe estar en el trie */
+static void dir_recheck(WatchDir *d, const char *name) {
+    int i = dir_find(d, name);
+    int exec = d->fd >= 0 && is_exec(d->fd, name);
+    if (exec && i < 0) dir_add(d, name);
+    else if (!exec && i >= 0) dir_remove(d, i);
+}
+
+static void dir_forget(WatchDir *d) {
+    while (d->nnames > 0) dir_remove(d, d->nnames - 1);
+    free(d->names);
+    if (d->wd >= 0 && ino_fd >= 0) inotify_rm_watch(ino_fd, d->wd);
+    if (d->fd >= 0) close(d->fd);
+    free(d->path);
+}
+
+static int dir_watch(WatchDir *d, const char *path) {
+    memset(d, 0, sizeof(*d));
+    d->path = strdup(path);
+    d->wd = -1;
+    d->fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (!d->path) return -1;
+    if (d->fd < 0) return 0;          /* no existe (aún): sin nombres */
+
+    if (ino_fd >= 0) {
+        d->wd = inotify_add_watch(ino_fd, path,
+                                  IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                                  IN_ATTRIB | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF);
+    }
+    int sfd = dup(d->fd);
+    DIR *dir = sfd >= 0 ? fdopendir(sfd) : NULL;
+    if (!dir) {
+        if (sfd >= 0) close(sfd);
+        return 0;
+    }
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL) {
+        if (de->d_name[0] == '.' && (!de->d_name[1] || !strcmp(de->d_name, ".."))) continue;
+        /* d_type evita el stat en lo que seguro no es un archivo */
+        if (de->d_type != DT_UNKNOWN && de->d_type != DT_REG && de->d_type != DT_LNK) continue;
+        if (is_exec(d->fd, de->d_name)) dir_add(d, de->d_name);
+    }
+    closedir(dir);
+    return 0;
+}
+
+/* No existía, no se pudo vigilar o lo borraron. Mientras d->fd siga
+   abierto el núcleo no manda IN_DELETE_SELF, así que el borrado se ve en
+   st_nlink == 0 */
+static int dir_lost(const WatchDir *d) {
+    struct stat st;
+    return d->fd < 0 || d->wd < 0 || fstat(d->fd, &st) != 0 || st.st_nlink == 0;
+}
+
+/* Vuelve a vigilar un directorio perdido (quizá ya recreado): sin esto no
+   se miraría nunca más */
+static int dir_rewatch(WatchDir *d) {
+    char *path = d->path;
+    d->path = NULL;
+    dir_forget(d);
+    int rc = dir_watch(d, path);
+    free(path);
+    return rc;
+}
+
+int trie_set_path(char *const *dirs, int n) {
+    if (ino_fd < 0) ino_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    /* Olvidar los directorios que ya no están en el PATH */
+    for (int i = 0; i < ndirs_w; ) {
+        int keep = 0;
+        for (int j = 0; j < n && !keep; j++) keep = !strcmp(dirs[j], dirs_w[i].path);
+        if (keep) { i++; continue; }
+        dir_forget(&dirs_w[i]);
+        dirs_w[i] = dirs_w[--ndirs_w];
+    }
+
+    /* Escanear los nuevos y los que no se pudieron vigilar */
+    for (int j = 0; j < n; j++) {
+        int known = -1;
+        for (int i = 0; i < ndirs_w && known < 0; i++) {
+            if (!strcmp(dirs[j], dirs_w[i].path)) known = i;
+        }
+        if (known >= 0) {
+            WatchDir *d = &dirs_w[known];
+            if (dir_lost(d) && dir_rewatch(d) < 0) return -1;
+            continue;
+        }
+        WatchDir *nw = realloc(dirs_w, (size_t)(ndirs_w + 1) * sizeof(WatchDir));
+        if (!nw) return -1;
+        dirs_w = nw;
+        if (dir_watch(&dirs_w[ndirs_w], dirs[j]) < 0) return -1;
+        ndirs_w++;
+    }
+    return 0;
+}
+
+void trie_refresh(void) {
+    if (ino_fd < 0) return;
+    char buf[16384] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t len;
+    while ((len = read(ino_fd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + len; ) {
+            struct inotify_event *ev = (struct inotify_event *)p;
+            p += sizeof(*ev) + ev->len;
+
+            WatchDir *d = NULL;
+            for (int i = 0; i < ndirs_w && !d; i++) {
+                if (dirs_w[i].wd == ev->wd) d = &dirs_w[i];
+            }
+            if (!d) continue;
+
+            if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+                /* El directorio desapareció: sus nombres también */
+                while (d->nnames > 0) dir_remove(d, d->nnames - 1);
+                d->wd = -1;
+                continue;
+            }
+            if (ev->len == 0) continue;
+            if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                int i = dir_find(d, ev->name);
+                if (i >= 0) dir_remove(d, i);
+            } else {
+                dir_recheck(d, ev->name);
+            }
+        }
+    }
+    /* Un directorio del PATH que aparece (o reaparece) después también
+       cuenta */
+    for (int i = 0; i < ndirs_w; i++) {
+        if (dir_lost(&dirs_w[i])) dir_rewatch(&dirs_w[i]);
+    }
+}
+
+/* --------------------- Búsqueda --------------------- */
+
+typedef struct {
+    char **v;
+    int    n, cap;
+    char   buf[256];
+} Collect;
+
+static int collect(uint32_t n, size_t depth, Collect *c) {
+    if (nodes[n].count > 0) {
+        if (c->n == c->cap) {
+            int ncap = c->cap ? c->cap * 2 : 16;
+            char **nv = realloc(c->v, (size_t)ncap * sizeof(char *));
+            if (!nv) return -1;
+            c->v = nv;
+            c->cap = ncap;
+        }
+        c->buf[depth] = '\0';
+        if (!(c->v[c->n] = strdup(c->buf))) return -1;
+        c->n++;
+    }
+    /* Los hijos están ordenados: el resultado sale ya en orden */
+    for (uint32_t k = nodes[n].child; k != TRIE_NONE; k = nodes[k].next) {
+        if (nodes[k].live == 0 || depth + 1 >= sizeof(c->buf)) continue;
+        c->buf[depth] = (char)nodes[k].c;
+        if (collect(k, depth + 1, c) < 0) return -1;
+    }
+    return 0;
+}
+
+int trie_complete(const char *prefix, char ***out) {
+    *out = NULL;
+    size_t plen = strlen(prefix);
+    if (nnodes == 0 || plen >= sizeof(((Collect *)0)->buf)) return 0;
+
+    uint32_t n = 0;
+    for (const unsigned char *p = (const unsigned char *)prefix; *p && n != TRIE_NONE; p++) {
+        n = child_of(n, *p, 0);
+    }
+    if (n == TRIE_NONE || nodes[n].live == 0) return 0;
+
+    Collect c = { NULL, 0, 0, { 0 } };
+    memcpy(c.buf, prefix, plen);
+    if (collect(n, plen, &c) < 0) {
+        for (int i = 0; i < c.n; i++) free(c.v[i]);
+        free(c.v);
+        return -1;
+    }
+    *out = c.v;
+    return c.n;
+}
+
+void trie_clear(void) {
+    for (int i = 0; i < ndirs_w; i++) dir_forget(&dirs_w[i]);
+    free(dirs_w);
+    dirs_w = NULL;
+    ndirs_w = 0;
+    free(nodes);
+    nodes = NULL;
+    nnodes = cap_nodes = 0;
+    if (ino_fd >= 0) close(ino_fd);
+    ino_fd = -1;
+}
@@ -0,0 +1,29 @@
+/*
+ * wish_trie.h – Trie de prefijos con los ejecutables del PATH de wish
+ *
+ * Cada directorio del PathList se lee una vez cuando "path" lo añade y
+ * luego se vigila con inotify: crear, borrar, renombrar o cambiar permisos
+ * actualiza el trie sin volver a escanear. Un nombre puede venir de varios
+ * directorios; cada nodo cuenta cuántos lo aportan y cuántos nombres vivos
+ * cuelgan de él, así que las búsquedas descartan ramas vacías sin recorrerlas.
+ */
+
+#ifndef WISH_TRIE_H
+#define WISH_TRIE_H
+
+/* Sincroniza los directorios vigilados con dirs: se escanean los nuevos
+   y los que no existían o dejaron de vigilarse, y se olvidan los que ya
+   no están. Retorna 0 o -1. */
+int  trie_set_path(char *const *dirs, int n);
+
+/* Aplica los eventos de inotify pendientes y reintenta vigilar los
+   directorios que faltaban (no bloquea) */
+void trie_refresh(void);
+
+/* Nombres que empiezan por prefix, ordenados; en *out un vector (malloc)
+   de cadenas (malloc). Retorna cuántos o -1 si error. */
+int  trie_complete(const char *prefix, char ***out);
+
+void trie_clear(void);
+
+#endif
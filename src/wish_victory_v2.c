@@ -1,13 +1,61 @@
 /*
  * wish_victory_v2.c — Shell WISH final para laboratorio
- * - Built-ins: exit, cd, path (validaciones de argumentos)
+ * - Built-ins: exit, cd, path, export, unset, set, stats (validaciones de
+ *   argumentos)
  * - PATH dinámico (inicial: /bin)
  * - Comandos externos con fork/execv + access(X_OK)
  * - Redirección '>' (stdout y stderr al MISMO archivo) — un único archivo
- * - Paralelismo '&' (lanza todos y luego wait() a todos)
+ * - "cmd >+ a b c": la misma salida a varios archivos; el hijo escribe en una
+ *   tubería que un hilo reparte con tee/splice (ver wish_fanout.h)
+ * - Entrada '< archivo' y here-strings '<<< "texto"': se preparan en el
+ *   padre (el texto en un memfd sellado, sin tocar el disco) y el hijo
+ *   solo hace dup2
+ * - Asignaciones "A=1 B=2 cmd" solo para ese comando; export/unset cambian el
+ *   entorno de los siguientes. Los hijos hacen execve con un vector ya
+ *   preparado (ver wish_env.h)
+ * - Paralelismo '&', secuencia ';', condicionales '&&' / '||' y grupos '( )':
+ *   la línea se analiza a un grafo de dependencias (ver wish_parse.h) y cada
+ *   nodo arranca en cuanto terminan sus predecesores. Cada grupo corre en
+ *   una copia del shell (fork sin exec) con su cwd, PATH y entorno propios
+ *   (ver sección subshell)
  * - Modo interactivo (con prompt) y batch (sin prompt, usando argv[1])
  * - ÚNICO mensaje de error: "An error has occurred\n" a stderr
- * - Sin system(); usa getline(), strsep(), fork(), execv(), waitpid(), dup2(), open(), access()
+ * - Sin system(); usa fork(), execv(), waitpid(), dup2(), open(), access()
+ * - Sin stdio: líneas con read() y prompt/errores con write() (ver wish_io.h);
+ *   "make wish-static" genera un binario estático que arranca sin cargador
+ * - "wish -c 'línea'": ejecuta una sola línea y termina con su código
+ * - Prefijo opcional "cached" para reutilizar resultados (ver wish_cache.h)
+ * - Expansión de comodines *, ? y [...] en los argumentos (ver wish_glob.h)
+ * - Scripts precompilados: "wish --compile script -o script.wbc" y
+ *   "wish script.wbc" (ver wish_bytecode.h)
+ * - "wish --workers unix:/ruta,tcp:host:puerto [--token clave]": los
+ *   externos se ejecutan en agentes wish_worker (ver wish_remote.h)
+ * - "wish --multi [-j N] a.wsh b.wsh ...": varios scripts a la vez, cada uno
+ *   con su PathList y su directorio (ver wish_dir.h), compartiendo N huecos
+ * - "map [-j N] [-i lista] [-k] cmd {} > {}.out": el comando una vez por
+ *   línea de la lista, con como mucho N hijos a la vez (ver sección map)
+ * - "xbatch [-j N] [-f K] cmd args... > out": reparte una lista de
+ *   argumentos demasiado larga para un solo execve en los menos lotes que
+ *   caben en ARG_MAX y junta sus salidas en orden (ver sección xbatch)
+ * - "--fail-fast" o "set -e": el primer hijo que falla cancela a los que
+ *   corren a la vez en su script (grupo de procesos) y detiene el script
+ *   (ver sección fail-fast)
+ * - "--journal diario [--resume]": progreso por línea para reanudar un script
+ *   batch (ver wish_journal.h)
+ * - "--record log" graba cada línea con su cwd, PATH, tiempos y códigos;
+ *   "wish --replay log [--speed N]" la reproduce y compara latencias
+ *   (ver wish_record.h)
+ * - Las opciones --workers, --token, --fail-fast, --record, --journal y
+ *   --resume van antes del modo en cualquier orden; las combinaciones que no
+ *   tienen sentido (p. ej. --journal con --multi o -c) son un error
+ * - Contadores e histogramas del propio shell: "stats" los muestra y
+ *   WISH_METRICS_FILE los exporta para Prometheus (ver wish_stats.h)
+ * - Un wish batch publica su línea en curso y sus hijos en memoria
+ *   compartida; "wishtop" los muestra en vivo (ver wish_live.h)
+ * - Sondas USDT para bpftrace/perf en lectura, análisis, fork, exec y
+ *   recogida de hijos (ver wish_probe.h y probes/)
+ * - En una terminal, editor de línea con Tab para comandos y rutas
+ *   (ver wish_edit.h y wish_trie.h)
  */
 
 #define _GNU_SOURCE
@@ -15,13 +63,31 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <signal.h>
 #include <unistd.h>
+#include <time.h>
 #include <sys/wait.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include "wish_cache.h"
+#include "wish_glob.h"
+#include "wish_parse.h"
+#include "wish_bytecode.h"
+#include "wish_remote.h"
+#include "wish_dir.h"
+#include "wish_edit.h"
+#include "wish_journal.h"
+#include "wish_io.h"
+#include "wish_env.h"
+#include "wish_fanout.h"
+#include "wish_stats.h"
+#include "wish_record.h"
+#include "wish_probe.h"
+#include "wish_live.h"
 
 #define MAX_PATHS   128
-#define MAX_ARGS    128
 
 static const char ERRMSG[] = "An error has occurred\n";
 
@@ -31,35 +97,6 @@ static void print_error(void) {
     write(STDERR_FILENO, ERRMSG, strlen(ERRMSG));
 }
 
-/* Convierte una línea colocando espacios alrededor de '>' y '&'
-   para permitir parseo robusto con o sin espacios en el input original. */
-static char *normalize_ops(const char *line) {
-    size_t n = strlen(line);
-    /* Peor caso: cada char es un operador, necesitamos ~3x */
-    size_t cap = n * 3 + 1;
-    char *out = (char *)malloc(cap);
-    if (!out) return NULL;
-
-    size_t j = 0;
-    for (size_t i = 0; i < n; i++) {
-        char c = line[i];
-        if (c == '>' || c == '&') {
-            out[j++] = ' ';
-            out[j++] = c;
-            out[j++] = ' ';
-        } else {
-            out[j++] = c;
-        }
-        if (j + 4 >= cap) { /* ampliar por seguridad */
-            cap *= 2;
-            out = (char *)realloc(out, cap);
-            if (!out) return NULL;
-        }
-    }
-    out[j] = '\0';
-    return out;
-}
-
 /* --------------------- PATH --------------------- */
 
 typedef struct {
@@ -89,111 +126,208 @@ static void path_set(PathList *pl, char **argv) {
     }
 }
 
-/* --------------------- Parseo de subcomandos --------------------- */
-
-typedef struct {
-    char *argv[MAX_ARGS];  /* argumentos (argv[0] = comando) */
-    int   argc;
-    int   has_redir;
-    char *redir_file;      /* nombre del archivo si has_redir */
-} Cmd;
-
-/* Tokeniza por espacios usando strtok_r */
-static int split_ws(char *s, char **toks, int maxtoks) {
-    int n = 0;
-    char *save = NULL;
-    for (char *tok = strtok_r(s, " \t\r\n", &save);
-         tok != NULL && n < maxtoks - 1;
-         tok = strtok_r(NULL, " \t\r\n", &save)) {
-        toks[n++] = tok;
-    }
-    toks[n] = NULL;
-    return n;
-}
-
-/* Parsea un "segmento" (una sub-orden separada por '&'):
-   - Extrae argv[]
-   - Maneja un único '>' con exactamente 1 filename
-   Retorna:
-   -1: error de sintaxis
-    0: suborden vacía (ignorar)
-    1: OK
-*/
-static int parse_command(char *segment, Cmd *cmd) {
-    memset(cmd, 0, sizeof(*cmd));
-
-    /* Contar '>' tras normalizar ayuda, pero aquí contamos directo */
-    int gt_count = 0;
-    for (char *p = segment; *p; p++) if (*p == '>') gt_count++;
-    if (gt_count > 1) return -1;
-
-    /* Separar izquierda/derecha por '>' si existe */
-    char *right = NULL;
-    if (gt_count == 1) {
-        right = strchr(segment, '>');
-        *right = '\0';
-        right++;
-    }
-
-    /* Tokenizar izquierda (comando + args) */
-    cmd->argc = split_ws(segment, cmd->argv, MAX_ARGS);
-    if (cmd->argc == 0) return 0; /* suborden vacía */
-
-    /* Si hay redirección, la parte derecha debe tener EXACTAMENTE un token */
-    if (gt_count == 1) {
-        cmd->has_redir = 1;
-        if (!right) return -1;
-        char *tmp = strdup(right);
-        char *rtoks[4];
-        int m = split_ws(tmp, rtoks, 4);
-        if (m != 1) { free(tmp); return -1; }
-        cmd->redir_file = strdup(rtoks[0]);
-        free(tmp);
-    }
-    return 1;
-}
-
 static int is_builtin(const char *cmd) {
-    return (!strcmp(cmd, "exit") || !strcmp(cmd, "cd") || !strcmp(cmd, "path"));
+    return (!strcmp(cmd, "exit") || !strcmp(cmd, "cd") || !strcmp(cmd, "path") ||
+            !strcmp(cmd, "export") || !strcmp(cmd, "unset") || !strcmp(cmd, "set") ||
+            !strcmp(cmd, "stats"));
 }
 
 /* --------------------- Built-ins --------------------- */
 
-static int builtin_exit(char **argv) {
+/* En --multi y --replay (isolated) exit solo termina el script: retorna 0 */
+static int builtin_exit(char **argv, int isolated) {
     /* exit no acepta argumentos */
     if (argv[1] != NULL) {
         print_error();
-        return 0; /* no salir */
+        return 1; /* no salir */
     }
-    exit(0);
+    if (!isolated) exit(0);
+    return 0;
 }
 
-static void builtin_cd(char **argv) {
+static int builtin_cd(char **argv) {
     /* cd acepta exactamente 1 argumento */
     if (argv[1] == NULL || argv[2] != NULL) {
         print_error();
-        return;
+        return 1;
+    }
+    if (wish_dirfd == AT_FDCWD) {
+        if (chdir(argv[1]) != 0) {
+            print_error();
+            return 1;
+        }
+        return 0;
     }
-    if (chdir(argv[1]) != 0) {
+
+    /* --multi: solo cambia el directorio del script */
+    int fd = openat(wish_dirfd, argv[1], O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0 || faccessat(fd, ".", X_OK, 0) != 0) {
+        if (fd >= 0) close(fd);
         print_error();
+        return 1;
     }
+    close(wish_dirfd);
+    wish_dirfd = fd;
+    return 0;
 }
 
-static void builtin_path(char **argv, PathList *pl) {
+static int builtin_path(char **argv, PathList *pl) {
     path_set(pl, argv);
+    edit_path_changed(pl->dirs, pl->count);
+    return 0;
+}
+
+/* export NOMBRE=valor...: define o reemplaza. "export NOMBRE" solo vale
+   para una variable que ya existe (no hay variables sin exportar) y sin
+   argumentos lista el entorno. */
+static int builtin_export(char **argv, Env *env) {
+    if (argv[1] == NULL) {
+        for (int i = 0; i < env->count; i++) {
+            io_puts(STDOUT_FILENO, env->vec[i]);
+            io_puts(STDOUT_FILENO, "\n");
+        }
+        return 0;
+    }
+    int st = 0;
+    for (int i = 1; argv[i] != NULL; i++) {
+        int ok = env_valid_name(argv[i]) &&
+                 (strchr(argv[i], '=') ? env_set(env, argv[i]) == 0 : env_get(env, argv[i]) != NULL);
+        if (!ok) {
+            print_error();
+            st = 1;
+        }
+    }
+    return st;
+}
+
+/* unset NOMBRE...: quitar una variable que no existe no es error */
+static int builtin_unset(char **argv, Env *env) {
+    if (argv[1] == NULL) {
+        print_error();
+        return 1;
+    }
+    int st = 0;
+    for (int i = 1; argv[i] != NULL; i++) {
+        if (!env_valid_name(argv[i]) || strchr(argv[i], '=')) {
+            print_error();
+            st = 1;
+            continue;
+        }
+        env_unset(env, argv[i]);
+    }
+    return st;
+}
+
+/* set -e / set +e: activa o desactiva fail-fast para lo que venga después */
+static int builtin_set(char **argv, int *failfast) {
+    if (argv[1] == NULL || argv[2] != NULL ||
+        (strcmp(argv[1], "-e") != 0 && strcmp(argv[1], "+e") != 0)) {
+        print_error();
+        return 1;
+    }
+    *failfast = argv[1][0] == '-';
+    return 0;
+}
+
+/* stats: contadores e histogramas del shell (ver wish_stats.h) */
+static int builtin_stats(char **argv) {
+    if (argv[1] != NULL) {
+        print_error();
+        return 1;
+    }
+    stats_print(STDOUT_FILENO);
+    return 0;
+}
+
+/* Busca el ejecutable en el PATH del shell; retorna 0 y deja la ruta en out */
+static int path_resolve(const PathList *pl, const char *name, char *out, size_t outsz) {
+    for (int i = 0; i < pl->count; i++) {
+        snprintf(out, outsz, "%s/%s", pl->dirs[i], name);
+        if (faccessat(wish_dirfd, out, X_OK, 0) == 0) return 0;
+    }
+    return -1;
+}
+
+/* --------------------- Prefijo "cached" --------------------- */
+
+/* Quita "cached" y sus opciones (-i/-m archivo) del argv del comando.
+   Retorna:
+   -1: error de sintaxis
+    0: el comando no usa la caché
+    1: comando cacheable (argv ya desplazado)
+    2: "cached --stats" */
+static int parse_cached_prefix(Cmd *cmd, CacheInputs *in) {
+    memset(in, 0, sizeof(*in));
+    if (strcmp(cmd->argv[0], "cached") != 0) return 0;
+
+    int i = 1;
+    if (cmd->argv[i] && !strcmp(cmd->argv[i], "--stats")) {
+        return (cmd->argv[i + 1] == NULL && !cmd->has_redir) ? 2 : -1;
+    }
+    while (cmd->argv[i] && (!strcmp(cmd->argv[i], "-i") || !strcmp(cmd->argv[i], "-m"))) {
+        if (cmd->argv[i + 1] == NULL || in->count >= CACHE_MAX_INPUTS) return -1;
+        in->by_mtime[in->count] = (cmd->argv[i][1] == 'm');
+        in->paths[in->count++] = cmd->argv[i + 1];
+        i += 2;
+    }
+    if (cmd->argv[i] == NULL) return -1;
+
+    /* Desplazar argv para que argv[0] sea el comando real */
+    memmove(cmd->argv, cmd->argv + i, (size_t)(cmd->argc - i + 1) * sizeof(char *));
+    cmd->argc -= i;
+    return 1;
 }
 
 /* --------------------- Ejecución de externos --------------------- */
 
-static pid_t launch_external(Cmd *cmd, PathList *pl) {
+/* stdin del comando. '<' se abre en el padre: un archivo que no existe
+   falla sin llegar a hacer fork. '<<<' se escribe en un memfd sellado que
+   el hijo lee como un archivo cualquiera. Retorna el fd (O_CLOEXEC), -1
+   si el comando no redirige su entrada o -2 si falló. */
+static int open_input(const Cmd *cmd) {
+    if (cmd->in_file) {
+        int fd = openat(wish_dirfd, cmd->in_file, O_RDONLY | O_CLOEXEC);
+        return fd >= 0 ? fd : -2;
+    }
+    if (!cmd->here) return -1;
+    int fd = memfd_create("wish-here", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) return -2;
+    size_t len = strlen(cmd->here);
+    if (write(fd, cmd->here, len) != (ssize_t)len ||
+        fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0 ||
+        lseek(fd, 0, SEEK_SET) < 0) {
+        close(fd);
+        return -2;
+    }
+    return fd;
+}
+
+static pid_t launch_pgid = -1;  /* grupo del próximo hijo: -1 el del shell,
+                                   0 uno nuevo, >0 ese (ver fail-fast) */
+
+/* out_fd >= 0: stdout y stderr van a ese descriptor (lo usa map).
+   El hijo hereda env tal cual, o con las asignaciones del comando encima. */
+static pid_t launch_external(Cmd *cmd, PathList *pl, const Env *env, const CacheJob *cj,
+                             int out_fd) {
     if (pl->count == 0) {
         /* PATH vacío: nada debe ejecutarse */
         print_error();
         return -1;
     }
+    char **envp = env_overlay(env, cmd->assign, cmd->nassign);
+    int in_fd = envp ? open_input(cmd) : -2;
+    if (in_fd == -2) {
+        if (envp != env->vec) free(envp);
+        print_error();
+        return -1;
+    }
 
+    WISH_PROBE1(spawn, cmd->argv[0]);
+    uint64_t t0 = stats_now();
     pid_t pid = fork();
     if (pid < 0) {
+        if (in_fd >= 0) close(in_fd);
+        if (envp != env->vec) free(envp);
         print_error();
         return -1;
     }
@@ -201,7 +335,16 @@ static pid_t launch_external(Cmd *cmd, PathList *pl) {
     if (pid == 0) {
         /* Hijo */
         int fd = -1;
-        if (cmd->has_redir) {
+        if (launch_pgid >= 0) setpgid(0, launch_pgid);
+        if (wish_dirfd != AT_FDCWD && fchdir(wish_dirfd) != 0) { print_error(); _exit(1); }
+        if (in_fd >= 0 && dup2(in_fd, STDIN_FILENO) < 0) { print_error(); _exit(1); }
+        if (cj) {
+            /* Fallo de caché: la salida se captura y el padre la entrega */
+            if (cache_child_redirect(cj) < 0) { print_error(); _exit(1); }
+        } else if (out_fd >= 0) {
+            if (dup2(out_fd, STDOUT_FILENO) < 0) { print_error(); _exit(1); }
+            if (dup2(out_fd, STDERR_FILENO) < 0) { print_error(); _exit(1); }
+        } else if (cmd->has_redir) {
             fd = open(cmd->redir_file, O_WRONLY | O_CREAT | O_TRUNC, 0666);
             if (fd < 0) { print_error(); _exit(1); }
             if (dup2(fd, STDOUT_FILENO) < 0) { print_error(); _exit(1); }
@@ -210,150 +353,1695 @@ static pid_t launch_external(Cmd *cmd, PathList *pl) {
         }
 
         /* Buscar ejecutable en cada directorio del PATH */
-        for (int i = 0; i < pl->count; i++) {
-            char full[1024];
-            snprintf(full, sizeof(full), "%s/%s", pl->dirs[i], cmd->argv[0]);
-            if (access(full, X_OK) == 0) {
-                execv(full, cmd->argv);
-                /* Si retorna, error al ejecutar */
-                print_error();
-                _exit(1);
-            }
+        char full[1024];
+        if (path_resolve(pl, cmd->argv[0], full, sizeof(full)) == 0) {
+            execve(full, cmd->argv, envp);
+            /* Si retorna, error al ejecutar */
+            WISH_PROBE2(exec__fail, cmd->argv[0], errno);
+            stats_count(SC_EXEC_FAIL);
+            print_error();
+            _exit(1);
         }
         /* No encontrado en ningún directorio */
+        WISH_PROBE2(exec__fail, cmd->argv[0], ENOENT);
+        stats_count(SC_PATH_MISS);
         print_error();
         _exit(1);
     }
+    uint64_t fork_ns = stats_now() - t0;
+    WISH_PROBE2(spawn__done, pid, fork_ns);
+    stats_record(ST_FORK, fork_ns);
+    stats_count(SC_FORKS);
 
-    /* Padre: devuelve PID para esperar luego */
+    /* Padre: devuelve PID para esperar luego. El grupo se fija en los dos
+       lados para que ya valga cuando el siguiente hijo quiera unirse. */
+    if (launch_pgid >= 0) setpgid(pid, launch_pgid ? launch_pgid : pid);
+    if (in_fd >= 0) close(in_fd);
+    if (envp != env->vec) free(envp);
     return pid;
 }
 
-/* --------------------- Procesar línea completa (paralelismo) --------------------- */
+/* --------------------- Planificador --------------------- */
+
+/* Contexto de un script: en modo normal hay uno solo; con --multi hay uno
+   por script y todos comparten la tabla de trabajos */
+typedef struct {
+    PathList *pl;
+    Env      *env;
+    int       dirfd;      /* wish_dirfd del script */
+    int       isolated;   /* --multi: exit y cd solo afectan a este script;
+                             --replay: exit no termina el shell */
+    int       stopped;    /* exit ejecutado: no arranca nada más */
+
+    /* fail-fast */
+    int       failfast;   /* --fail-fast / set -e */
+    pid_t     pgid;       /* grupo de los hijos vivos; 0 = ninguno */
+    int       live;       /* hijos vivos lanzados con fail-fast */
+    int       cancelled;  /* un hijo falló: no arranca nada más */
+    int       ff_code;    /* código del hijo que canceló */
+    int       ff_killed;  /* compañeros que murieron por su SIGTERM */
+    char      ff_cmd[128];/* su comando */
+} Sched;
+
+static int fail_fast;     /* --fail-fast: valor inicial de cada script */
+
+static void sched_init(Sched *s, PathList *pl, Env *env, int dirfd, int isolated) {
+    memset(s, 0, sizeof(*s));
+    s->pl = pl;
+    s->env = env;
+    s->dirfd = dirfd;
+    s->isolated = isolated;
+    s->failfast = fail_fast;
+}
+
+typedef struct Map Map;
+
+/* Hijo en ejecución; cj != NULL si su salida va a la caché.
+   Los trabajos remotos tienen pid -1 y se identifican por rid.
+   Los elementos de map llevan su Map y su hueco en la ventana.
+   fan != NULL si su salida se reparte con '>+'; failfast si cuenta para la
+   cancelación de su script y termed si esa cancelación le mandó SIGTERM.
+   t0: cuándo se lanzó (sonda reap). */
+typedef struct {
+    pid_t     pid;
+    Node     *node;
+    Sched    *sched;
+    CacheJob *cj;
+    char     *redir_file;
+    uint32_t  rid;
+    Map      *map;
+    uint32_t  slot;
+    Fanout   *fan;
+    int       failfast;
+    int       termed;
+    uint64_t  t0;
+} Job;
+
+/* Comando a la espera de un hueco (--multi -j N) */
+typedef struct {
+    Node  *node;
+    Sched *sched;
+} Pending;
+
+static Job     *jobs;
+static int      njobs, cap_jobs;
+static int      nremote;        /* trabajos que corren en un agente */
+static Pending *pending;
+static int      npending, cap_pending;
+static int      slot_limit;     /* hijos locales simultáneos; 0 = sin límite */
+static int      slots_used;
+static int      cwd_known;      /* cwd_cache vale hasta el próximo cd */
+static char     cwd_cache[4096];
+
+static void node_start(Node *n, Sched *s);
+static void node_finish(Node *n, int status, Sched *s);
+static void map_start(Node *n, Sched *s);
+static void subshell_start(Node *n, Sched *s);
+static void map_item_done(Map *m, uint32_t slot, int code);
+
+/* Código de salida al estilo sh a partir del estado de waitpid */
+static int exit_code(int status) {
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return 1;
+}
+
+/* Asegura hueco para un trabajo más */
+static int jobs_reserve(void) {
+    if (njobs < cap_jobs) return 0;
+    int ncap = cap_jobs ? cap_jobs * 2 : 16;
+    Job *nj = realloc(jobs, (size_t)ncap * sizeof(Job));
+    if (!nj) return -1;
+    jobs = nj;
+    cap_jobs = ncap;
+    return 0;
+}
+
+static int jobs_add(const Job *job) {
+    if (jobs_reserve() < 0) return -1;
+    jobs[njobs++] = *job;
+    if (job->pid > 0) slots_used++;
+    else nremote++;
+    return 0;
+}
+
+/* --------------------- fail-fast --------------------- */
+
+/* Con fail-fast el primer hijo que termina con error cancela a los que
+   corren a la vez en su script: reciben SIGTERM, no arranca nada más y el
+   script termina con el código de ese hijo. Los hijos vivos de un script
+   comparten un grupo de procesos (lo crea el primero y, cuando ya no queda
+   ninguno, el siguiente empieza otro), así que la señal llega también a
+   lo que ellos hayan lanzado.
+
+   Si stdin es una terminal no se crean grupos: un hijo fuera del grupo en
+   primer plano se detendría al leerla. Entonces solo se avisa a los hijos
+   directos. Como en sh, no cuentan los fallos en la condición de un '&&' /
+   '||' (todas las etapas menos la última) ni los elementos de map, que
+   tienen su propio informe. */
+
+static int pgroups = -1;        /* se usan grupos: stdin no es una terminal */
+
+/* Antes de lanzar un hijo del script */
+static void ff_prepare(const Sched *s) {
+    if (pgroups < 0) pgroups = !isatty(STDIN_FILENO);
+    launch_pgid = (s->failfast && pgroups) ? s->pgid : -1;
+}
+
+/* Después de lanzarlo (pid <= 0: no llegó a correr) */
+static void ff_launched(Sched *s, Job *job, pid_t pid) {
+    launch_pgid = -1;
+    if (pid <= 0 || !s->failfast) return;
+    if (pgroups && s->pgid == 0) s->pgid = pid;
+    s->live++;
+    job->failfast = 1;
+}
+
+/* El hijo de job ya fue recogido */
+static void ff_reaped(const Job *job) {
+    if (job->failfast && --job->sched->live == 0) job->sched->pgid = 0;
+}
+
+/* 1 si el resultado de n solo decide un '&&' / '||' posterior */
+static int in_condition(const Node *n) {
+    for (; n->parent; n = n->parent) {
+        if (n->parent->type == NODE_ANDOR && n->index < n->parent->nkids - 1) return 1;
+    }
+    return 0;
+}
 
-static void process_line(char *raw_line, PathList *pl) {
-    /* Normalizar operadores para parseo robusto */
-    char *line = normalize_ops(raw_line);
-    if (!line) { print_error(); return; }
+/* job (ya fuera de la tabla) terminó con code != 0: cancela su script */
+static void ff_cancel(const Job *job, int code) {
+    Sched *s = job->sched;
+    s->cancelled = 1;
+    s->ff_code = code;
+    size_t len = 0;
+    const SimpleCmd *sc = &job->node->sc;
+    if (job->node->type == NODE_LIST) snprintf(s->ff_cmd, sizeof(s->ff_cmd), "( ... )");
+    for (int i = 0; i < sc->nwords && len < sizeof(s->ff_cmd); i++) {
+        len += (size_t)snprintf(s->ff_cmd + len, sizeof(s->ff_cmd) - len, "%s%s",
+                                i ? " " : "", sc->words[i]);
+    }
+    for (int k = 0; k < njobs; k++) {
+        if (jobs[k].sched != s || !jobs[k].failfast || jobs[k].pid <= 0) continue;
+        /* Se cuenta al recogerlo, si de verdad murió por la señal */
+        if (kill(jobs[k].pid, SIGTERM) == 0) jobs[k].termed = 1;
+    }
+    if (s->pgid > 0) kill(-s->pgid, SIGTERM);
+}
+
+/* Resumen de la cancelación por stderr (name: "wish" o el script) */
+static void ff_report(const char *name, const Sched *s) {
+    if (!s->cancelled) return;
+    dprintf(STDERR_FILENO, "%s: fail-fast: '%s' terminó con %d; %d cancelados\n",
+            name, s->ff_cmd, s->ff_code, s->ff_killed);
+}
+
+/* --------------------- Comandos con caché --------------------- */
+
+/* Resuelve la clave del comando: en un acierto restaura la salida sin fork
+   (retorna 0 y deja el estado en *hit_status); en un fallo lanza el hijo
+   capturando su salida (job->cj queda asignado). */
+static pid_t launch_cached(Cmd *cmd, PathList *pl, const Env *env, const CacheInputs *in,
+                           Job *job, int *hit_status) {
+    char bin[1024];
+    char key[CACHE_KEY_LEN];
+    if (pl->count == 0 || path_resolve(pl, cmd->argv[0], bin, sizeof(bin)) != 0) {
+        if (pl->count) stats_count(SC_PATH_MISS);
+        print_error();
+        return -1;
+    }
+    if (cache_compute_key(bin, cmd->argv, cmd->has_redir, in, key) != 0) {
+        print_error();
+        return -1;
+    }
+    int r = cache_replay(key, cmd->redir_file, hit_status);
+    if (r == 1) return 0;
+    if (r < 0) {
+        /* Parte de la salida ya salió: repetir el comando la duplicaría */
+        print_error();
+        return -1;
+    }
 
-    /* Separar por '&' (comandos paralelos) */
-    char *save = NULL;
-    char *seg = NULL;
-    pid_t pids[256];
-    int    pcount = 0;
+    CacheJob *cj = malloc(sizeof(*cj));
+    if (!cj || cache_begin(cj, key, cmd->has_redir) != 0) {
+        /* Sin caché utilizable: ejecución normal */
+        free(cj);
+        return launch_external(cmd, pl, env, NULL, -1);
+    }
+    pid_t pid = launch_external(cmd, pl, env, cj, -1);
+    if (pid <= 0) {
+        cache_abort(cj);
+        free(cj);
+        return pid;
+    }
+    job->cj = cj;
+    job->redir_file = cmd->redir_file ? strdup(cmd->redir_file) : NULL;
+    return pid;
+}
 
-    for (seg = strtok_r(line, "&", &save);
-         seg != NULL;
-         seg = strtok_r(NULL, "&", &save)) {
+/* --------------------- Ejecución remota --------------------- */
 
-        /* Copia editable para parsear redirección con cortes */
-        char *copy = strdup(seg);
-        if (!copy) { print_error(); free(line); return; }
+/* Envía el comando al agente menos cargado. Retorna -1 si hay que
+   ejecutarlo localmente (sin agentes disponibles). */
+static int start_remote(Cmd *cmd, Node *n, Sched *s) {
+    char cwd[4096];
+    if (s->pl->count == 0 || jobs_reserve() < 0 || !wish_getcwd(cwd, sizeof(cwd))) return -1;
 
-        Cmd cmd;
-        int r = parse_command(copy, &cmd);
-        if (r < 0) {
+    int fd = -1;
+    if (cmd->has_redir) {
+        fd = openat(wish_dirfd, cmd->redir_file, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        if (fd < 0) {
             print_error();
-            free(copy);
-            continue;
+            node_finish(n, 1, s);
+            return 0;
         }
-        if (r == 0) {
-            /* suborden vacía: ignorar */
-            free(copy);
-            continue;
+    }
+    uint32_t rid;
+    if (remote_dispatch(cmd->argv, fd, cwd, s->pl->dirs, s->pl->count, s->env->vec, &rid) < 0) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    Job job = { -1, n, s, NULL, NULL, rid, NULL, 0, NULL, 0, 0, 0 };
+    jobs_add(&job);
+    return 0;
+}
+
+/* --------------------- map --------------------- */
+
+/* "map [-j N] [-i lista] [-k] comando args... [> destino]": ejecuta el
+   comando una vez por línea de la lista (o de stdin), sustituyendo "{}"
+   por la línea en las palabras y en el destino; si ninguna palabra lleva
+   "{}" la línea va como último argumento. La entrada ('<' o '<<<') también
+   admite "{}". Las líneas se leen a medida que
+   quedan huecos: como mucho N hijos a la vez (por defecto uno por CPU) y
+   cada hijo que termina deja sitio al siguiente.
+
+   Salida: sin -k cada hijo escribe directamente (las salidas pueden
+   mezclarse); con -k la salida de cada elemento se guarda en un memfd y
+   se entrega completa y en el orden de la lista. Un destino sin "{}" se
+   abre una sola vez y recibe la salida de todos; con "{}" cada elemento
+   escribe el suyo.
+
+   Un elemento que falla no detiene los demás: se informa por stderr como
+   "map: elemento: código" y map termina con 1. Los elementos siempre se
+   ejecutan localmente, también con --workers. */
+
+#define MAP_WINDOW 4            /* -k: elementos en vuelo por hijo */
+
+typedef struct {
+    char *item;                 /* NULL: hueco libre */
+    int   out;                  /* -k: memfd con la salida, o -1 */
+    int   done, code;
+    int   batch;                /* xbatch: número de lote */
+} MapItem;
+
+struct Map {
+    const char *name;           /* "map" o "xbatch", para los avisos */
+    const SimpleCmd *tpl;       /* palabras del nodo tal como se analizaron */
+    int        first;           /* primera palabra del comando */
+    char      *has;             /* has[i]: la palabra i contiene "{}" */
+    int        append;          /* ninguna palabra lleva "{}" */
+    int        per_item;        /* el destino lleva "{}" */
+    int        shared;          /* destino común o -1 */
+    LineReader *in;             /* &own (lista -i) o &io_stdin */
+    LineReader own;
+    int        eof;
+    int        max, running;
+    int        ordered;
+    MapItem   *win;             /* -k: ventana circular; si no, huecos sueltos */
+    uint32_t   cap, head, tail; /* -k: head es el siguiente a entregar */
+    int        failed;
+    char      *line;
+    size_t     line_cap;
+    Node      *node;
+    Sched     *sched;
+    Cmd       *xcmd;            /* xbatch: comando ya expandido */
+    int        xfixed;          /* xbatch: argumentos que van en cada lote */
+    int       *xstart;          /* xbatch: lote b = argv[xstart[b]..xstart[b+1]) */
+    int        nbatch, nextb;
+};
+
+/* Copia de w con cada "{}" sustituido por item */
+static char *map_subst(const char *w, const char *item) {
+    size_t n = 0, il = strlen(item);
+    for (const char *p = strstr(w, "{}"); p; p = strstr(p + 2, "{}")) n++;
+    char *out = malloc(strlen(w) + n * il + 1);
+    if (!out) return NULL;
+    char *o = out;
+    for (const char *p; (p = strstr(w, "{}")) != NULL; w = p + 2) {
+        memcpy(o, w, (size_t)(p - w));
+        o += p - w;
+        memcpy(o, item, il);
+        o += il;
+    }
+    strcpy(o, w);
+    return out;
+}
+
+static void map_report(Map *m, const MapItem *it) {
+    if (it->code == 0) return;
+    dprintf(STDERR_FILENO, "%s: %s: %d\n", m->name, it->item, it->code);
+    m->failed = 1;
+}
+
+/* Vuelca la salida capturada de un elemento en su destino */
+static void map_emit(Map *m, int fd) {
+    int dst = m->shared >= 0 ? m->shared : STDOUT_FILENO;
+    off_t off = 0;
+    char buf[65536];
+    ssize_t r;
+    while ((r = pread(fd, buf, sizeof(buf), off)) > 0) {
+        for (ssize_t w = 0; w < r; ) {
+            ssize_t k = write(dst, buf + w, (size_t)(r - w));
+            if (k < 0) {
+                if (errno == EINTR) continue;
+                return;
+            }
+            w += k;
         }
+        off += r;
+    }
+}
 
-        /* Built-ins (no redirección para built-ins) */
-        if (is_builtin(cmd.argv[0])) {
-            if (cmd.has_redir) {
-                print_error();
-                free(copy);
-                if (cmd.redir_file) free(cmd.redir_file);
-                continue;
+/* Lanza cmd para el elemento it con la salida que le corresponde */
+static pid_t map_spawn(Map *m, MapItem *it, Cmd *cmd, uint64_t *t0) {
+    if (m->ordered && !m->per_item &&
+        (it->out = memfd_create("wish-map", MFD_CLOEXEC)) < 0) {
+        print_error();
+        return -1;
+    }
+    ff_prepare(m->sched);
+    *t0 = stats_now();
+    pid_t pid = launch_external(cmd, m->sched->pl, m->sched->env, NULL,
+                                it->out >= 0 ? it->out : m->shared);
+    if (pid > 0) live_job_start(pid, cmd->argv[0]);
+    return pid;
+}
+
+/* map: arma el comando del elemento sustituyendo "{}" y lo lanza */
+static pid_t map_spawn_item(Map *m, MapItem *it, uint64_t *t0) {
+    int nw = m->tpl->nwords - m->first;
+    char **words = calloc((size_t)nw + 2, sizeof(char *));
+    if (!words) return -1;
+    for (int i = 0; i < nw; i++) {
+        const char *w = m->tpl->words[m->first + i];
+        words[i] = m->has[i] ? map_subst(w, it->item) : (char *)w;
+    }
+    if (m->append) words[nw] = it->item;
+    SimpleCmd sc = { words, nw + m->append, NULL, m->tpl->in, m->tpl->here, NULL, 0 };
+    if (m->per_item) sc.redir = map_subst(m->tpl->redir, it->item);
+    int in_subst = m->tpl->in && strstr(m->tpl->in, "{}");
+    if (in_subst) sc.in = map_subst(m->tpl->in, it->item);
+
+    /* cmd apunta a las palabras: se liberan después de lanzar */
+    Cmd cmd;
+    int ok = cmd_build(&sc, &cmd) == 0 && !is_builtin(cmd.argv[0]) &&
+             strcmp(cmd.argv[0], "map") != 0 && strcmp(cmd.argv[0], "xbatch") != 0;
+    pid_t pid = -1;
+    if (!ok) {
+        print_error();
+    } else {
+        pid = map_spawn(m, it, &cmd, t0);
+    }
+    cmd_free(&cmd);
+    for (int i = 0; i < nw; i++) {
+        if (m->has[i]) free(words[i]);
+    }
+    free(words);
+    free(sc.redir);
+    if (in_subst) free(sc.in);
+    return pid;
+}
+
+/* xbatch: el comando con los argumentos fijos y los del lote */
+static pid_t xbatch_spawn(Map *m, MapItem *it, uint64_t *t0) {
+    int from = m->xstart[it->batch], to = m->xstart[it->batch + 1];
+    Cmd cmd = *m->xcmd;
+    cmd.argc = m->xfixed + (to - from);
+    cmd.argv = malloc(((size_t)cmd.argc + 1) * sizeof(char *));
+    if (!cmd.argv) {
+        print_error();
+        return -1;
+    }
+    memcpy(cmd.argv, m->xcmd->argv, (size_t)m->xfixed * sizeof(char *));
+    memcpy(cmd.argv + m->xfixed, m->xcmd->argv + from, (size_t)(to - from) * sizeof(char *));
+    cmd.argv[cmd.argc] = NULL;
+    pid_t pid = map_spawn(m, it, &cmd, t0);
+    free(cmd.argv);
+    return pid;
+}
+
+/* Lanza el elemento del hueco slot. Retorna -1 si no llegó a arrancar. */
+static int map_launch(Map *m, uint32_t slot) {
+    MapItem *it = &m->win[slot];
+    uint64_t t0 = 0;
+    pid_t pid = m->xcmd ? xbatch_spawn(m, it, &t0) : map_spawn_item(m, it, &t0);
+    Job job = { pid, m->node, m->sched, NULL, NULL, 0, m, slot, NULL, 0, 0, t0 };
+    ff_launched(m->sched, &job, pid);
+    if (pid <= 0) return -1;
+
+    if (jobs_add(&job) < 0) {
+        int st = 0;
+        waitpid(pid, &st, 0);
+        ff_reaped(&job);
+        live_job_end(pid);
+        it->code = exit_code(st);
+        return 0;
+    }
+    m->running++;
+    return 1;
+}
+
+static void map_end(Map *m) {
+    Node *n = m->node;
+    Sched *s = m->sched;
+    int st = m->failed;
+    if (m->in == &m->own) {
+        close(m->own.fd);
+        lr_free(&m->own);
+    }
+    if (m->shared >= 0) close(m->shared);
+    free(m->win);
+    free(m->has);
+    free(m->line);
+    if (m->xcmd) {
+        cmd_free(m->xcmd);
+        free(m->xcmd);
+    }
+    free(m->xstart);
+    free(m);
+    node_finish(n, st, s);
+}
+
+/* Marca terminado el elemento del hueco slot y, con -k, entrega en orden
+   todo lo que ya está listo */
+static void map_finish_item(Map *m, uint32_t slot, int code) {
+    MapItem *it = &m->win[slot];
+    it->done = 1;
+    it->code = code;
+    if (!m->ordered) {
+        map_report(m, it);
+        free(it->item);
+        it->item = NULL;
+        return;
+    }
+    while (m->head != m->tail && m->win[m->head % m->cap].done) {
+        it = &m->win[m->head % m->cap];
+        if (it->out >= 0) {
+            map_emit(m, it->out);
+            close(it->out);
+        }
+        map_report(m, it);
+        free(it->item);
+        it->item = NULL;
+        m->head++;
+    }
+}
+
+/* Lee y lanza elementos mientras haya huecos; al agotar la lista y sin
+   nada en vuelo termina el nodo */
+static void map_fill(Map *m) {
+    /* fail-fast canceló el script: no se lanza nada más */
+    if (m->sched->cancelled) {
+        m->eof = 1;
+        m->failed = 1;
+    }
+    while (!m->eof && m->running < m->max &&
+           (!m->ordered || m->tail - m->head < m->cap)) {
+        char *item = NULL;
+        int batch = 0;
+        if (m->xcmd) {
+            if (m->nextb == m->nbatch) {
+                m->eof = 1;
+                break;
+            }
+            batch = m->nextb++;
+            if (asprintf(&item, "lote %d/%d", batch + 1, m->nbatch) < 0) item = NULL;
+        } else {
+            ssize_t n = lr_getline(m->in, &m->line, &m->line_cap);
+            if (n < 0) {
+                m->eof = 1;
+                break;
             }
+            while (n > 0 && (m->line[n - 1] == '\n' || m->line[n - 1] == '\r')) m->line[--n] = '\0';
+            if (n == 0) continue;
+            item = strdup(m->line);
+        }
+
+        uint32_t slot = 0;
+        if (m->ordered) {
+            slot = m->tail++ % m->cap;
+        } else {
+            while (m->win[slot].item) slot++;
+        }
+        MapItem *it = &m->win[slot];
+        *it = (MapItem){ item, -1, 0, 0, batch };
+        if (!it->item) it->item = strdup("?");
+        int r = map_launch(m, slot);
+        if (r <= 0) map_finish_item(m, slot, r < 0 ? 1 : it->code);
+    }
+    if (m->eof && m->running == 0 && m->head == m->tail) map_end(m);
+}
+
+static void map_item_done(Map *m, uint32_t slot, int code) {
+    m->running--;
+    map_finish_item(m, slot, code);
+    map_fill(m);
+}
+
+static void map_start(Node *n, Sched *s) {
+    const SimpleCmd *sc = &n->sc;
+    Map *m = calloc(1, sizeof(*m));
+    if (!m) {
+        print_error();
+        node_finish(n, 1, s);
+        return;
+    }
+    m->name = "map";
+    m->tpl = sc;
+    m->shared = -1;
+    m->node = n;
+    m->sched = s;
+    long max = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *list = NULL;
+
+    int i = 1, bad = 0;
+    while (i < sc->nwords && !bad) {
+        const char *o = sc->words[i];
+        if (!strcmp(o, "-k")) {
+            m->ordered = 1;
+            i++;
+        } else if ((!strcmp(o, "-j") || !strcmp(o, "-i")) && i + 1 < sc->nwords) {
+            if (o[1] == 'i') {
+                list = sc->words[i + 1];
+            } else {
+                char *end;
+                max = strtol(sc->words[i + 1], &end, 10);
+                bad = *end || max < 1 || max > 65536;
+            }
+            i += 2;
+        } else {
+            break;
+        }
+    }
+    m->first = i;
+    m->max = max > 0 ? (int)max : 1;
+    m->cap = m->ordered ? (uint32_t)m->max * MAP_WINDOW : (uint32_t)m->max;
+    m->has = calloc((size_t)sc->nwords, 1);
+    m->win = calloc(m->cap, sizeof(MapItem));
+    if (bad || i >= sc->nwords || sc->ntee || !m->has || !m->win) {
+        print_error();
+        m->failed = 1;
+        map_end(m);
+        return;
+    }
+
+    m->append = 1;
+    for (int k = m->first; k < sc->nwords; k++) {
+        m->has[k - m->first] = strstr(sc->words[k], "{}") != NULL;
+        if (m->has[k - m->first]) m->append = 0;
+    }
+    if (sc->redir) {
+        m->per_item = strstr(sc->redir, "{}") != NULL;
+        if (m->per_item) m->append = 0;
+    }
+    if (sc->in && strstr(sc->in, "{}")) m->append = 0;
+
+    m->in = &io_stdin;
+    if (list) {
+        int fd = openat(wish_dirfd, list, O_RDONLY | O_CLOEXEC);
+        m->in = fd >= 0 ? &m->own : NULL;
+        lr_init(&m->own, fd);
+    }
+    /* O_APPEND: sin -k los hijos escriben a la vez y no deben pisarse */
+    if (sc->redir && !m->per_item) {
+        m->shared = openat(wish_dirfd, sc->redir,
+                           O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0666);
+    }
+    if (!m->in || (sc->redir && !m->per_item && m->shared < 0)) {
+        print_error();
+        m->failed = 1;
+        m->eof = 1;
+    }
+    map_fill(m);
+}
+
+/* --------------------- xbatch --------------------- */
+
+/* "xbatch [-j N] [-f K] comando args... [> destino]": como el comando tal
+   cual, pero si sus argumentos (típicamente una lista generada o un
+   comodín con miles de resultados) no caben en un execve, que fallaría
+   con E2BIG, los reparte en los menos lotes posibles. Cada lote lleva el
+   comando y sus argumentos fijos: las opciones que empiezan por '-' justo
+   detrás del nombre o, con -f K, las K primeras palabras. El resto es la
+   lista que se trocea, sin reordenar.
+
+   Los lotes van de uno en uno por defecto; con -j N hasta N a la vez,
+   dentro de los huecos de trabajos del shell. En los dos casos la salida
+   de todos llega al destino (o a stdout) completa y en el orden de los
+   lotes: en paralelo cada lote escribe en su memfd y se entrega como con
+   "map -k". Un lote que falla se informa como "xbatch: lote i/n: código"
+   y xbatch termina con 1.
+
+   Reutiliza la maquinaria de map: cada lote es un elemento. */
+
+#define XBATCH_HEADROOM 4096        /* ruta del ejecutable y margen del kernel */
+#define XBATCH_STACK_CAP 6291456L   /* el kernel nunca admite más de 3/4 de 8 MB */
+
+/* Espacio que ocupa s en la pila del nuevo proceso */
+static long xbatch_size(const char *s) {
+    return (long)(strlen(s) + 1 + sizeof(char *));
+}
+
+/* Reparte argv[xfixed..argc) en lotes. Retorna 0, o -1 si algún
+   argumento no cabe ni solo. */
+static int xbatch_split(Map *m) {
+    Cmd *c = m->xcmd;
+    /* sysconf ya deriva el límite de RLIMIT_STACK (un cuarto de la pila) */
+    long limit = sysconf(_SC_ARG_MAX);
+    if (limit <= 0 || limit > XBATCH_STACK_CAP) limit = limit <= 0 ? 131072 : XBATCH_STACK_CAP;
+    limit -= XBATCH_HEADROOM + 2 * (long)sizeof(char *);
+    for (int i = 0; i < m->sched->env->count; i++) limit -= xbatch_size(m->sched->env->vec[i]);
+    for (int i = 0; i < c->nassign; i++) limit -= xbatch_size(c->assign[i]);
+    for (int i = 0; i < m->xfixed; i++) limit -= xbatch_size(c->argv[i]);
+    long strmax = 32 * sysconf(_SC_PAGESIZE);    /* MAX_ARG_STRLEN */
+
+    m->xstart = malloc(((size_t)(c->argc - m->xfixed) + 2) * sizeof(int));
+    if (!m->xstart || limit <= 0) return -1;
+    m->xstart[0] = m->xfixed;
+    m->nbatch = 0;
+    long used = 0;
+    for (int i = m->xfixed; i < c->argc; i++) {
+        long sz = xbatch_size(c->argv[i]);
+        if ((long)strlen(c->argv[i]) + 1 > strmax || sz > limit) return -1;
+        if (used + sz > limit) {
+            m->xstart[++m->nbatch] = i;
+            used = 0;
+        }
+        used += sz;
+    }
+    /* Sin lista queda un único lote con los argumentos fijos */
+    m->xstart[++m->nbatch] = c->argc;
+    return 0;
+}
+
+static void xbatch_start(Node *n, Sched *s) {
+    const SimpleCmd *sc = &n->sc;
+    Map *m = calloc(1, sizeof(*m));
+    if (!m) {
+        print_error();
+        node_finish(n, 1, s);
+        return;
+    }
+    m->name = "xbatch";
+    m->tpl = sc;
+    m->shared = -1;
+    m->node = n;
+    m->sched = s;
+    m->eof = 1;
+    long max = 1, fixed = -1;
+
+    int i = 1, bad = 0;
+    while (i < sc->nwords && !bad &&
+           (!strcmp(sc->words[i], "-j") || !strcmp(sc->words[i], "-f")) && i + 1 < sc->nwords) {
+        char *end;
+        long v = strtol(sc->words[i + 1], &end, 10);
+        if (sc->words[i][1] == 'j') {
+            max = v;
+            bad = *end || max < 1 || max > 65536;
+        } else {
+            fixed = v;
+            bad = *end || fixed < 0;
+        }
+        i += 2;
+    }
+    m->first = i;
+    m->max = (int)max;
+    m->ordered = m->max > 1;
+    m->cap = m->ordered ? (uint32_t)m->max * MAP_WINDOW : 1;
+    m->win = calloc(m->cap, sizeof(MapItem));
+    m->xcmd = calloc(1, sizeof(Cmd));
+    if (bad || i >= sc->nwords || sc->ntee || !m->win || !m->xcmd) {
+        print_error();
+        m->failed = 1;
+        map_end(m);
+        return;
+    }
+
+    /* El comando se expande una sola vez; el destino lo abre xbatch */
+    SimpleCmd cs = { sc->words + i, sc->nwords - i, NULL, sc->in, sc->here, NULL, 0 };
+    Cmd *c = m->xcmd;
+    int ok = cmd_build(&cs, c) == 0 && c->argc > 0 && !is_builtin(c->argv[0]) &&
+             strcmp(c->argv[0], "map") != 0 && strcmp(c->argv[0], "xbatch") != 0;
+    if (ok) {
+        if (fixed < 0) {
+            for (fixed = 1; fixed < c->argc && c->argv[fixed][0] == '-'; fixed++) {}
+        } else {
+            fixed++;
+        }
+        ok = fixed <= c->argc;
+    }
+    if (ok) {
+        m->xfixed = (int)fixed;
+        ok = xbatch_split(m) == 0;
+    }
+    if (ok && sc->redir) {
+        m->shared = openat(wish_dirfd, sc->redir,
+                           O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0666);
+        ok = m->shared >= 0;
+    }
+    if (!ok) {
+        print_error();
+        m->failed = 1;
+    } else {
+        m->eof = 0;
+    }
+    map_fill(m);
+}
+
+/* --------------------- Grafo de la línea --------------------- */
+
+/* Marca n como terminado y avanza a los nodos que dependían de él */
+static void node_finish(Node *n, int status, Sched *s) {
+    n->done = 1;
+    n->status = status;
+    Node *p = n->parent;
+    if (!p) return;
+
+    if (p->type == NODE_ANDOR) {
+        /* Cortocircuito: salta las etapas cuyo operador no se cumple */
+        int i = p->cur + 1;
+        while (i < p->nkids && (p->ops[i] == OP_AND) != (status == 0)) i++;
+        if (i < p->nkids) {
+            p->cur = i;
+            node_start(p->kids[i], s);
+        } else {
+            node_finish(p, status, s);
+        }
+        return;
+    }
+
+    /* NODE_LIST: arrancan los elementos que esperaban a este */
+    p->remaining--;
+    for (int j = 0; j < p->nkids; j++) {
+        if (p->dep[j] == n->index && !p->kids[j]->started) node_start(p->kids[j], s);
+    }
+    if (p->remaining == 0) node_finish(p, p->kids[p->nkids - 1]->status, s);
+}
+
+/* Ejecuta un comando simple: built-in en el propio shell o hijo externo */
+static void start_command(Node *n, Sched *s) {
+    /* map usa las palabras sin expandir como plantilla de cada elemento */
+    if (!strcmp(n->sc.words[0], "map")) {
+        map_start(n, s);
+        return;
+    }
+    if (!strcmp(n->sc.words[0], "xbatch")) {
+        xbatch_start(n, s);
+        return;
+    }
+
+    Cmd cmd;
+    if (cmd_build(&n->sc, &cmd) < 0) {
+        print_error();
+        cmd_free(&cmd);
+        node_finish(n, 1, s);
+        return;
+    }
+
+    /* Built-ins (no redirección para built-ins) */
+    if (is_builtin(cmd.argv[0])) {
+        int st = 1;
+        stats_count(SC_BUILTINS);
+        if (cmd.has_redir || cmd.ntee || cmd.in_file || cmd.here || cmd.nassign) {
+            print_error();
+        } else if (!strcmp(cmd.argv[0], "exit")) {
+            st = builtin_exit(cmd.argv, s->isolated); /* no retorna si OK */
+            if (st == 0) s->stopped = 1;
+        } else if (!strcmp(cmd.argv[0], "cd")) {
+            st = builtin_cd(cmd.argv);
+            s->dirfd = wish_dirfd;
+            cwd_known = 0;
+        } else if (!strcmp(cmd.argv[0], "path")) {
+            st = builtin_path(cmd.argv, s->pl);
+        } else if (!strcmp(cmd.argv[0], "export")) {
+            st = builtin_export(cmd.argv, s->env);
+        } else if (!strcmp(cmd.argv[0], "unset")) {
+            st = builtin_unset(cmd.argv, s->env);
+        } else if (!strcmp(cmd.argv[0], "set")) {
+            st = builtin_set(cmd.argv, &s->failfast);
+        } else if (!strcmp(cmd.argv[0], "stats")) {
+            st = builtin_stats(cmd.argv);
+        }
+        cmd_free(&cmd);
+        node_finish(n, st, s);
+        return;
+    }
+
+    /* Prefijo "cached" */
+    CacheInputs inputs;
+    int cr = parse_cached_prefix(&cmd, &inputs);
+    if (cr < 0 || (cr == 1 && (is_builtin(cmd.argv[0]) || cmd.ntee))) {
+        print_error();
+        cmd_free(&cmd);
+        node_finish(n, 1, s);
+        return;
+    }
+    inputs.stdin_file = cmd.in_file;
+    inputs.stdin_text = cmd.here;
+    inputs.assign = cmd.assign;
+    inputs.nassign = cmd.nassign;
+    if (cr == 2) {
+        cache_print_stats(STDOUT_FILENO);
+        cmd_free(&cmd);
+        node_finish(n, 0, s);
+        return;
+    }
+
+    /* Con --workers los externos se ejecutan en un agente con el entorno
+       del script; el protocolo no lleva stdin, así que los que redirigen
+       su entrada, traen asignaciones propias (cambiarían el estado del
+       agente en cada comando) o reparten su salida corren aquí */
+    if (cr == 0 && remote_enabled() && !cmd.in_file && !cmd.here && !cmd.nassign && !cmd.ntee &&
+        start_remote(&cmd, n, s) == 0) {
+        cmd_free(&cmd);
+        return;
+    }
+
+    /* Externos */
+    Job job = { 0, n, s, NULL, NULL, 0, NULL, 0, NULL, 0, 0, 0 };
+    int hit_status = 0, fan_fd = -1;
+    if (cmd.ntee && !(job.fan = fanout_open(cmd.tee, cmd.ntee, &fan_fd))) {
+        print_error();
+        cmd_free(&cmd);
+        node_finish(n, 1, s);
+        return;
+    }
+    ff_prepare(s);
+    job.t0 = stats_now();
+    pid_t cpid = (cr == 1) ? launch_cached(&cmd, s->pl, s->env, &inputs, &job, &hit_status)
+                           : launch_external(&cmd, s->pl, s->env, NULL, fan_fd);
+    ff_launched(s, &job, cpid);
+    if (cpid > 0) live_job_start(cpid, cmd.argv[0]);
+    cmd_free(&cmd);
+    /* El hijo ya tiene su copia: el reparto termina cuando él la cierre */
+    if (fan_fd >= 0) close(fan_fd);
+
+    if (cpid > 0) {
+        job.pid = cpid;
+        if (jobs_add(&job) == 0) return;
+        /* Sin memoria para seguirlo: esperarlo aquí mismo */
+        int st = 0;
+        waitpid(cpid, &st, 0);
+        ff_reaped(&job);
+        live_job_end(cpid);
+        hit_status = exit_code(st);
+    } else if (cpid < 0) {
+        hit_status = 1;
+    } else {
+        hit_status = exit_code(hit_status);
+    }
+    if (job.fan && fanout_finish(job.fan) < 0 && hit_status == 0) {
+        print_error();
+        hit_status = 1;
+    }
+    node_finish(n, hit_status, s);
+}
+
+static int pending_push(Node *n, Sched *s) {
+    if (npending == cap_pending) {
+        int ncap = cap_pending ? cap_pending * 2 : 16;
+        Pending *np = realloc(pending, (size_t)ncap * sizeof(Pending));
+        if (!np) return -1;
+        pending = np;
+        cap_pending = ncap;
+    }
+    pending[npending++] = (Pending){ n, s };
+    return 0;
+}
+
+/* Arranca los comandos en espera mientras haya huecos, en orden de llegada */
+static void pending_run(void) {
+    while (npending > 0 && slots_used < slot_limit) {
+        Pending p = pending[0];
+        memmove(pending, pending + 1, (size_t)(--npending) * sizeof(Pending));
+        wish_dirfd = p.sched->dirfd;
+        if (p.sched->stopped || p.sched->cancelled) node_finish(p.node, p.sched->cancelled, p.sched);
+        else if (p.node->type == NODE_LIST) subshell_start(p.node, p.sched);
+        else start_command(p.node, p.sched);
+    }
+}
+
+static void node_start(Node *n, Sched *s) {
+    n->started = 1;
+    if (s->stopped || s->cancelled) {
+        /* Tras exit en --multi, o tras una cancelación de fail-fast, el
+           resto de la línea no se ejecuta */
+        node_finish(n, s->cancelled, s);
+        return;
+    }
+    switch (n->type) {
+    case NODE_CMD:
+        /* Sin hueco libre, o con otros esperando para no adelantarlos */
+        if (slot_limit && (npending > 0 || slots_used >= slot_limit) &&
+            pending_push(n, s) == 0) break;
+        start_command(n, s);
+        break;
+    case NODE_ERROR:
+        print_error();
+        node_finish(n, 1, s);
+        break;
+    case NODE_ANDOR:
+        n->cur = 0;
+        node_start(n->kids[0], s);
+        break;
+    case NODE_LIST:
+        if (n->group) {
+            /* Un subshell ocupa un hueco como cualquier hijo */
+            if (slot_limit && (npending > 0 || slots_used >= slot_limit) &&
+                pending_push(n, s) == 0) break;
+            subshell_start(n, s);
+            break;
+        }
+        n->remaining = n->nkids;
+        if (n->nkids == 0) {
+            node_finish(n, 0, s);
+            break;
+        }
+        /* Máximo paralelismo: todo lo que no depende de nadie arranca ya */
+        for (int i = 0; i < n->nkids; i++) {
+            if (n->dep[i] < 0 && !n->kids[i]->started) node_start(n->kids[i], s);
+        }
+        break;
+    }
+}
+
+/* Saca el trabajo k de la tabla y avanza el grafo de su script */
+static void job_finish(int k, int status, int code) {
+    Job job = jobs[k];
+    jobs[k] = jobs[--njobs];
+    if (job.pid > 0) {
+        slots_used--;
+        live_job_end(job.pid);
+    } else {
+        nremote--;
+    }
+
+    wish_dirfd = job.sched->dirfd;
+    if (job.cj) {
+        if (cache_commit(job.cj, status, job.redir_file) < 0) print_error();
+        free(job.cj);
+        free(job.redir_file);
+    }
+    if (job.fan && fanout_finish(job.fan) < 0 && code == 0) {
+        print_error();
+        code = 1;
+    }
+    ff_reaped(&job);
+    if (job.termed && WIFSIGNALED(status)) job.sched->ff_killed++;
+    if (job.failfast && code != 0 && !job.map && !job.sched->cancelled &&
+        !in_condition(job.node)) {
+        ff_cancel(&job, code);
+    }
+    if (job.map) map_item_done(job.map, job.slot, code);
+    else node_finish(job.node, code, job.sched);
+    pending_run();
+}
+
+/* Espera a que termine un trabajo (local o remoto) y lo procesa.
+   Retorna -1 si no queda nada que esperar. */
+static int reap_one(void) {
+    int status = 0;
+    pid_t pid;
+    uint64_t t0 = stats_now();
+    if (nremote > 0) {
+        /* Trabajos remotos: se atienden los sockets y, si también hay
+           hijos locales, se comprueban cada pocos milisegundos */
+        int local = njobs - nremote;
+        uint32_t rid;
+        int code;
+        if (remote_wait(local ? 5 : -1, &rid, &code) == 1) {
+            stats_record(ST_WAIT, stats_now() - t0);
+            int k = 0;
+            while (k < njobs && (jobs[k].pid != -1 || jobs[k].rid != rid)) k++;
+            if (k < njobs) job_finish(k, 0, code);
+            return 0;
+        }
+        if (local == 0) return 0;
+        pid = waitpid(-1, &status, WNOHANG);
+        if (pid == 0) return 0;
+    } else {
+        pid = waitpid(-1, &status, 0);
+    }
+    if (pid < 0) return errno == EINTR ? 0 : -1;
+    uint64_t now = stats_now();
+    stats_record(ST_WAIT, now - t0);
+
+    int k = 0;
+    while (k < njobs && jobs[k].pid != pid) k++;
+    if (k < njobs) {
+        WISH_PROBE3(reap, pid, status, now - jobs[k].t0);
+        job_finish(k, status, exit_code(status));
+    }
+    return 0;
+}
+
+/* --------------------- Subshell ( ... ) --------------------- */
+
+/* Una lista entre paréntesis corre en una copia del shell hecha con fork y
+   sin exec: cd, path, export, unset y set dentro del grupo cambian solo la
+   copia, así que "( cd a; make ) & ( cd b; make )" es seguro en paralelo.
+   Para el padre el grupo es un hijo más: ocupa un hueco, cuenta para
+   fail-fast y su código es el de la lista.
+
+   La copia empieza con la tabla de trabajos vacía (los hijos del padre no
+   son suyos), no publica en el segmento de wishtop ni usa los agentes
+   remotos, y exit solo termina el grupo. Sus hijos quedan en su grupo de
+   procesos, que es el del script del padre con fail-fast: una cancelación
+   del padre los alcanza a todos; una dentro del grupo avisa solo a sus
+   hijos directos y el padre hace el resto al ver que el grupo falló. */
+
+/* Lado del hijo: ejecuta la lista y termina con su código */
+static void subshell_run(Node *n, Sched *s) {
+    if (launch_pgid >= 0) setpgid(0, launch_pgid);
+    launch_pgid = -1;
+    live_detach();
+    remote_close();
+    njobs = nremote = slots_used = npending = 0;
+    pgroups = 0;
+    s->pgid = 0;
+    s->live = 0;
+    s->isolated = 1;
+
+    n->parent = NULL;
+    n->group = 0;
+    node_start(n, s);
+    while (!n->done && reap_one() == 0) {}
+    _exit((s->cancelled ? s->ff_code : n->status) & 0xff);
+}
+
+static void subshell_start(Node *n, Sched *s) {
+    ff_prepare(s);
+    uint64_t t0 = stats_now();
+    pid_t pid = fork();
+    if (pid == 0) subshell_run(n, s);
+    if (pid > 0) {
+        stats_count(SC_FORKS);
+        if (launch_pgid >= 0) setpgid(pid, launch_pgid ? launch_pgid : pid);
+        live_job_start(pid, "( ... )");
+    }
+    Job job = { pid, n, s, NULL, NULL, 0, NULL, 0, NULL, 0, 0, t0 };
+    ff_launched(s, &job, pid);
+    if (pid < 0) {
+        print_error();
+        node_finish(n, 1, s);
+        return;
+    }
+    if (jobs_add(&job) < 0) {
+        int st = 0;
+        waitpid(pid, &st, 0);
+        ff_reaped(&job);
+        live_job_end(pid);
+        node_finish(n, exit_code(st), s);
+    }
+}
+
+/* --------------------- Procesar línea completa --------------------- */
+
+/* Arranca el árbol de una línea (NULL = error de estructura). Retorna 0 si
+   quedó en marcha o -1 si ya falló. */
+static int line_start(Node *root, Sched *s) {
+    /* Los listados de directorio de la línea anterior deben revalidarse */
+    glob_new_line();
+
+    if (!root) {
+        print_error();
+        return -1;
+    }
+    wish_dirfd = s->dirfd;
+    node_start(root, s);
+    return 0;
+}
+
+/* Ejecuta la línea completa y retorna su código de salida. El árbol lo
+   libera quien lo creó. */
+static int run_tree(Node *root, Sched *s) {
+    uint64_t t0 = stats_now();
+    if (line_start(root, s) < 0) return 1;
+    /* Cada hijo que termina puede liberar nuevos nodos del grafo */
+    while (!root->done && reap_one() == 0) {}
+    stats_record(ST_LINE, stats_now() - t0);
+    return root->status;
+}
+
+/* Análisis de una línea, medido */
+static Node *parse_timed(const char *raw_line) {
+    WISH_PROBE1(parse__start, raw_line);
+    uint64_t t0 = stats_now();
+    Node *root = parse_line(raw_line);
+    uint64_t ns = stats_now() - t0;
+    WISH_PROBE2(parse__end, root, ns);
+    stats_record(ST_PARSE, ns);
+    return root;
+}
+
+static int  recording;           /* --record */
+static void record_done(const char *raw_line, const Node *root, int rc, uint64_t t0,
+                        const Sched *s);
+
+static int process_line(const char *raw_line, Sched *s) {
+    /* --record guarda el cwd en el que empezó la línea: cwd_cache no se
+       recalcula hasta que alguien lo pida después de la línea */
+    if (recording && !cwd_known && !wish_getcwd(cwd_cache, sizeof(cwd_cache))) cwd_cache[0] = '\0';
+    if (recording) cwd_known = 1;
+    uint64_t t0 = stats_now();
+    Node *root = parse_timed(raw_line);
+    int rc = run_tree(root, s);
+    if (recording) record_done(raw_line, root, rc, t0, s);
+    node_free(root);
+    return rc;
+}
+
+/* --------------------- Diario (--journal) --------------------- */
 
-            if (!strcmp(cmd.argv[0], "exit")) {
-                builtin_exit(cmd.argv); /* no retorna si OK */
-            } else if (!strcmp(cmd.argv[0], "cd")) {
-                builtin_cd(cmd.argv);
-            } else if (!strcmp(cmd.argv[0], "path")) {
-                builtin_path(cmd.argv, pl);
+static int journaling;
+
+/* Abre el diario y, al reanudar, restaura path, cd, entorno y set -e de la
+   última línea registrada. Retorna el número de líneas a saltar. */
+static uint32_t journal_start(const char *file, const char *script, int resume, Sched *s) {
+    JournalState st;
+    if (journal_open(file, script, resume, &st) != 0) {
+        print_error();
+        exit(1);
+    }
+    journaling = 1;
+    uint32_t skip = st.line;
+    if (skip > 0) {
+        char **argv = calloc((size_t)st.ndirs + 2, sizeof(char *));
+        if (!argv) {
+            print_error();
+            exit(1);
+        }
+        argv[0] = "path";
+        for (int i = 0; i < st.ndirs; i++) argv[i + 1] = st.dirs[i];
+        path_set(s->pl, argv);
+        free(argv);
+        if (chdir(st.cwd) != 0) {
+            print_error();
+            exit(1);
+        }
+        if (st.has_env) {
+            env_free(s->env);
+            if (env_init(s->env, st.env) != 0) {
+                print_error();
+                exit(1);
             }
+            s->failfast = st.failfast;
+        }
+    }
+    journal_state_free(&st);
+    return skip;
+}
+
+static void journal_record(uint32_t line, int status, Sched *s) {
+    if (!journaling) return;
+    if (!cwd_known && !wish_getcwd(cwd_cache, sizeof(cwd_cache))) cwd_cache[0] = '\0';
+    cwd_known = 1;
+    journal_line_done(line, status, cwd_cache, s->pl->dirs, s->pl->count, s->env->vec, s->failfast);
+}
 
-            free(copy);
-            if (cmd.redir_file) free(cmd.redir_file);
+/* Ejecuta un script precompilado sin volver a tokenizar. Las líneas se
+   numeran como en el fuente (srclines), igual que en el modo texto: skip
+   es la última línea ya terminada. */
+static void run_bytecode(const Wbc *w, Sched *s, uint32_t skip) {
+    for (uint32_t i = 0; i < w->hdr->nlines; i++) {
+        uint32_t lineno = w->srclines[i];
+        if (lineno <= skip) continue;
+        live_line(lineno);
+        WISH_PROBE1(parse__start, NULL);
+        uint64_t t0 = stats_now();
+        Node *root = wbc_line(w, i);
+        uint64_t ns = stats_now() - t0;
+        WISH_PROBE2(parse__end, root, ns);
+        stats_record(ST_PARSE, ns);
+        int rc = run_tree(root, s);
+        wbc_node_free(root);
+        /* Una línea cancelada no se da por terminada: --resume la repite */
+        if (s->cancelled) break;
+        journal_record(lineno, rc, s);
+    }
+}
+
+/* --------------------- Captura y reproducción (--record / --replay) --------------------- */
+
+/* Códigos de los comandos simples de n en el orden de la línea (-1: no
+   llegó a correr). Retorna cuántos hay, hasta RECORD_MAX_SEG. */
+static int line_segments(const Node *n, int32_t *seg, int k) {
+    if (!n) return k;
+    if (n->type == NODE_CMD || n->type == NODE_ERROR) {
+        if (k < RECORD_MAX_SEG) seg[k++] = n->done ? n->status : -1;
+        return k;
+    }
+    for (int i = 0; i < n->nkids; i++) k = line_segments(n->kids[i], seg, k);
+    return k;
+}
+
+static void record_done(const char *raw_line, const Node *root, int rc, uint64_t t0,
+                        const Sched *s) {
+    int32_t seg[RECORD_MAX_SEG];
+    int nseg = line_segments(root, seg, 0);
+    record_line(raw_line, cwd_cache, s->pl->dirs, s->pl->count, t0, stats_now(), rc,
+                seg, nseg);
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Espera hasta el instante at (ns de CLOCK_MONOTONIC) */
+static void sleep_until(uint64_t at) {
+    struct timespec ts = { (time_t)(at / 1000000000ull), (long)(at % 1000000000ull) };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+}
+
+/* Reproduce el log: speed > 0 respeta los tiempos de llegada divididos por
+   speed; 0 va lo más rápido posible. Informa por stderr de cada línea y
+   del total. Retorna 0, o 1 si el log no sirve o algún código cambió. */
+static int run_replay(const char *file, double speed, Env *env) {
+    Replay *r = replay_open(file);
+    if (!r) {
+        print_error();
+        return 1;
+    }
+    PathList pl;
+    path_init(&pl);
+    Sched s;
+    sched_init(&s, &pl, env, AT_FDCWD, 1);
+
+    ReplayLine ln;
+    double *ratio = NULL, rec_ms = 0, now_ms = 0;
+    int n = 0, cap = 0, differ = 0, res;
+    uint64_t start = stats_now();
+    while (!s.stopped && (res = replay_next(r, &ln)) == 1) {
+        if (ln.dirs_changed) {
+            char **argv = calloc((size_t)ln.ndirs + 2, sizeof(char *));
+            if (!argv) break;
+            argv[0] = "path";
+            for (int i = 0; i < ln.ndirs; i++) argv[i + 1] = ln.dirs[i];
+            path_set(&pl, argv);
+            free(argv);
+        }
+        if (ln.cwd_changed) {
+            if (chdir(ln.cwd) != 0) print_error();
+            cwd_known = 0;
+        }
+        if (speed > 0) sleep_until(start + (uint64_t)((double)ln.hdr.start_ns / speed));
+
+        uint64_t t0 = stats_now();
+        Node *root = parse_timed(ln.text);
+        int rc = run_tree(root, &s);
+        double ms = (double)(stats_now() - t0) / 1e6, was = (double)ln.hdr.dur_ns / 1e6;
+        int32_t seg[RECORD_MAX_SEG];
+        int nseg = line_segments(root, seg, 0);
+        node_free(root);
+
+        int same = rc == ln.hdr.status && nseg == (int)ln.hdr.nseg &&
+                   memcmp(seg, ln.seg, (size_t)nseg * sizeof(int32_t)) == 0;
+        differ += !same;
+        if (n == cap) {
+            int ncap = cap ? cap * 2 : 64;
+            double *nr = realloc(ratio, (size_t)ncap * sizeof(double));
+            if (!nr) break;
+            ratio = nr;
+            cap = ncap;
+        }
+        ratio[n++] = was > 0 ? ms / was : 1.0;
+        rec_ms += was;
+        now_ms += ms;
+        dprintf(STDERR_FILENO, "replay %5d  grabada %10.3f ms  ahora %10.3f ms  %6.2fx%s  %.40s\n",
+                n, was, ms, ratio[n - 1], same ? "" : "  ≠ códigos", ln.text);
+    }
+    if (res < 0) print_error();
+
+    if (n > 0) {
+        qsort(ratio, (size_t)n, sizeof(double), cmp_double);
+        dprintf(STDERR_FILENO,
+                "replay: %d líneas, grabado %.3f ms, ahora %.3f ms (%.2fx); por línea "
+                "mediana %.2fx, p90 %.2fx; %d con códigos distintos\n",
+                n, rec_ms, now_ms, rec_ms > 0 ? now_ms / rec_ms : 1.0, ratio[n / 2],
+                ratio[(int)(n * 0.9)], differ);
+    }
+    free(ratio);
+    replay_close(r);
+    path_clear(&pl);
+    return (res < 0 || differ) ? 1 : 0;
+}
+
+/* --------------------- Varios scripts a la vez (--multi) --------------------- */
+
+typedef struct {
+    const char *name;
+    LineReader  in;             /* fd -1 si no se pudo abrir */
+    PathList    pl;
+    Env         env;
+    Sched       s;
+    Node       *root;       /* línea en curso */
+    uint64_t    t0;         /* su arranque (stats) */
+    int         status;     /* código de la última línea */
+    int         active;
+} Script;
+
+/* Arranca líneas del script hasta que una quede esperando hijos o se acabe */
+static void script_advance(Script *sc, char **line, size_t *cap) {
+    while (sc->active) {
+        if (sc->root) {
+            if (!sc->root->done) return;
+            stats_record(ST_LINE, stats_now() - sc->t0);
+            sc->status = sc->root->status;
+            node_free(sc->root);
+            sc->root = NULL;
+        }
+        if (sc->s.stopped || sc->s.cancelled) {
+            sc->status = sc->s.cancelled ? sc->s.ff_code : 0;
+            break;
+        }
+        ssize_t n = lr_getline(&sc->in, line, cap);
+        if (n == -1) break;
+        WISH_PROBE2(line__read, *line, n);
+        if (line_is_blank(*line, (size_t)n)) continue;
+
+        live_line(0);
+        Node *root = parse_timed(*line);
+        sc->t0 = stats_now();
+        if (line_start(root, &sc->s) < 0) {
+            sc->status = 1;
             continue;
         }
+        sc->root = root;
+    }
+    sc->active = 0;
+}
 
-        /* Externos */
-        pid_t cpid = launch_external(&cmd, pl);
-        if (cpid > 0 && pcount < (int)(sizeof(pids)/sizeof(pids[0]))) {
-            pids[pcount++] = cpid;
+/* Ejecuta los scripts con como mucho jobs hijos locales a la vez e informa
+   del código de cada uno por stderr. Retorna 0 si todos terminaron en 0. */
+static int run_multi(char **files, int nfiles, int jobs_max) {
+    Script *v = calloc((size_t)nfiles, sizeof(Script));
+    if (!v) {
+        print_error();
+        return 1;
+    }
+    slot_limit = jobs_max;
+
+    char *line = NULL;
+    size_t cap = 0;
+    for (int i = 0; i < nfiles; i++) {
+        Script *sc = &v[i];
+        sc->name = files[i];
+        sc->status = 1;
+        path_init(&sc->pl);
+        sched_init(&sc->s, &sc->pl, &sc->env, -1, 1);
+        lr_init(&sc->in, open(files[i], O_RDONLY | O_CLOEXEC));
+        sc->s.dirfd = open(".", O_PATH | O_DIRECTORY | O_CLOEXEC);
+        if (sc->in.fd < 0 || sc->s.dirfd < 0 || env_init(&sc->env, environ) != 0) {
+            print_error();
+            continue;
         }
-        free(copy);
-        if (cmd.redir_file) free(cmd.redir_file);
+        sc->status = 0;
+        sc->active = 1;
+        script_advance(sc, &line, &cap);
     }
 
-    /* Esperar a todos los hijos lanzados en esta línea */
-    for (int i = 0; i < pcount; i++) {
-        waitpid(pids[i], NULL, 0);
+    for (;;) {
+        int active = 0;
+        for (int i = 0; i < nfiles; i++) active += v[i].active;
+        if (!active || reap_one() < 0) break;
+        for (int i = 0; i < nfiles; i++) script_advance(&v[i], &line, &cap);
     }
 
+    int rc = 0;
+    for (int i = 0; i < nfiles; i++) {
+        Script *sc = &v[i];
+        if (sc->root) {
+            /* Sin hijos que esperar pero con la línea a medias */
+            node_free(sc->root);
+            sc->status = 1;
+        }
+        dprintf(STDERR_FILENO, "%s: %d\n", sc->name, sc->status);
+        ff_report(sc->name, &sc->s);
+        if (sc->status != 0) rc = 1;
+        if (sc->in.fd >= 0) close(sc->in.fd);
+        lr_free(&sc->in);
+        if (sc->s.dirfd >= 0) close(sc->s.dirfd);
+        path_clear(&sc->pl);
+        env_free(&sc->env);
+    }
+    wish_dirfd = AT_FDCWD;
     free(line);
+    free(v);
+    free(pending);
+    return rc;
 }
 
 /* --------------------- main --------------------- */
 
 int main(int argc, char *argv[]) {
+    stats_init();
+
+    /* Opciones globales antes del modo, en cualquier orden y una vez cada
+       una: --workers spec[,spec...], --token archivo, --fail-fast,
+       --record log, --journal archivo y --resume */
+    const char *worker_specs = NULL, *token_file = NULL;
+    const char *record_file = NULL, *journal_file = NULL;
+    int resume = 0;
+    int opt = 1;
+    while (opt < argc) {
+        const char **val = NULL;
+        int *flag = NULL;
+        if (!strcmp(argv[opt], "--workers")) val = &worker_specs;
+        else if (!strcmp(argv[opt], "--token")) val = &token_file;
+        else if (!strcmp(argv[opt], "--record")) val = &record_file;
+        else if (!strcmp(argv[opt], "--journal")) val = &journal_file;
+        else if (!strcmp(argv[opt], "--fail-fast")) flag = &fail_fast;  /* como "set -e" */
+        else if (!strcmp(argv[opt], "--resume")) flag = &resume;
+        else break;  /* el modo o el script */
+        if (flag) {
+            if (*flag) {
+                print_error();
+                exit(1);
+            }
+            *flag = 1;
+            opt++;
+            continue;
+        }
+        if (*val || opt + 1 >= argc) {
+            print_error();
+            exit(1);
+        }
+        *val = argv[opt + 1];
+        opt += 2;
+    }
+    argv[opt - 1] = argv[0];
+    argv += opt - 1;
+    argc -= opt - 1;
+
+    const char *mode = NULL;
+    if (argc >= 2 && (!strcmp(argv[1], "--multi") || !strcmp(argv[1], "--compile") ||
+                      !strcmp(argv[1], "--replay") || !strcmp(argv[1], "-c"))) {
+        mode = argv[1];
+    }
+
+    /* Combinaciones incompatibles:
+       --token y --resume solo acompañan a --workers y --journal;
+       --record graba una secuencia de líneas de texto: un script o -c, no
+       --multi, --replay ni --compile (los .wbc se rechazan más abajo);
+       --journal necesita exactamente un script que reanudar */
+    if ((token_file && !worker_specs) || (resume && !journal_file) ||
+        (record_file && mode && strcmp(mode, "-c")) ||
+        (journal_file && (mode || argc != 2))) {
+        print_error();
+        exit(1);
+    }
+
+    if (worker_specs && remote_connect(worker_specs, token_file) != 0) {
+        print_error();
+        exit(1);
+    }
+
+    /* wish --multi [-j N] a.wsh b.wsh ... */
+    if (argc >= 3 && !strcmp(argv[1], "--multi")) {
+        int first = 2;
+        long jobs_max = sysconf(_SC_NPROCESSORS_ONLN);
+        if (!strcmp(argv[2], "-j")) {
+            char *end;
+            jobs_max = argc > 3 ? strtol(argv[3], &end, 10) : 0;
+            if (argc <= 3 || *end || jobs_max < 1 || jobs_max > 65536) {
+                print_error();
+                exit(1);
+            }
+            first = 4;
+        }
+        if (first >= argc) {
+            print_error();
+            exit(1);
+        }
+        live_open("--multi");
+        int rc = run_multi(argv + first, argc - first, jobs_max > 0 ? (int)jobs_max : 1);
+        glob_cache_clear();
+        remote_close();
+        free(jobs);
+        return rc;
+    }
+
+    /* wish --compile script -o script.wbc */
+    if (argc == 5 && !strcmp(argv[1], "--compile") && !strcmp(argv[3], "-o")) {
+        if (wbc_compile(argv[2], argv[4]) != 0) {
+            print_error();
+            exit(1);
+        }
+        return 0;
+    }
+
+    /* Entorno de los comandos: el heredado, mantenido por export/unset */
+    Env env;
+    if (env_init(&env, environ) != 0) {
+        print_error();
+        exit(1);
+    }
+
+    /* wish --replay log [--speed N] */
+    if (argc >= 3 && !strcmp(argv[1], "--replay")) {
+        double speed = 1;
+        char *end = "";
+        if (argc == 5 && !strcmp(argv[3], "--speed")) speed = strtod(argv[4], &end);
+        else if (argc != 3) end = "?";
+        if (*end || !(speed >= 0)) {
+            print_error();
+            exit(1);
+        }
+        int rc = run_replay(argv[2], speed, &env);
+        env_free(&env);
+        glob_cache_clear();
+        remote_close();
+        free(jobs);
+        return rc;
+    }
+
+    if (record_file) {
+        /* Los .wbc no conservan el texto de las líneas */
+        if ((argc == 2 && wbc_is_bytecode(argv[1])) || record_open(record_file) != 0) {
+            print_error();
+            exit(1);
+        }
+        recording = 1;
+        atexit(record_close);
+    }
+
+    /* wish -c "línea": una sola línea, sin leer script ni stdin */
+    if (argc == 3 && !strcmp(argv[1], "-c")) {
+        PathList pl;
+        path_init(&pl);
+        Sched s;
+        sched_init(&s, &pl, &env, AT_FDCWD, 0);
+        int rc = line_is_blank(argv[2], strlen(argv[2])) ? 0 : process_line(argv[2], &s);
+        ff_report("wish", &s);
+        if (s.cancelled) rc = s.ff_code;
+        path_clear(&pl);
+        env_free(&env);
+        glob_cache_clear();
+        remote_close();
+        free(jobs);
+        return rc;
+    }
+
     /* Validar número de argumentos */
     if (argc > 2) {
         print_error();
         exit(1);
     }
 
+    /* Script precompilado: se mapea y se ejecuta directamente */
+    if (argc == 2 && wbc_is_bytecode(argv[1])) {
+        Wbc w;
+        if (wbc_open(&w, argv[1]) != 0) {
+            print_error();
+            exit(1);
+        }
+        live_open(argv[1]);
+        PathList pl;
+        path_init(&pl);
+        Sched s;
+        sched_init(&s, &pl, &env, AT_FDCWD, 0);
+        uint32_t skip = journal_file ? journal_start(journal_file, argv[1], resume, &s) : 0;
+        run_bytecode(&w, &s, skip);
+        ff_report("wish", &s);
+        wbc_close(&w);
+        path_clear(&pl);
+        env_free(&env);
+        glob_cache_clear();
+        remote_close();
+        journal_close();
+        free(jobs);
+        return s.cancelled ? s.ff_code : 0;
+    }
+
     /* Definir entrada y modo interactivo */
-    FILE *input = stdin;
+    LineReader input;
     int interactive = 1;  /* solo imprime prompt en modo interactivo real */
 
+    lr_init(&input, STDIN_FILENO);
     if (argc == 2) {
-        input = fopen(argv[1], "r");
-        if (!input) {
+        lr_init(&input, open(argv[1], O_RDONLY | O_CLOEXEC));
+        if (input.fd < 0) {
             print_error();
             exit(1);
         }
         interactive = 0;   /* batch mode: NUNCA imprimir prompt */
+        live_open(argv[1]);
     }
 
     PathList pl;
     path_init(&pl);
+    Sched s;
+    sched_init(&s, &pl, &env, AT_FDCWD, 0);
+    edit_init(interactive);
+    edit_path_changed(pl.dirs, pl.count);
+    uint32_t skip = journal_file ? journal_start(journal_file, argv[1], resume, &s) : 0;
+    uint32_t lineno = 0;
 
     char *line = NULL;
     size_t cap = 0;
 
     while (1) {
-        if (interactive) {
-            /* Solo en modo interactivo real */
-            printf("wish> ");
-            fflush(stdout);
-        }
-
-        ssize_t n = getline(&line, &cap, input);
+        /* Solo en modo interactivo real se imprime el prompt */
+        ssize_t n = interactive ? edit_getline(&line, &cap, "wish> ")
+                                : lr_getline(&input, &line, &cap);
         if (n == -1) break; /* EOF → salir normal */
+        WISH_PROBE2(line__read, line, n);
+
+        /* Líneas ya terminadas en una ejecución anterior (--resume) */
+        if (++lineno <= skip) continue;
 
         /* Ignorar líneas vacías o solo whitespace */
-        int only_ws = 1;
-        for (ssize_t i = 0; i < n; i++) {
-            if (line[i] != ' ' && line[i] != '\t' &&
-                line[i] != '\n' && line[i] != '\r') {
-                only_ws = 0; break;
-            }
-        }
-        if (only_ws) continue;
+        if (line_is_blank(line, (size_t)n)) continue;
 
-        process_line(line, &pl);
+        live_line(lineno);
+        int rc = process_line(line, &s);
+        if (s.cancelled) break;
+        journal_record(lineno, rc, &s);
     }
+    ff_report("wish", &s);
 
-    if (input != stdin) fclose(input);
+    if (!interactive) close(input.fd);
+    lr_free(&input);
     free(line);
-    return 0;
+    path_clear(&pl);
+    env_free(&env);
+    glob_cache_clear();
+    remote_close();
+    edit_cleanup();
+    journal_close();
+    free(jobs);
+    return s.cancelled ? s.ff_code : 0;
 }
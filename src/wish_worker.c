@@ -0,0 +1,380 @@
+/*
+ * wish_worker.c – Agente que ejecuta los comandos que le envía wish --workers
+ *
+ * Uso: wish_worker [-m] [-k clave] unix:/ruta | tcp:[host:]puerto
+ *   -m  cada sesión corre en su propio espacio de nombres de montaje
+ *       (requiere CAP_SYS_ADMIN; pensado para pruebas locales)
+ *   -k  archivo con la clave compartida; obligatorio con tcp. Una sesión
+ *       no se acepta hasta que wish la presenta (wish --token)
+ *
+ * Cuidado: el agente ejecuta cualquier comando que le llegue, con los
+ * permisos de quien lo lanzó. Sin host escucha solo en loopback; exponerlo
+ * a otras máquinas ("tcp:0.0.0.0:puerto") equivale a dar una shell a quien
+ * tenga la clave, y el tráfico (clave incluida) no va cifrado.
+ *
+ * Cada conexión es una sesión en un proceso aparte con su propio cwd, path
+ * y entorno (MSG_STATE). Los comandos se lanzan con fork/execv igual que en
+ * wish; su stdout y stderr vuelven por el socket a medida que se producen.
+ */
+
+#define _GNU_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <sys/mount.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <arpa/inet.h>
+#include "wish_remote.h"
+
+#define MAX_PATHS 128
+#define MAX_MSG (16u << 20)     /* tope de un mensaje: 16 MiB */
+#define REAP_POLL_MS 10         /* sin pidfd: cada cuánto se mira si salió */
+#define USAGE "uso: wish_worker [-m] [-k clave] unix:/ruta | tcp:[host:]puerto"
+
+static const char ERRMSG[] = "An error has occurred\n";
+
+typedef struct {
+    uint32_t id;
+    pid_t    pid;
+    int      out, err;          /* extremos de lectura; -1 al llegar a EOF */
+    int      pidfd;             /* legible al salir el proceso; -1 si no hay */
+} WJob;
+
+typedef struct {
+    int    fd;                  /* socket con wish */
+    char  *cwd;
+    char  *dirs[MAX_PATHS];
+    int    ndirs;
+    char **env;                 /* entorno de wish; NULL: el del agente */
+    WJob  *jobs;
+    int    njobs, cap;
+    int    authed;              /* ya presentó la clave (o no hace falta) */
+    char  *rx;                  /* bytes recibidos de wish aún sin procesar */
+    size_t rxlen, rxcap;
+} Session;
+
+static char token[REMOTE_TOKEN_MAX];
+static int  token_len;          /* 0: sin clave */
+
+static void die(const char *msg, const char *arg) {
+    fprintf(stderr, "wish_worker: %s%s%s\n", msg, arg ? ": " : "", arg ? arg : "");
+    exit(2);
+}
+
+/* Separa un bloque "a\0b\0c\0" en v (hasta max); retorna cuántas cadenas */
+static int split_strv(char *data, size_t len, char **v, int max) {
+    int n = 0;
+    for (size_t off = 0; off < len && n < max; ) {
+        v[n++] = data + off;
+        off += strlen(data + off) + 1;
+    }
+    return n;
+}
+
+/* --------------------- Mensajes de wish --------------------- */
+
+static void free_env(char **env) {
+    for (int i = 0; env && env[i]; i++) free(env[i]);
+    free(env);
+}
+
+/* cwd, ndirs directorios y el resto, el entorno */
+static int on_state(Session *s, uint32_t ndirs, char *data, size_t len) {
+    if (len == 0 || data[len - 1] != '\0' || ndirs > MAX_PATHS) return -1;
+    int total = 0;
+    for (size_t i = 0; i < len; i++) total += data[i] == '\0';
+    if ((uint32_t)total < 1 + ndirs) return -1;
+    char **v = malloc((size_t)total * sizeof(char *));
+    char **env = calloc((size_t)total - ndirs, sizeof(char *));
+    if (!v || !env) {
+        free(v);
+        free(env);
+        return -1;
+    }
+    split_strv(data, len, v, total);
+
+    free(s->cwd);
+    for (int i = 0; i < s->ndirs; i++) free(s->dirs[i]);
+    free_env(s->env);
+    s->cwd = strdup(v[0]);
+    s->ndirs = 0;
+    for (uint32_t i = 0; i < ndirs; i++) s->dirs[s->ndirs++] = strdup(v[1 + i]);
+    for (int i = 1 + (int)ndirs; i < total; i++) env[i - 1 - (int)ndirs] = strdup(v[i]);
+    s->env = env;
+    free(v);
+    return 0;
+}
+
+static void exec_child(Session *s, char **argv) {
+    if (s->cwd && chdir(s->cwd) != 0) {
+        write(STDERR_FILENO, ERRMSG, strlen(ERRMSG));
+        _exit(1);
+    }
+    char full[1024];
+    for (int i = 0; i < s->ndirs; i++) {
+        snprintf(full, sizeof(full), "%s/%s", s->dirs[i], argv[0]);
+        if (access(full, X_OK) == 0) {
+            if (s->env) execve(full, argv, s->env);
+            else execv(full, argv);
+            break;
+        }
+    }
+    write(STDERR_FILENO, ERRMSG, strlen(ERRMSG));
+    _exit(1);
+}
+
+static int on_run(Session *s, uint32_t id, char *data, size_t len) {
+    if (len < 2 || data[len - 1] != '\0') return -1;
+    int combined = data[0] & RUN_COMBINED;
+
+    int argc = 0;
+    for (size_t i = 1; i < len; i++) argc += data[i] == '\0';
+    char **argv = malloc(((size_t)argc + 1) * sizeof(char *));
+    if (!argv) return -1;
+    argc = split_strv(data + 1, len - 1, argv, argc);
+    argv[argc] = NULL;
+
+    if (s->njobs == s->cap) {
+        int ncap = s->cap ? s->cap * 2 : 16;
+        WJob *nj = realloc(s->jobs, (size_t)ncap * sizeof(WJob));
+        if (!nj) { free(argv); return -1; }
+        s->jobs = nj;
+        s->cap = ncap;
+    }
+
+    int po[2], pe[2] = { -1, -1 };
+    if (pipe2(po, O_CLOEXEC) < 0 || (!combined && pipe2(pe, O_CLOEXEC) < 0)) {
+        free(argv);
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(po[1], STDOUT_FILENO);
+        dup2(combined ? po[1] : pe[1], STDERR_FILENO);
+        exec_child(s, argv);
+    }
+    free(argv);
+    close(po[1]);
+    if (!combined) close(pe[1]);
+    if (pid < 0) {
+        close(po[0]);
+        if (!combined) close(pe[0]);
+        return -1;
+    }
+    int pidfd = -1;
+#ifdef SYS_pidfd_open
+    pidfd = (int)syscall(SYS_pidfd_open, pid, 0);
+    if (pidfd >= 0) fcntl(pidfd, F_SETFD, FD_CLOEXEC);
+#endif
+    s->jobs[s->njobs++] = (WJob){ id, pid, po[0], combined ? -1 : pe[0], pidfd };
+    return 0;
+}
+
+/* Compara sin salir antes de tiempo: la duración no revela el prefijo */
+static int token_ok(const char *data, size_t len) {
+    unsigned char diff = len != (size_t)token_len;
+    for (size_t i = 0; i < (size_t)token_len; i++) {
+        diff |= (unsigned char)token[i] ^ (unsigned char)(i < len ? data[i] : 0);
+    }
+    return diff == 0;
+}
+
+static int dispatch(Session *s, const RemoteMsg *m, char *data) {
+    int rc = 0;
+    if (m->type == MSG_HELLO) {
+        if (token_len && !token_ok(data, m->len)) rc = -1;
+        else rc = remote_send(s->fd, MSG_HELLO, 0, NULL, 0);
+        if (rc == 0) s->authed = 1;
+    } else if (m->type == MSG_STATE) rc = on_state(s, m->id, data, m->len);
+    else if (m->type == MSG_RUN) rc = on_run(s, m->id, data, m->len);
+    if (rc < 0 && m->type == MSG_RUN) {
+        /* No se pudo lanzar: se informa como un fallo de fork */
+        uint32_t code = htonl(1);
+        remote_send(s->fd, MSG_ERR, m->id, ERRMSG, strlen(ERRMSG));
+        rc = remote_send(s->fd, MSG_EXIT, m->id, &code, sizeof(code));
+    }
+    return rc;
+}
+
+/* Lee lo que haya en el socket (una sola vez, no bloquea tras poll) y
+   atiende los mensajes completos; uno a medias queda en s->rx hasta la
+   próxima vuelta. -1 si wish cerró la sesión (o no presentó la clave) */
+static int on_message(Session *s) {
+    if (s->rxcap - s->rxlen < 65536) {
+        size_t ncap = s->rxcap ? s->rxcap * 2 : 65536 * 2;
+        char *nb = realloc(s->rx, ncap);
+        if (!nb) return -1;
+        s->rx = nb;
+        s->rxcap = ncap;
+    }
+    ssize_t n;
+    do {
+        n = read(s->fd, s->rx + s->rxlen, s->rxcap - s->rxlen);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) return -1;
+    s->rxlen += (size_t)n;
+
+    size_t off = 0;
+    while (s->rxlen - off >= sizeof(RemoteMsg)) {
+        RemoteMsg m;
+        memcpy(&m, s->rx + off, sizeof(m));
+        m.type = ntohl(m.type);
+        m.id = ntohl(m.id);
+        m.len = ntohl(m.len);
+        /* Se valida la cabecera antes de esperar el cuerpo: así el búfer
+           nunca pasa de un mensaje máximo */
+        if (m.len > MAX_MSG || (!s->authed && m.type != MSG_HELLO)) return -1;
+        if (!s->authed && m.len > REMOTE_TOKEN_MAX) return -1;
+        if (s->rxlen - off - sizeof(m) < m.len) break;
+        char *data = malloc((size_t)m.len + 1);
+        if (!data) return -1;
+        memcpy(data, s->rx + off + sizeof(m), m.len);
+        off += sizeof(m) + m.len;
+        int rc = dispatch(s, &m, data);
+        free(data);
+        if (rc < 0) return -1;
+    }
+    memmove(s->rx, s->rx + off, s->rxlen - off);
+    s->rxlen -= off;
+    return 0;
+}
+
+/* --------------------- Salida de los trabajos --------------------- */
+
+/* Reenvía lo disponible en *fd; al llegar a EOF lo cierra */
+static int forward(Session *s, uint32_t id, int *fd, uint32_t type) {
+    char buf[65536];
+    ssize_t n;
+    do {
+        n = read(*fd, buf, sizeof(buf));
+    } while (n < 0 && errno == EINTR);
+    if (n > 0) return remote_send(s->fd, type, id, buf, (size_t)n);
+    close(*fd);
+    *fd = -1;
+    return 0;
+}
+
+/* Informa de los trabajos con la salida cerrada cuyo proceso ya terminó.
+   Sin bloquear: uno que cierra stdout/stderr y sigue corriendo se queda en
+   el poll (por su pidfd) y no detiene al resto de la sesión */
+static int reap_finished(Session *s) {
+    for (int i = 0; i < s->njobs; ) {
+        WJob *j = &s->jobs[i];
+        if (j->out >= 0 || j->err >= 0) { i++; continue; }
+        int st = 0;
+        pid_t r;
+        while ((r = waitpid(j->pid, &st, WNOHANG)) < 0 && errno == EINTR) {}
+        if (r == 0) { i++; continue; }
+        if (j->pidfd >= 0) close(j->pidfd);
+        uint32_t code = WIFEXITED(st) ? (uint32_t)WEXITSTATUS(st)
+                      : WIFSIGNALED(st) ? 128u + (uint32_t)WTERMSIG(st) : 1u;
+        code = htonl(code);
+        if (remote_send(s->fd, MSG_EXIT, j->id, &code, sizeof(code)) < 0) return -1;
+        s->jobs[i] = s->jobs[--s->njobs];
+    }
+    return 0;
+}
+
+static void session(int fd) {
+    Session s;
+    memset(&s, 0, sizeof(s));
+    s.fd = fd;
+    s.authed = token_len == 0;
+    s.dirs[s.ndirs++] = strdup("/bin");
+
+    int open_conn = 1;
+    struct pollfd *pfd = NULL;
+    size_t pcap = 0;
+    while (open_conn || s.njobs > 0) {
+        size_t need = 1 + 3 * (size_t)s.njobs;
+        if (need > pcap) {
+            struct pollfd *np = realloc(pfd, need * sizeof(*pfd));
+            if (!np) break;
+            pfd = np;
+            pcap = need;
+        }
+        size_t n = 0;
+        int timeout = -1;
+        pfd[n++] = (struct pollfd){ open_conn ? fd : -1, POLLIN, 0 };
+        for (int i = 0; i < s.njobs; i++) {
+            WJob *j = &s.jobs[i];
+            int waiting = j->out < 0 && j->err < 0;
+            pfd[n++] = (struct pollfd){ j->out, POLLIN, 0 };
+            pfd[n++] = (struct pollfd){ j->err, POLLIN, 0 };
+            pfd[n++] = (struct pollfd){ waiting ? j->pidfd : -1, POLLIN, 0 };
+            if (waiting && j->pidfd < 0) timeout = REAP_POLL_MS;
+        }
+        if (poll(pfd, (nfds_t)n, timeout) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        /* Primero la salida de los trabajos ya conocidos (los índices de
+           pfd corresponden a s.jobs antes de aceptar nuevos) */
+        int rc = 0;
+        for (int i = 0; i < s.njobs && rc == 0; i++) {
+            if (pfd[1 + 3 * i].revents)
+                rc = forward(&s, s.jobs[i].id, &s.jobs[i].out, MSG_OUT);
+            if (rc == 0 && pfd[2 + 3 * i].revents)
+                rc = forward(&s, s.jobs[i].id, &s.jobs[i].err, MSG_ERR);
+        }
+        if (rc == 0) rc = reap_finished(&s);
+        if (rc == 0 && open_conn && pfd[0].revents && on_message(&s) < 0) open_conn = 0;
+        if (rc < 0) break;
+    }
+    _exit(0);
+}
+
+int main(int argc, char *argv[]) {
+    int isolate = 0;
+    const char *token_file = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "mk:")) != -1) {
+        if (opt == 'm') isolate = 1;
+        else if (opt == 'k') token_file = optarg;
+        else die(USAGE, NULL);
+    }
+    if (optind != argc - 1) die(USAGE, NULL);
+    if (token_file && (token_len = remote_read_token(token_file, token)) < 0) {
+        die("clave inválida en", token_file);
+    }
+    /* Por TCP llega cualquiera que alcance el puerto: sin clave no se sirve */
+    if (!token_file && strncmp(argv[optind], "unix:", 5) != 0) {
+        die("tcp requiere una clave (-k archivo)", NULL);
+    }
+
+    int lfd = remote_socket(argv[optind], 1);
+    if (lfd < 0) die("no se pudo escuchar en", argv[optind]);
+
+    /* Las sesiones terminan solas; no hace falta recogerlas */
+    signal(SIGCHLD, SIG_IGN);
+    signal(SIGPIPE, SIG_IGN);
+
+    for (;;) {
+        int fd = accept4(lfd, NULL, NULL, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            die("accept falló", NULL);
+        }
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(lfd);
+            signal(SIGCHLD, SIG_DFL);
+            if (isolate && (unshare(CLONE_NEWNS) != 0 ||
+                            mount(NULL, "/", NULL, MS_REC | MS_PRIVATE, NULL) != 0)) {
+                die("no se pudo aislar la sesión", NULL);
+            }
+            session(fd);
+        }
+        close(fd);
+    }
+}
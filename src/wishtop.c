@@ -0,0 +1,179 @@
+/*
+ * wishtop.c — Vista en vivo de los wish batch de la máquina
+ *
+ * Lee los segmentos /dev/shm/wish-live.<pid> que publica cada wish (ver
+ * wish_live.h) y muestra por cada uno la línea en curso, su ritmo y los
+ * hijos que corren, refrescando cada intervalo. Solo lee: el shell nunca
+ * espera a wishtop. Los segmentos de shells que ya no existen (muertos
+ * sin pasar por exit) se borran.
+ *
+ * Uso: wishtop [-n ms] [-1] [pid...]
+ *   -n   intervalo de refresco en milisegundos (por defecto 1000)
+ *   -1   una sola vista, sin limpiar la pantalla (para scripts)
+ *   pid  solo esos shells (por defecto, todos)
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "wish_live.h"
+
+#define MAX_SHELLS 64
+
+static void die(const char *msg, const char *arg) {
+    fprintf(stderr, "wishtop: %s%s%s\n", msg, arg ? ": " : "", arg ? arg : "");
+    exit(1);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "uso: %s [-n ms] [-1] [pid...]\n", prog);
+    exit(2);
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* "12.3s", "4m05s" o "2h10m" */
+static const char *fmt_age(uint64_t ns, char *buf, size_t len) {
+    double s = (double)ns / 1e9;
+    if (s < 60) snprintf(buf, len, "%.1fs", s);
+    else if (s < 3600) snprintf(buf, len, "%dm%02ds", (int)s / 60, (int)s % 60);
+    else snprintf(buf, len, "%dh%02dm", (int)s / 3600, (int)s % 3600 / 60);
+    return buf;
+}
+
+static int wanted(long pid, long *pids, int npids) {
+    if (npids == 0) return 1;
+    for (int i = 0; i < npids; i++) {
+        if (pids[i] == pid) return 1;
+    }
+    return 0;
+}
+
+/* Copia el segmento del shell pid. Retorna 0, o -1 si no hay nada que
+   mostrar (borrado, a medias o de otra versión). */
+static int read_shell(const char *name, LiveShm *out) {
+    char path[300];
+    snprintf(path, sizeof(path), "/%s", name);
+    int fd = shm_open(path, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    void *p = mmap(NULL, sizeof(LiveShm), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return -1;
+    int r = live_snapshot(p, out);
+    munmap(p, sizeof(LiveShm));
+    if (r < 0 || out->magic != LIVE_MAGIC || out->version != LIVE_VERSION) return -1;
+    return 0;
+}
+
+static int cmp_start(const void *a, const void *b) {
+    const LiveJob *x = a, *y = b;
+    return (x->start_ns > y->start_ns) - (x->start_ns < y->start_ns);
+}
+
+static void show(const LiveShm *s, uint64_t now) {
+    char a[32], b[32];
+    printf("PID %-7d %-32.32s línea %-6u %7.1f líneas/s %7.1f hijos/s  %u hijos  "
+           "en marcha %s, hace %s\n",
+           s->shell_pid, s->script, s->line, s->lines_rate, s->jobs_rate, s->njobs,
+           fmt_age(now - s->started_ns, a, sizeof(a)), fmt_age(now - s->updated_ns, b, sizeof(b)));
+
+    /* Los más antiguos primero: suelen ser los que interesan */
+    LiveJob jobs[LIVE_SLOTS];
+    int n = 0;
+    for (int i = 0; i < LIVE_SLOTS; i++) {
+        if (s->jobs[i].pid) jobs[n++] = s->jobs[i];
+    }
+    qsort(jobs, (size_t)n, sizeof(LiveJob), cmp_start);
+    if (n) printf("    %8s %6s %9s  %s\n", "PID", "LÍNEA", "EDAD", "COMANDO");
+    for (int i = 0; i < n; i++) {
+        printf("    %8d %6u %9s  %.*s\n", jobs[i].pid, jobs[i].line,
+               fmt_age(now - jobs[i].start_ns, a, sizeof(a)), LIVE_NAME_MAX, jobs[i].name);
+    }
+    if (s->njobs > (uint32_t)n) printf("    ... y %u más\n", s->njobs - (uint32_t)n);
+}
+
+/* Una vista completa; retorna cuántos shells mostró */
+static int refresh(long *pids, int npids, int clear) {
+    DIR *d = opendir("/dev/shm");
+    if (!d) die("no se pudo abrir", "/dev/shm");
+
+    static LiveShm shells[MAX_SHELLS];
+    int n = 0;
+    struct dirent *de;
+    size_t plen = strlen(LIVE_PREFIX);
+    while ((de = readdir(d)) != NULL && n < MAX_SHELLS) {
+        if (strncmp(de->d_name, LIVE_PREFIX, plen) != 0) continue;
+        char *end;
+        long pid = strtol(de->d_name + plen, &end, 10);
+        if (*end || pid <= 0 || !wanted(pid, pids, npids)) continue;
+        if (kill((pid_t)pid, 0) != 0 && errno == ESRCH) {
+            /* Huérfano: el shell murió sin borrarlo */
+            char path[300];
+            snprintf(path, sizeof(path), "/%s", de->d_name);
+            shm_unlink(path);
+            continue;
+        }
+        if (read_shell(de->d_name, &shells[n]) == 0) n++;
+    }
+    closedir(d);
+
+    uint64_t now = now_ns();
+    if (clear) printf("\033[H\033[J");
+    time_t t = time(NULL);
+    char when[16];
+    strftime(when, sizeof(when), "%H:%M:%S", localtime(&t));
+    printf("wishtop — %d shell%s  %s\n\n", n, n == 1 ? "" : "s", when);
+    for (int i = 0; i < n; i++) {
+        show(&shells[i], now);
+        printf("\n");
+    }
+    fflush(stdout);
+    return n;
+}
+
+int main(int argc, char *argv[]) {
+    long interval = 1000;
+    int once = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:1")) != -1) {
+        switch (opt) {
+        case 'n': interval = atol(optarg); break;
+        case '1': once = 1; break;
+        default: usage(argv[0]);
+        }
+    }
+    if (interval < 10) usage(argv[0]);
+
+    int npids = argc - optind;
+    long *pids = calloc((size_t)npids + 1, sizeof(long));
+    if (!pids) die("sin memoria", NULL);
+    for (int i = 0; i < npids; i++) {
+        char *end;
+        pids[i] = strtol(argv[optind + i], &end, 10);
+        if (*end || pids[i] <= 0) usage(argv[0]);
+    }
+
+    if (once) {
+        refresh(pids, npids, 0);
+        free(pids);
+        return 0;
+    }
+    for (;;) {
+        refresh(pids, npids, 1);
+        struct timespec ts = { interval / 1000, (interval % 1000) * 1000000L };
+        nanosleep(&ts, NULL);
+    }
+}